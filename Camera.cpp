@@ -25,6 +25,9 @@ void Camera::reset() {
 
   m_distance = DEFAULT_DISTANCE_MIN;
   m_distance_min = DEFAULT_DISTANCE_MIN;
+
+  __vector_element_assign_opV3(m_follow_velocity, =, ZERO_VECTOR);
+  __vector_element_assign_opV3(m_follow_target_velocity, =, ZERO_VECTOR);
 }
 
 void Camera::move(const float distance_right, const float distance_up, const float distance_forward) {
@@ -211,69 +214,71 @@ void Camera::set_target(const float point_x, const float point_y, const float po
   set_target(point);
 }
 void Camera::set_target(const float point[3]) {
-  float temp_vector[3];
-  float angle_vector[3];
-  float normal_vector[3];
-
-  float angle;
+  float view_vector[3];
+  float heading[3];
 
-  float cos_of_angle;
-  float sin_of_angle;
+  __vector_element_opV3(point, -, m_position, view_vector);
 
-  // find vector projected to XZ-plane from m_position to point
-  __vector_element_opV3(point, -, m_position, temp_vector);
-  temp_vector[DIM_Y] = 0.0f;
-  normalizeV3(temp_vector);
+  const float distance = __magnitudeV3(view_vector);
+  float heading_length = sqrtf(view_vector[DIM_X]*view_vector[DIM_X] + view_vector[DIM_Z]*view_vector[DIM_Z]);
 
-  // find the angle from the Z unit vector to this projected vector
-  angle = acosf(__dot_productV3(UNIT_VECTOR_Z, temp_vector));
-  angle *= side_of_vector_signV3(UNIT_VECTOR_Z, temp_vector, UNIT_VECTOR_Y);
-
-  if (angle == angle) {
-    // rotate horixontally to this angle
-    set_angle_horizontal(angle);
+  // keep the current heading while point is straight above or below
+  if (heading_length > 1e-6f) {
+    heading[DIM_X] = view_vector[DIM_X] / heading_length;
+    heading[DIM_Z] = view_vector[DIM_Z] / heading_length;
   }
+  else {
+    heading[DIM_X] = -m_vector_right_z;
+    heading[DIM_Z] = m_vector_right_x;
+    heading_length = 0.0f;
+  }
+  heading[DIM_Y] = 0.0f;
+
+  // express the roll vector in the current basis so that the roll carries over to the new one
+  const float roll_right = __dot_productV3(m_vector_up_roll, m_vector_right);
+  const float roll_up = __dot_productV3(m_vector_up_roll, m_vector_up);
 
-  // rotate Z unit vector in the XZ-plane by -m_angle_horizontal
-  cos_of_angle = cosf(-m_angle_horizontal);
-  sin_of_angle = sinf(-m_angle_horizontal);
+  m_angle_horizontal = atan2f(-heading[DIM_X], heading[DIM_Z]);
 
-  m_matrix_rotation[0][0] = cos_of_angle;
-  m_matrix_rotation[0][1] = 0.0f;
-  m_matrix_rotation[0][2] = sin_of_angle;
+  float angle = distance > 1e-6f ? atan2f(-view_vector[DIM_Y], heading_length) : 0.0f;
 
-  m_matrix_rotation[1][0] = 0.0f;
-  m_matrix_rotation[1][1] = 1.0f;
-  m_matrix_rotation[1][2] = 0.0f;
+  // limits vertical camera rotation, in which case the camera no longer looks straight at point
+  if (angle > m_angle_vertical_max || angle < m_angle_vertical_min) {
+    angle = angle > m_angle_vertical_max ? m_angle_vertical_max : m_angle_vertical_min;
 
-  m_matrix_rotation[2][0] = -sin_of_angle;
-  m_matrix_rotation[2][1] = 0.0f;
-  m_matrix_rotation[2][2] = cos_of_angle;
+    const float cos_of_angle = cosf(angle);
 
-  __matrix_mult_M3x3_V3(m_matrix_rotation, UNIT_VECTOR_Z, angle_vector);
-  normalizeV3(angle_vector);
+    m_vector_forward_x = heading[DIM_X]*cos_of_angle;
+    m_vector_forward_y = -sinf(angle);
+    m_vector_forward_z = heading[DIM_Z]*cos_of_angle;
+  }
+  else if (distance > 1e-6f) {
+    __vector_scalar_opV3(view_vector, /, distance, m_vector_forward);
+  }
+  else {
+    __vector_element_assign_opV3(m_vector_forward, =, heading);
+  }
+  m_angle_vertical = angle;
 
-  // find vector from m_position to point
-  __vector_element_opV3(point, -, m_position, temp_vector);
-  normalizeV3(temp_vector);
+  // right stays level, so it is the heading turned a quarter to the right
+  m_vector_right_x = heading[DIM_Z];
+  m_vector_right_y = 0.0f;
+  m_vector_right_z = -heading[DIM_X];
 
-  // find angle between the rotated Z vector and this vector
-  angle = acosf(__dot_productV3(angle_vector, temp_vector));
-  __cross_productV3(angle_vector, temp_vector, normal_vector);
-  angle *= -side_of_vector_signV3(angle_vector, temp_vector, normal_vector);
+  __cross_productV3(m_vector_forward, m_vector_right, m_vector_up);
 
-  if (angle != angle) {
-    angle = 0.0f;
-  }
+  m_vector_up_roll_x = m_vector_right_x*roll_right + m_vector_up_x*roll_up;
+  m_vector_up_roll_y = m_vector_right_y*roll_right + m_vector_up_y*roll_up;
+  m_vector_up_roll_z = m_vector_right_z*roll_right + m_vector_up_z*roll_up;
+  normalizeV3(m_vector_up_roll);
 
-  // rotate vertically to this angle
-  set_angle_vertical(angle);
+  m_pose_version++;
 
   // set m_target
   __vector_element_assign_opV3(m_target, =, point);
 
   // recalculate distance
-  m_distance = __distanceV3(m_position, m_target);
+  m_distance = distance;
 
   // enforce minimum distance
   zoom_distance(0.0f);
@@ -299,4 +304,76 @@ void Camera::zoom_distance(const float distance) {
 }
 void Camera::set_distance(const float distance) {
   zoom_distance(m_distance - distance);
+}
+
+// moves value towards goal as a critically damped spring that settles in about smooth_time seconds, carrying its
+// velocity between calls
+static void smooth_damp(float value[3], const float goal[3], float velocity[3], const float seconds, const float smooth_time) {
+  const float omega = 2.0f / smooth_time;
+  const float x = omega*seconds;
+
+  // a close approximation of exp(-x)
+  const float decay = 1.0f / (1.0f + x + 0.48f*x*x + 0.235f*x*x*x);
+
+  for (int i = 0; i < 3; i++) {
+    const float change = value[i] - goal[i];
+    const float temp = (velocity[i] + omega*change)*seconds;
+
+    velocity[i] = (velocity[i] - omega*temp)*decay;
+    value[i] = goal[i] + (change + temp)*decay;
+  }
+}
+
+void Camera::follow(const Object& object, const float distance, const float angle_down, const float height, const float seconds, const float smooth_time) {
+  float heading[3];
+  float position[3];
+  float target[3];
+
+  // keep the last heading while object points straight up or down
+  heading[DIM_X] = object.c_vector_forward_x;
+  heading[DIM_Y] = 0.0f;
+  heading[DIM_Z] = object.c_vector_forward_z;
+  if (__dot_productV3(heading, heading) < 1e-12f) {
+    heading[DIM_X] = m_vector_forward_x;
+    heading[DIM_Z] = m_vector_forward_z;
+  }
+  normalizeV3(heading);
+
+  const float cos_of_angle = cosf(angle_down);
+  const float sin_of_angle = sinf(angle_down);
+
+  __vector_element_assign_opV3(target, =, object.c_position);
+  target[DIM_Y] += height;
+
+  position[DIM_X] = target[DIM_X] - heading[DIM_X]*cos_of_angle*distance;
+  position[DIM_Y] = target[DIM_Y] + sin_of_angle*distance;
+  position[DIM_Z] = target[DIM_Z] - heading[DIM_Z]*cos_of_angle*distance;
+
+  if (smooth_time > 0.0f && seconds > 0.0f) {
+    smooth_damp(m_position, position, m_follow_velocity, seconds, smooth_time);
+    smooth_damp(m_target, target, m_follow_target_velocity, seconds, smooth_time);
+  }
+  else {
+    __vector_element_assign_opV3(m_position, =, position);
+    __vector_element_assign_opV3(m_target, =, target);
+    __vector_element_assign_opV3(m_follow_velocity, =, ZERO_VECTOR);
+    __vector_element_assign_opV3(m_follow_target_velocity, =, ZERO_VECTOR);
+  }
+
+  // build the basis straight from the view direction, without roll
+  __vector_element_opV3(m_target, -, m_position, m_vector_forward);
+  m_distance = __magnitudeV3(m_vector_forward);
+  __vector_scalar_assign_opV3(m_vector_forward, /=, m_distance);
+
+  __cross_productV3(UNIT_VECTOR_Y, m_vector_forward, m_vector_right);
+  normalizeV3(m_vector_right);
+  __cross_productV3(m_vector_forward, m_vector_right, m_vector_up);
+
+  __vector_element_assign_opV3(m_vector_up_roll, =, m_vector_up);
+  m_angle_roll = 0.0f;
+
+  m_angle_horizontal = atan2f(-m_vector_forward_x, m_vector_forward_z);
+  m_angle_vertical = atan2f(-m_vector_forward_y, sqrtf(m_vector_forward_x*m_vector_forward_x + m_vector_forward_z*m_vector_forward_z));
+
+  m_pose_version++;
 }
\ No newline at end of file
@@ -65,6 +65,11 @@ public:
   void zoom_distance(const float distance);
   void set_distance(const float distance);
 
+  // places the camera distance behind object along its heading, looking down at it by angle_down, then raises the
+  // camera and its target by height; with a smooth_time above zero the camera instead eases towards that pose, settling
+  // in about smooth_time seconds without overshooting
+  void follow(const Object& object, const float distance, const float angle_down, const float height, const float seconds = 0.0f, const float smooth_time = 0.0f);
+
 private:
   // a normalized vector that defines the up vector that determines the roll
   float m_vector_up_roll[3];
@@ -88,6 +93,10 @@ private:
   // distance to target and minimum distance
   float m_distance;
   float m_distance_min;
+
+  // velocities of the position and target while following with smoothing
+  float m_follow_velocity[3];
+  float m_follow_target_velocity[3];
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,201 @@
+#ifndef COLLISION_KERNEL_H
+#define COLLISION_KERNEL_H
+
+#include <cmath>
+
+#include "Shape.h"
+#include "Gjk.h"
+#include "vector3.h"
+
+// segments shorter than this are treated as points
+#define SEGMENT_LENGTH_EPSILON 1e-12f
+
+// yields value limited to the range from 0 to 1
+#define __saturate(value) \
+  fminf(fmaxf(value, 0.0f), 1.0f)
+
+// stores the end points of the core segment of a sphere or capsule along its up vector and yields its radius
+template <int TYPE>
+inline float swept_sphere_store(const Shape& shape, float start[3], float end[3]) {
+  const float radius = shape.c_scale_x*0.5f;
+  const float half_length = TYPE == SHAPE_TYPE_CAPSULE ? fmaxf(shape.c_scale_y*0.5f - radius, 0.0f) : 0.0f;
+
+  __vector_element_op_and_scalar_opV3(shape.c_position, -, shape.c_vector_up, *, half_length, start);
+  __vector_element_op_and_scalar_opV3(shape.c_position, +, shape.c_vector_up, *, half_length, end);
+  return radius;
+}
+
+// yields the squared distance between the closest points of the segments from start_0 to end_0 and start_1 to end_1
+inline float segment_distance_squared(const float start_0[3], const float end_0[3], const float start_1[3], const float end_1[3]) {
+  float direction_0[3];
+  float direction_1[3];
+  float offset[3];
+  float closest_0[3];
+  float closest_1[3];
+
+  float parameter_0 = 0.0f;
+  float parameter_1 = 0.0f;
+
+  __vector_element_opV3(end_0, -, start_0, direction_0);
+  __vector_element_opV3(end_1, -, start_1, direction_1);
+  __vector_element_opV3(start_0, -, start_1, offset);
+
+  const float length_squared_0 = __dot_productV3(direction_0, direction_0);
+  const float length_squared_1 = __dot_productV3(direction_1, direction_1);
+  const float projection_1 = __dot_productV3(direction_1, offset);
+
+  if (length_squared_0 <= SEGMENT_LENGTH_EPSILON) {
+    if (length_squared_1 > SEGMENT_LENGTH_EPSILON) {
+      parameter_1 = __saturate(projection_1 / length_squared_1);
+    }
+  }
+  else {
+    const float projection_0 = __dot_productV3(direction_0, offset);
+
+    if (length_squared_1 <= SEGMENT_LENGTH_EPSILON) {
+      parameter_0 = __saturate(-projection_0 / length_squared_0);
+    }
+    else {
+      // find the closest points of the two lines, then clamp each to its segment in turn
+      const float cosine = __dot_productV3(direction_0, direction_1);
+      const float denominator = length_squared_0*length_squared_1 - cosine*cosine;
+
+      if (denominator != 0.0f) {
+        parameter_0 = __saturate((cosine*projection_1 - projection_0*length_squared_1) / denominator);
+      }
+
+      parameter_1 = (cosine*parameter_0 + projection_1) / length_squared_1;
+
+      if (parameter_1 < 0.0f) {
+        parameter_1 = 0.0f;
+        parameter_0 = __saturate(-projection_0 / length_squared_0);
+      }
+      else if (parameter_1 > 1.0f) {
+        parameter_1 = 1.0f;
+        parameter_0 = __saturate((cosine - projection_0) / length_squared_0);
+      }
+    }
+  }
+
+  __vector_element_op_and_scalar_opV3(start_0, +, direction_0, *, parameter_0, closest_0);
+  __vector_element_op_and_scalar_opV3(start_1, +, direction_1, *, parameter_1, closest_1);
+  __vector_element_opV3(closest_0, -, closest_1, offset);
+
+  return __dot_productV3(offset, offset);
+}
+
+// tests spheres and capsules through the distance between their core segments
+template <int TYPE_A, int TYPE_B>
+inline bool is_swept_sphere_overlapping(const Shape& shape_a, const Shape& shape_b) {
+  float start_a[3];
+  float end_a[3];
+  float start_b[3];
+  float end_b[3];
+
+  const float radius_sum = swept_sphere_store<TYPE_A>(shape_a, start_a, end_a) + swept_sphere_store<TYPE_B>(shape_b, start_b, end_b);
+
+  return segment_distance_squared(start_a, end_a, start_b, end_b) < radius_sum*radius_sum;
+}
+
+// pairs of convex shapes without a specialized kernel fall back to GJK on the support points; the kernel is
+// gjk_is_overlapping itself so that Shape::is_collision_cached can tell it apart
+template <int TYPE_A, int TYPE_B>
+struct CollisionKernel {
+  static constexpr CollisionFunction is_overlapping = gjk_is_overlapping;
+};
+
+// declares the kernel for TYPE_A and TYPE_B as the kernel for TYPE_B and TYPE_A with the shapes swapped
+#define __swapped_collision_kernel(TYPE_A, TYPE_B) \
+  template <> \
+  struct CollisionKernel<TYPE_A, TYPE_B> { \
+    static bool is_overlapping(const Shape& shape_a, const Shape& shape_b, GjkCache* cache) { \
+      return CollisionKernel<TYPE_B, TYPE_A>::is_overlapping(shape_b, shape_a, cache); \
+    } \
+  };
+
+template <>
+struct CollisionKernel<SHAPE_TYPE_CUBOID, SHAPE_TYPE_CUBOID> {
+  static bool is_overlapping(const Shape& shape_a, const Shape& shape_b, GjkCache*) {
+    return shape_a.is_cuboid_overlapping_cuboid(shape_b);
+  }
+};
+
+template <>
+struct CollisionKernel<SHAPE_TYPE_CUBOID, SHAPE_TYPE_MESH> {
+  static bool is_overlapping(const Shape& shape_a, const Shape& shape_b, GjkCache*) {
+    return Shape::is_mesh_overlapping_cuboid(shape_b, shape_a);
+  }
+};
+__swapped_collision_kernel(SHAPE_TYPE_MESH, SHAPE_TYPE_CUBOID)
+
+// declares the kernel that tests the triangles of a mesh against a convex shape of TYPE, in both orders
+#define __mesh_collision_kernel(TYPE) \
+  template <> \
+  struct CollisionKernel<SHAPE_TYPE_MESH, TYPE> { \
+    static bool is_overlapping(const Shape& shape_a, const Shape& shape_b, GjkCache*) { \
+      return Shape::is_mesh_overlapping_convex(shape_a, shape_b); \
+    } \
+  }; \
+  __swapped_collision_kernel(TYPE, SHAPE_TYPE_MESH)
+
+__mesh_collision_kernel(SHAPE_TYPE_SPHERE)
+__mesh_collision_kernel(SHAPE_TYPE_CAPSULE)
+__mesh_collision_kernel(SHAPE_TYPE_CYLINDER)
+__mesh_collision_kernel(SHAPE_TYPE_CONVEX_HULL)
+
+// meshes are surfaces, so two of them only touch through crossing triangles which are not tested
+template <>
+struct CollisionKernel<SHAPE_TYPE_MESH, SHAPE_TYPE_MESH> {
+  static bool is_overlapping(const Shape&, const Shape&, GjkCache*) {
+    return false;
+  }
+};
+
+template <>
+struct CollisionKernel<SHAPE_TYPE_CUBOID, SHAPE_TYPE_SPHERE> {
+  static bool is_overlapping(const Shape& shape_a, const Shape& shape_b, GjkCache*) {
+    float center[3];
+    float closest[3];
+
+    const float half_extent[3] = { shape_a.c_scale_x*0.5f, shape_a.c_scale_y*0.5f, shape_a.c_scale_z*0.5f };
+    const float radius = shape_b.c_scale_x*0.5f;
+
+    // find the point of the cuboid closest to the center of the sphere in the frame of the cuboid
+    shape_a.local_point_store(shape_b.c_position, center);
+    for (int i = 0; i < 3; i++) {
+      closest[i] = fminf(fmaxf(center[i], -half_extent[i]), half_extent[i]);
+    }
+
+    __vector_element_opV3(center, -, closest, center);
+    return __dot_productV3(center, center) < radius*radius;
+  }
+};
+__swapped_collision_kernel(SHAPE_TYPE_SPHERE, SHAPE_TYPE_CUBOID)
+
+template <>
+struct CollisionKernel<SHAPE_TYPE_SPHERE, SHAPE_TYPE_SPHERE> {
+  static bool is_overlapping(const Shape& shape_a, const Shape& shape_b, GjkCache*) {
+    const float radius_sum = (shape_a.c_scale_x + shape_b.c_scale_x)*0.5f;
+    float offset[3];
+
+    __vector_element_opV3(shape_a.c_position, -, shape_b.c_position, offset);
+    return __dot_productV3(offset, offset) < radius_sum*radius_sum;
+  }
+};
+
+template <>
+struct CollisionKernel<SHAPE_TYPE_SPHERE, SHAPE_TYPE_CAPSULE> {
+  static bool is_overlapping(const Shape& shape_a, const Shape& shape_b, GjkCache*) {
+    return is_swept_sphere_overlapping<SHAPE_TYPE_SPHERE, SHAPE_TYPE_CAPSULE>(shape_a, shape_b);
+  }
+};
+__swapped_collision_kernel(SHAPE_TYPE_CAPSULE, SHAPE_TYPE_SPHERE)
+
+template <>
+struct CollisionKernel<SHAPE_TYPE_CAPSULE, SHAPE_TYPE_CAPSULE> {
+  static bool is_overlapping(const Shape& shape_a, const Shape& shape_b, GjkCache*) {
+    return is_swept_sphere_overlapping<SHAPE_TYPE_CAPSULE, SHAPE_TYPE_CAPSULE>(shape_a, shape_b);
+  }
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,297 @@
+#include "CompoundShape.h"
+
+#include <cmath>
+using namespace std;
+
+#include "macro_constants.h"
+#include "vector3.h"
+
+// stores vector, given along the right, up and forward vectors of object, in world coordinates
+#define __object_vector_store(object, vector, store) \
+  for (int __i = 0; __i < 3; __i++) { \
+    store[__i] = \
+      (object).c_vector_right[__i]*vector[DIM_X] \
+      + (object).c_vector_up[__i]*vector[DIM_Y] \
+      + (object).c_vector_forward[__i]*vector[DIM_Z]; \
+  }
+
+// tests the bounding spheres first since they are the cheaper test, then the boxes
+static bool is_bounds_overlapping(
+  const float center_a[3], const float radius_a, const float min_a[3], const float max_a[3]
+  , const float center_b[3], const float radius_b, const float min_b[3], const float max_b[3]
+  )
+{
+  float offset[3];
+
+  __vector_element_opV3(center_a, -, center_b, offset);
+  if (__dot_productV3(offset, offset) > (radius_a + radius_b)*(radius_a + radius_b)) {
+    return false;
+  }
+
+  for (int i = 0; i < 3; i++) {
+    if (min_a[i] > max_b[i] || min_b[i] > max_a[i]) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+CompoundShape::CompoundShape() {
+  m_bounds_radius = 0.0f;
+  m_bounds_version = m_pose_version - 1;
+
+  __vector_element_assign_opV3(m_bounds_min, =, ZERO_VECTOR);
+  __vector_element_assign_opV3(m_bounds_max, =, ZERO_VECTOR);
+  __vector_element_assign_opV3(m_bounds_center, =, ZERO_VECTOR);
+}
+
+void CompoundShape::add_child(Shape* shape, const float offset[3], const float vector_right[3], const float vector_up[3], const float vector_forward[3]) {
+  ChildPose pose;
+
+  __vector_element_assign_opV3(pose.offset, =, offset);
+  __vector_element_assign_opV3(pose.vector_right, =, vector_right);
+  __vector_element_assign_opV3(pose.vector_up, =, vector_up);
+  __vector_element_assign_opV3(pose.vector_forward, =, vector_forward);
+
+  m_children.push_back(shape);
+  m_child_poses.push_back(pose);
+  child_update(m_children.size() - 1);
+}
+void CompoundShape::add_child(Shape* shape, const float offset[3]) {
+  add_child(shape, offset, UNIT_VECTOR_X, UNIT_VECTOR_Y, UNIT_VECTOR_Z);
+}
+
+void CompoundShape::clear_children() {
+  m_children.clear();
+  m_child_poses.clear();
+
+  // the versions left without the children could add up to the old sum
+  m_bounds_version = m_pose_version - 1;
+}
+
+void CompoundShape::move(const float distance_right, const float distance_up, const float distance_forward) {
+  Object::move(distance_right, distance_up, distance_forward);
+  children_update();
+}
+void CompoundShape::move(const float distance_vector[3]) {
+  Object::move(distance_vector);
+  children_update();
+}
+
+void CompoundShape::translate(const float vector_x, const float vector_y, const float vector_z) {
+  Object::translate(vector_x, vector_y, vector_z);
+  children_update();
+}
+void CompoundShape::translate(const float vector[3]) {
+  Object::translate(vector);
+  children_update();
+}
+
+void CompoundShape::translate_to(const float vector_x, const float vector_y, const float vector_z) {
+  Object::translate_to(vector_x, vector_y, vector_z);
+  children_update();
+}
+void CompoundShape::translate_to(const float vector[3]) {
+  Object::translate_to(vector);
+  children_update();
+}
+
+void CompoundShape::rotate_horizontal(const float angle) {
+  Object::rotate_horizontal(angle);
+  children_update();
+}
+void CompoundShape::rotate_vertical(const float angle) {
+  Object::rotate_vertical(angle);
+  children_update();
+}
+
+void CompoundShape::aabb_store(float min[3], float max[3]) const {
+  bounds_update();
+
+  __vector_element_assign_opV3(min, =, m_bounds_min);
+  __vector_element_assign_opV3(max, =, m_bounds_max);
+}
+
+void CompoundShape::bounding_sphere_store(float center[3], float& radius) const {
+  bounds_update();
+
+  __vector_element_assign_opV3(center, =, m_bounds_center);
+  radius = m_bounds_radius;
+}
+
+Shape* CompoundShape::get_overlapping_child(const Shape& shape) const {
+  float min[3];
+  float max[3];
+  float center[3];
+  float radius;
+
+  float child_min[3];
+  float child_max[3];
+  float child_center[3];
+  float child_radius;
+
+  bounds_update();
+  shape.aabb_store(min, max);
+  shape.bounding_sphere_store(center, radius);
+
+  if (!is_bounds_overlapping(m_bounds_center, m_bounds_radius, m_bounds_min, m_bounds_max, center, radius, min, max)) {
+    return NULL_SHAPE_PTR;
+  }
+
+  for (size_t i = 0; i < m_children.size(); i++) {
+    if (m_children[i] == &shape) {
+      continue;
+    }
+
+    m_children[i]->aabb_store(child_min, child_max);
+    m_children[i]->bounding_sphere_store(child_center, child_radius);
+
+    if (is_bounds_overlapping(child_center, child_radius, child_min, child_max, center, radius, min, max)
+      && m_children[i]->is_shape_inside(shape)
+      )
+    {
+      return m_children[i];
+    }
+  }
+
+  return NULL_SHAPE_PTR;
+}
+
+bool CompoundShape::is_overlapping(const Shape& shape) const {
+  return get_overlapping_child(shape) != NULL_SHAPE_PTR;
+}
+
+bool CompoundShape::is_overlapping(const CompoundShape& compound) const {
+  float min[3];
+  float max[3];
+  float center[3];
+  float radius;
+
+  bounds_update();
+  compound.bounds_update();
+
+  if (!is_bounds_overlapping(
+    m_bounds_center, m_bounds_radius, m_bounds_min, m_bounds_max
+    , compound.m_bounds_center, compound.m_bounds_radius, compound.m_bounds_min, compound.m_bounds_max
+    ))
+  {
+    return false;
+  }
+
+  // only children reaching into the bounds of the other compound are tested against its children
+  for (size_t i = 0; i < m_children.size(); i++) {
+    m_children[i]->aabb_store(min, max);
+    m_children[i]->bounding_sphere_store(center, radius);
+
+    if (is_bounds_overlapping(
+      center, radius, min, max
+      , compound.m_bounds_center, compound.m_bounds_radius, compound.m_bounds_min, compound.m_bounds_max
+      )
+      && compound.get_overlapping_child(*m_children[i]) != NULL_SHAPE_PTR
+      )
+    {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+bool CompoundShape::ray_cast(const float origin[3], const float direction[3], const float max_distance, float& distance, float normal[3]) const {
+  float child_distance;
+  float child_normal[3];
+
+  bool is_hit = false;
+  distance = max_distance;
+
+  for (size_t i = 0; i < m_children.size(); i++) {
+    if (m_children[i]->ray_cast(origin, direction, distance, child_distance, child_normal)) {
+      is_hit = true;
+      distance = child_distance;
+      __vector_element_assign_opV3(normal, =, child_normal);
+    }
+  }
+
+  return is_hit;
+}
+
+void CompoundShape::draw_GLUT() const {
+  for (size_t i = 0; i < m_children.size(); i++) {
+    m_children[i]->draw_GLUT();
+  }
+}
+
+void CompoundShape::child_update(const size_t index) {
+  const ChildPose& pose = m_child_poses[index];
+
+  float position[3];
+  float vector_right[3];
+  float vector_up[3];
+  float vector_forward[3];
+
+  __object_vector_store(*this, pose.offset, position);
+  __vector_element_assign_opV3(position, +=, m_position);
+
+  __object_vector_store(*this, pose.vector_right, vector_right);
+  __object_vector_store(*this, pose.vector_up, vector_up);
+  __object_vector_store(*this, pose.vector_forward, vector_forward);
+
+  m_children[index]->set_basis(vector_right, vector_up, vector_forward);
+  m_children[index]->translate_to(position);
+}
+
+void CompoundShape::children_update() {
+  for (size_t i = 0; i < m_children.size(); i++) {
+    child_update(i);
+  }
+}
+
+void CompoundShape::bounds_update() const {
+  float min[3];
+  float max[3];
+  float center[3];
+  float offset[3];
+  float radius;
+
+  unsigned int version = m_pose_version;
+  for (size_t i = 0; i < m_children.size(); i++) {
+    version += m_children[i]->c_pose_version;
+  }
+
+  if (version == m_bounds_version) {
+    return;
+  }
+
+  if (m_children.empty()) {
+    __vector_element_assign_opV3(m_bounds_min, =, m_position);
+    __vector_element_assign_opV3(m_bounds_max, =, m_position);
+    __vector_element_assign_opV3(m_bounds_center, =, m_position);
+    m_bounds_radius = 0.0f;
+    m_bounds_version = version;
+    return;
+  }
+
+  m_children[0]->aabb_store(m_bounds_min, m_bounds_max);
+  for (size_t i = 1; i < m_children.size(); i++) {
+    m_children[i]->aabb_store(min, max);
+    for (int j = 0; j < 3; j++) {
+      m_bounds_min[j] = fminf(m_bounds_min[j], min[j]);
+      m_bounds_max[j] = fmaxf(m_bounds_max[j], max[j]);
+    }
+  }
+
+  // center the sphere on the box and grow it over the sphere of every child
+  for (int j = 0; j < 3; j++) {
+    m_bounds_center[j] = (m_bounds_min[j] + m_bounds_max[j])*0.5f;
+  }
+
+  m_bounds_radius = 0.0f;
+  for (size_t i = 0; i < m_children.size(); i++) {
+    m_children[i]->bounding_sphere_store(center, radius);
+    __vector_element_opV3(center, -, m_bounds_center, offset);
+    m_bounds_radius = fmaxf(m_bounds_radius, __magnitudeV3(offset) + radius);
+  }
+
+  m_bounds_version = version;
+}
\ No newline at end of file
@@ -0,0 +1,81 @@
+#ifndef COMPOUND_SHAPE_H
+#define COMPOUND_SHAPE_H
+
+#include <cstddef>
+#include <vector>
+
+#include "Object.h"
+#include "Shape.h"
+
+// a group of child shapes posed relative to one parent transform, such as the body, cabin and wheels of a car, which
+// tests its children only once its own bounds overlap; it is not a Shape, so the kernel table and SpatialIndex do not
+// see it, and callers test it through is_overlapping
+class CompoundShape : public Object {
+public:
+  CompoundShape();
+
+  // children in the order they were added; the compound does not own them
+  const std::vector<Shape*>& c_children = m_children;
+
+  // places shape at offset along the right, up and forward vectors of the compound, with its basis given in the same
+  // frame
+  void add_child(Shape* shape, const float offset[3], const float vector_right[3], const float vector_up[3], const float vector_forward[3]);
+  void add_child(Shape* shape, const float offset[3]);
+
+  void clear_children();
+
+  void move(const float distance_right, const float distance_up, const float distance_forward);
+  void move(const float distance_vector[3]);
+
+  void translate(const float vector_x, const float vector_y, const float vector_z);
+  void translate(const float vector[3]);
+
+  void translate_to(const float vector_x, const float vector_y, const float vector_z);
+  void translate_to(const float vector[3]);
+
+  void rotate_horizontal(const float angle);
+  void rotate_vertical(const float angle);
+
+  // bounds of every child, cached until the compound or a child changes
+  void aabb_store(float min[3], float max[3]) const;
+  void bounding_sphere_store(float center[3], float& radius) const;
+
+  // yields the first child overlapping shape, or NULL_SHAPE_PTR
+  Shape* get_overlapping_child(const Shape& shape) const;
+
+  bool is_overlapping(const Shape& shape) const;
+  bool is_overlapping(const CompoundShape& compound) const;
+
+  bool ray_cast(const float origin[3], const float direction[3], const float max_distance, float& distance, float normal[3]) const;
+
+  void draw_GLUT() const;
+
+private:
+  // pose of a child in the frame of the compound
+  struct ChildPose {
+    float offset[3];
+    float vector_right[3];
+    float vector_up[3];
+    float vector_forward[3];
+  };
+
+  std::vector<Shape*> m_children;
+  std::vector<ChildPose> m_child_poses;
+
+  mutable float m_bounds_min[3];
+  mutable float m_bounds_max[3];
+  mutable float m_bounds_center[3];
+  mutable float m_bounds_radius;
+
+  // sum of the pose versions of the compound and its children when the bounds were found, which changes whenever any
+  // of them does since each only grows
+  mutable unsigned int m_bounds_version;
+
+  // moves the child at index to its pose under the current transform of the compound
+  void child_update(const size_t index);
+  void children_update();
+
+  void bounds_update() const;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,514 @@
+#include "Contact.h"
+
+#include <cmath>
+#include <cfloat>
+using namespace std;
+
+#include "vector3.h"
+
+// keeps the CONTACT_MAX_POINTS deepest candidate points of contact, ordered deepest first
+static void contact_point_add(Contact& contact, float depths[CONTACT_MAX_POINTS], const float point[3], const float depth) {
+  int i = contact.point_count < CONTACT_MAX_POINTS ? contact.point_count++ : CONTACT_MAX_POINTS;
+
+  // shift shallower points down to open a slot
+  for (; i > 0 && depths[i - 1] < depth; i--) {
+    if (i < CONTACT_MAX_POINTS) {
+      depths[i] = depths[i - 1];
+      __vector_element_assign_opV3(contact.points[i], =, contact.points[i - 1]);
+    }
+  }
+
+  if (i < CONTACT_MAX_POINTS) {
+    depths[i] = depth;
+    __vector_element_assign_opV3(contact.points[i], =, point);
+  }
+}
+
+static void cuboid_corners_store(const Shape& shape, float corners[8][3]) {
+  for (int i = 0; i < 8; i++) {
+    const float x = (i & 1 ? 0.5f : -0.5f)*shape.c_scale_x;
+    const float y = (i & 2 ? 0.5f : -0.5f)*shape.c_scale_y;
+    const float z = (i & 4 ? 0.5f : -0.5f)*shape.c_scale_z;
+
+    for (int j = 0; j < 3; j++) {
+      corners[i][j] = shape.c_position[j] + shape.c_vector_right[j]*x + shape.c_vector_up[j]*y + shape.c_vector_forward[j]*z;
+    }
+  }
+}
+
+static bool is_point_inside_cuboid(const Shape& shape, const float point[3]) {
+  float offset[3];
+
+  __vector_element_opV3(point, -, shape.c_position, offset);
+  return fabsf(__dot_productV3(offset, shape.c_vector_right)) <= shape.c_scale_x*0.5f + CONTACT_SLOP
+    && fabsf(__dot_productV3(offset, shape.c_vector_up)) <= shape.c_scale_y*0.5f + CONTACT_SLOP
+    && fabsf(__dot_productV3(offset, shape.c_vector_forward)) <= shape.c_scale_z*0.5f + CONTACT_SLOP;
+}
+
+// finds the axis of least overlap among the 15 separating axes of two cuboids, then takes the corners of each cuboid
+// inside the other as the points of contact
+static bool cuboid_contact_store(const Shape& shape_a, const Shape& shape_b, Contact& contact) {
+  const float* axes_a[3] = { shape_a.c_vector_right, shape_a.c_vector_up, shape_a.c_vector_forward };
+  const float* axes_b[3] = { shape_b.c_vector_right, shape_b.c_vector_up, shape_b.c_vector_forward };
+  const float half_a[3] = { shape_a.c_scale_x*0.5f, shape_a.c_scale_y*0.5f, shape_a.c_scale_z*0.5f };
+  const float half_b[3] = { shape_b.c_scale_x*0.5f, shape_b.c_scale_y*0.5f, shape_b.c_scale_z*0.5f };
+
+  float offset[3];
+  float axis[3];
+  float corners[8][3];
+  float depths[CONTACT_MAX_POINTS];
+  float edge_a[3];
+  float edge_b[3];
+  int axis_index = 0;
+  GjkResult result;
+
+  __vector_element_opV3(shape_b.c_position, -, shape_a.c_position, offset);
+  contact.depth = FLT_MAX;
+
+  for (int i = 0; i < 15; i++) {
+    if (i < 3) {
+      __vector_element_assign_opV3(axis, =, axes_a[i]);
+    }
+    else if (i < 6) {
+      __vector_element_assign_opV3(axis, =, axes_b[i - 3]);
+    }
+    else {
+      __cross_productV3(axes_a[(i - 6) / 3], axes_b[(i - 6) % 3], axis);
+
+      const float length_squared = __dot_productV3(axis, axis);
+      if (length_squared < CONTACT_AXIS_EPSILON) {
+        continue;
+      }
+      __vector_scalar_assign_opV3(axis, /=, sqrtf(length_squared));
+    }
+
+    float radius_a = 0.0f;
+    float radius_b = 0.0f;
+    for (int j = 0; j < 3; j++) {
+      radius_a += half_a[j]*fabsf(__dot_productV3(axis, axes_a[j]));
+      radius_b += half_b[j]*fabsf(__dot_productV3(axis, axes_b[j]));
+    }
+
+    const float distance = __dot_productV3(axis, offset);
+    const float overlap = radius_a + radius_b - fabsf(distance);
+
+    if (overlap <= 0.0f) {
+      return false;
+    }
+
+    if (i < 6 ? overlap < contact.depth : overlap < contact.depth*CONTACT_EDGE_AXIS_BIAS) {
+      contact.depth = overlap;
+      axis_index = i;
+      __vector_scalar_opV3(axis, *, (distance < 0.0f ? -1.0f : 1.0f), contact.normal);
+    }
+  }
+
+  // corners of shape_a reach past the back of shape_b along the normal and corners of shape_b past the front of shape_a
+  const float back_b = __dot_productV3(shape_b.c_position, contact.normal) - contact.depth;
+  const float front_a = __dot_productV3(shape_a.c_position, contact.normal) + contact.depth;
+
+  contact.point_count = 0;
+
+  cuboid_corners_store(shape_a, corners);
+  for (int i = 0; i < 8; i++) {
+    if (is_point_inside_cuboid(shape_b, corners[i])) {
+      contact_point_add(contact, depths, corners[i], __dot_productV3(corners[i], contact.normal) - back_b);
+    }
+  }
+
+  cuboid_corners_store(shape_b, corners);
+  for (int i = 0; i < 8; i++) {
+    if (is_point_inside_cuboid(shape_a, corners[i])) {
+      contact_point_add(contact, depths, corners[i], front_a - __dot_productV3(corners[i], contact.normal));
+    }
+  }
+
+  // cuboids crossing through each others faces without a corner inside either touch around the deepest points EPA finds
+  if (contact.point_count == 0 && axis_index < 6) {
+    gjk_query(shape_a, shape_b, result);
+
+    __vector_element_opV3(result.point_a, +, result.point_b, contact.points[0]);
+    __vector_scalar_assign_opV3(contact.points[0], *=, 0.5f);
+    contact.point_count = 1;
+  }
+
+  // edges crossing without a corner inside either cuboid touch midway between the closest points of the edge of
+  // shape_a furthest along the normal and the edge of shape_b furthest against it
+  if (contact.point_count == 0) {
+    const int edge_axis_a = (axis_index - 6) / 3;
+    const int edge_axis_b = (axis_index - 6) % 3;
+
+    __vector_element_assign_opV3(edge_a, =, shape_a.c_position);
+    __vector_element_assign_opV3(edge_b, =, shape_b.c_position);
+    for (int j = 0; j < 3; j++) {
+      if (j != edge_axis_a) {
+        const float side = __dot_productV3(axes_a[j], contact.normal) < 0.0f ? -half_a[j] : half_a[j];
+        __vector_element_op_and_scalar_opV3(edge_a, +, axes_a[j], *, side, edge_a);
+      }
+      if (j != edge_axis_b) {
+        const float side = __dot_productV3(axes_b[j], contact.normal) < 0.0f ? half_b[j] : -half_b[j];
+        __vector_element_op_and_scalar_opV3(edge_b, +, axes_b[j], *, side, edge_b);
+      }
+    }
+
+    // find the closest points of the lines through the centers of the edges
+    const float* direction_a = axes_a[edge_axis_a];
+    const float* direction_b = axes_b[edge_axis_b];
+    const float cosine = __dot_productV3(direction_a, direction_b);
+    const float denominator = 1.0f - cosine*cosine;
+
+    __vector_element_opV3(edge_a, -, edge_b, offset);
+
+    float parameter_a = 0.0f;
+    float parameter_b = 0.0f;
+    if (denominator > CONTACT_AXIS_EPSILON) {
+      const float projection_a = __dot_productV3(direction_a, offset);
+      const float projection_b = __dot_productV3(direction_b, offset);
+
+      parameter_a = fminf(fmaxf((cosine*projection_b - projection_a) / denominator, -half_a[edge_axis_a]), half_a[edge_axis_a]);
+      parameter_b = fminf(fmaxf((projection_b - cosine*projection_a) / denominator, -half_b[edge_axis_b]), half_b[edge_axis_b]);
+    }
+
+    for (int j = 0; j < 3; j++) {
+      contact.points[0][j] = (edge_a[j] + direction_a[j]*parameter_a + edge_b[j] + direction_b[j]*parameter_b)*0.5f;
+    }
+    contact.point_count = 1;
+  }
+
+  return true;
+}
+
+// finds the axis of least overlap among the 13 separating axes of a triangle and a cuboid, the same axes
+// TriangleMesh tests, storing in normal the direction from the triangle towards the cuboid
+static bool triangle_cuboid_depth_store(const float corners[9], const Shape& shape, float& depth, float normal[3]) {
+  const float* axes[3] = { shape.c_vector_right, shape.c_vector_up, shape.c_vector_forward };
+  const float half[3] = { shape.c_scale_x*0.5f, shape.c_scale_y*0.5f, shape.c_scale_z*0.5f };
+
+  float edges[3][3];
+  float axis[3];
+
+  __vector_element_opV3((corners + 3), -, corners, edges[0]);
+  __vector_element_opV3((corners + 6), -, (corners + 3), edges[1]);
+  __vector_element_opV3(corners, -, (corners + 6), edges[2]);
+
+  // the face axes of the cuboid are never skipped, so this is only kept should every overlap be infinite
+  depth = FLT_MAX;
+  __vector_element_assign_opV3(normal, =, UNIT_VECTOR_Y);
+
+  for (int i = 0; i < 13; i++) {
+    if (i < 3) {
+      __vector_element_assign_opV3(axis, =, axes[i]);
+    }
+    else {
+      if (i == 3) {
+        __cross_productV3(edges[0], edges[1], axis);
+      }
+      else {
+        __cross_productV3(axes[(i - 4) / 3], edges[(i - 4) % 3], axis);
+      }
+
+      const float length_squared = __dot_productV3(axis, axis);
+      if (length_squared < CONTACT_AXIS_EPSILON) {
+        continue;
+      }
+      __vector_scalar_assign_opV3(axis, /=, sqrtf(length_squared));
+    }
+
+    float radius = 0.0f;
+    for (int j = 0; j < 3; j++) {
+      radius += half[j]*fabsf(__dot_productV3(axis, axes[j]));
+    }
+
+    const float center = __dot_productV3(axis, shape.c_position);
+    const float projection_0 = __dot_productV3(axis, corners);
+    const float projection_1 = __dot_productV3(axis, (corners + 3));
+    const float projection_2 = __dot_productV3(axis, (corners + 6));
+
+    // the cuboid leaves the triangle by moving up past its highest corner or down past its lowest
+    const float overlap_up = fmaxf(fmaxf(projection_0, projection_1), projection_2) - (center - radius);
+    const float overlap_down = center + radius - fminf(fminf(projection_0, projection_1), projection_2);
+    const float overlap = fminf(overlap_up, overlap_down);
+
+    if (overlap <= 0.0f) {
+      return false;
+    }
+
+    if (i < 4 ? overlap < depth : overlap < depth*CONTACT_EDGE_AXIS_BIAS) {
+      depth = overlap;
+      __vector_scalar_opV3(axis, *, (overlap_up < overlap_down ? 1.0f : -1.0f), normal);
+    }
+  }
+
+  return true;
+}
+
+static void triangle_normal_store(const float corners[9], float normal[3]) {
+  float edge_0[3];
+  float edge_1[3];
+
+  __vector_element_opV3((corners + 3), -, corners, edge_0);
+  __vector_element_opV3((corners + 6), -, corners, edge_1);
+  __cross_productV3(edge_0, edge_1, normal);
+}
+
+// whether point lies over the triangle when seen along the normal of the triangle
+static bool is_point_over_triangle(const float corners[9], const float triangle_normal[3], const float point[3]) {
+  float edge[3];
+  float offset[3];
+  float side[3];
+
+  for (int i = 0; i < 3; i++) {
+    const float* corner = corners + i*3;
+    const float* next = corners + ((i + 1) % 3)*3;
+
+    __vector_element_opV3(next, -, corner, edge);
+    __vector_element_opV3(point, -, corner, offset);
+    __cross_productV3(edge, offset, side);
+    if (__dot_productV3(side, triangle_normal) < 0.0f) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+// takes the corners of the cuboid over the triangle and below its top along the normal, and the corners of the triangle
+// inside the cuboid, as points of contact
+static void triangle_cuboid_points_add(const float corners[9], const Shape& shape, Contact& contact, float depths[CONTACT_MAX_POINTS], const float normal[3]) {
+  float cuboid_corners[8][3];
+  float triangle_normal[3];
+
+  triangle_normal_store(corners, triangle_normal);
+
+  const float top = fmaxf(fmaxf(__dot_productV3(corners, normal), __dot_productV3((corners + 3), normal)), __dot_productV3((corners + 6), normal));
+  float bottom = FLT_MAX;
+
+  cuboid_corners_store(shape, cuboid_corners);
+  for (int i = 0; i < 8; i++) {
+    const float projection = __dot_productV3(cuboid_corners[i], normal);
+
+    bottom = fminf(bottom, projection);
+    if (projection < top && is_point_over_triangle(corners, triangle_normal, cuboid_corners[i])) {
+      contact_point_add(contact, depths, cuboid_corners[i], top - projection);
+    }
+  }
+
+  for (int i = 0; i < 3; i++) {
+    if (is_point_inside_cuboid(shape, corners + i*3)) {
+      contact_point_add(contact, depths, corners + i*3, __dot_productV3((corners + i*3), normal) - bottom);
+    }
+  }
+}
+
+// finds the deepest contact between the triangles of a mesh and a convex shape, storing in contact the normal from the
+// mesh towards the shape; cuboids use the separating axes of each triangle and other shapes use EPA on each triangle
+static bool mesh_contact_store(const Shape& mesh_shape, const Shape& shape, Contact& contact) {
+  thread_local vector<int> triangle_indices;
+
+  float corners[9];
+  float deepest_corners[9];
+  float depths[CONTACT_MAX_POINTS];
+  float normal[3];
+  float triangle_normal[3];
+  float deepest_normal[3];
+  float depth;
+  GjkResult result;
+
+  if (mesh_shape.c_mesh == nullptr) {
+    return false;
+  }
+
+  mesh_shape.mesh_triangles_store(shape, triangle_indices);
+
+  contact.depth = -1.0f;
+  contact.point_count = 0;
+
+  for (const int triangle_index : triangle_indices) {
+    mesh_shape.mesh_triangle_store(triangle_index, corners);
+
+    if (shape.c_shape_type == SHAPE_TYPE_CUBOID) {
+      if (!triangle_cuboid_depth_store(corners, shape, depth, normal)) {
+        continue;
+      }
+    }
+    else {
+      if (!gjk_query_triangle(shape, corners, result)) {
+        continue;
+      }
+
+      // the result runs from the shape towards the triangle
+      depth = result.depth;
+      __negativeV3(result.normal, normal);
+    }
+
+    if (depth > contact.depth) {
+      contact.depth = depth;
+      __vector_element_assign_opV3(contact.normal, =, normal);
+      for (int i = 0; i < 9; i++) {
+        deepest_corners[i] = corners[i];
+      }
+    }
+  }
+
+  if (contact.depth < 0.0f) {
+    return false;
+  }
+
+  if (shape.c_shape_type != SHAPE_TYPE_CUBOID) {
+    // only the deepest triangle touches where EPA found it
+    gjk_query_triangle(shape, deepest_corners, result);
+    __vector_element_opV3(result.point_a, +, result.point_b, contact.points[0]);
+    __vector_scalar_assign_opV3(contact.points[0], *=, 0.5f);
+    contact.point_count = 1;
+    return true;
+  }
+
+  // a cuboid resting across several triangles of a flat stretch of the mesh touches all of them
+  triangle_normal_store(deepest_corners, deepest_normal);
+  normalizeV3(deepest_normal);
+
+  contact.point_count = 0;
+  for (const int triangle_index : triangle_indices) {
+    mesh_shape.mesh_triangle_store(triangle_index, corners);
+    triangle_normal_store(corners, triangle_normal);
+
+    const float length = sqrtf(__dot_productV3(triangle_normal, triangle_normal));
+    if (length > 0.0f && fabsf(__dot_productV3(triangle_normal, deepest_normal)) >= length*(1.0f - CONTACT_SLOP)) {
+      triangle_cuboid_points_add(corners, shape, contact, depths, contact.normal);
+    }
+  }
+
+  // a cuboid crossing the edge of a triangle without a corner of either inside the other touches around the points EPA
+  // finds
+  if (contact.point_count == 0) {
+    gjk_query_triangle(shape, deepest_corners, result);
+    __vector_element_opV3(result.point_a, +, result.point_b, contact.points[0]);
+    __vector_scalar_assign_opV3(contact.points[0], *=, 0.5f);
+    contact.point_count = 1;
+  }
+
+  return true;
+}
+
+bool contact_store(const Shape& shape_a, const Shape& shape_b, Contact& contact, GjkCache* cache) {
+  GjkResult result;
+
+  contact.shape_a = &shape_a;
+  contact.shape_b = &shape_b;
+
+  if (shape_a.c_shape_type == SHAPE_TYPE_CUBOID && shape_b.c_shape_type == SHAPE_TYPE_CUBOID) {
+    return cuboid_contact_store(shape_a, shape_b, contact);
+  }
+
+  // meshes are surfaces, so two of them have no contact, as their kernel has no overlap
+  if (shape_a.c_shape_type == SHAPE_TYPE_MESH && shape_b.c_shape_type == SHAPE_TYPE_MESH) {
+    return false;
+  }
+
+  if (shape_a.c_shape_type == SHAPE_TYPE_MESH) {
+    return mesh_contact_store(shape_a, shape_b, contact);
+  }
+
+  if (shape_b.c_shape_type == SHAPE_TYPE_MESH) {
+    if (!mesh_contact_store(shape_b, shape_a, contact)) {
+      return false;
+    }
+
+    __negativeV3(contact.normal, contact.normal);
+    return true;
+  }
+
+  if (!gjk_query(shape_a, shape_b, result, cache)) {
+    return false;
+  }
+
+  contact.depth = result.depth;
+  __vector_element_assign_opV3(contact.normal, =, result.normal);
+
+  __vector_element_opV3(result.point_a, +, result.point_b, contact.points[0]);
+  __vector_scalar_assign_opV3(contact.points[0], *=, 0.5f);
+  contact.point_count = 1;
+
+  return true;
+}
+
+int resolve_contacts(
+  Shape& shape
+  , const vector<Shape*>& obstacles
+  , float push_store[3]
+  , GjkCacheTable* caches
+  , vector<const Shape*>* touched_store
+  )
+{
+  Contact contact;
+  Contact deepest;
+  CollisionFunction is_overlapping;
+  bool is_cached;
+  GjkCache pair_cache;
+  GjkCache* cache;
+  float push[3];
+  int shape_type;
+  int resolved_count = 0;
+
+  __vector_element_assign_opV3(push_store, =, ZERO_VECTOR);
+
+  for (int iteration = 0; iteration < CONTACT_RESOLVE_ITERATIONS; iteration++) {
+    deepest.depth = -1.0f;
+    size_t i = 0;
+
+    while (i < obstacles.size()) {
+      // look up the kernel once for the whole group of this type and only find contacts for shapes it reports
+      shape_type = obstacles[i]->c_shape_type;
+      is_overlapping = Shape::collision_function(shape.c_shape_type, shape_type);
+      is_cached = caches != nullptr && Shape::is_collision_cached(shape.c_shape_type, shape_type);
+
+      for (; i < obstacles.size() && obstacles[i]->c_shape_type == shape_type; i++) {
+        if (&shape == obstacles[i]) {
+          continue;
+        }
+
+        // only GJK kernels read the cache, and it is only kept for pairs that overlap, so the table does not grow with
+        // every pair ever tested
+        cache = nullptr;
+        if (is_cached) {
+          GjkCache* found = caches->find(&shape, obstacles[i]);
+
+          pair_cache = found != nullptr ? *found : GjkCache();
+          cache = &pair_cache;
+        }
+
+        if (!is_overlapping(shape, *obstacles[i], cache)) {
+          if (is_cached) {
+            caches->remove(&shape, obstacles[i]);
+          }
+          continue;
+        }
+
+        if (is_cached) {
+          cache = &caches->get(&shape, obstacles[i]);
+          *cache = pair_cache;
+        }
+
+        if (contact_store(shape, *obstacles[i], contact, cache) && contact.depth > deepest.depth) {
+          deepest = contact;
+        }
+      }
+    }
+
+    if (deepest.depth < 0.0f) {
+      break;
+    }
+
+    // shape is shape_a of the contact, so it moves against the normal
+    __vector_scalar_opV3(deepest.normal, *, -(deepest.depth + CONTACT_SLOP), push);
+    shape.translate(push);
+    __vector_element_assign_opV3(push_store, +=, push);
+    resolved_count++;
+
+    if (touched_store != nullptr) {
+      touched_store->push_back(deepest.shape_b);
+    }
+  }
+
+  return resolved_count;
+}
\ No newline at end of file
@@ -0,0 +1,52 @@
+#ifndef CONTACT_H
+#define CONTACT_H
+
+#include <vector>
+
+#include "Shape.h"
+#include "Gjk.h"
+
+#define CONTACT_MAX_POINTS 4
+
+// passes the resolver makes over the shapes, each pushing out of the deepest contact left
+#define CONTACT_RESOLVE_ITERATIONS 4
+
+// distance shapes are pushed past touching so that the next test does not find the same contact again
+#define CONTACT_SLOP 1e-3f
+
+// cross products of nearly parallel edges shorter than this are not used as separating axes
+#define CONTACT_AXIS_EPSILON 1e-6f
+
+// an edge axis is only taken over a face axis when it is shallower by this factor, since face contacts are steadier
+#define CONTACT_EDGE_AXIS_BIAS 0.95f
+
+// how far and along which direction two shapes overlap, with the points where they touch
+struct Contact {
+  const Shape* shape_a;
+  const Shape* shape_b;
+
+  // unit vector from shape_a towards shape_b along which moving shape_b by depth separates them
+  float normal[3];
+  float depth;
+
+  // world points between the surfaces of the shapes, deepest first
+  int point_count;
+  float points[CONTACT_MAX_POINTS][3];
+};
+
+// finds the contact of overlapping shapes, returning false when they are apart; a mesh touches through its deepest
+// triangle, and convex pairs other than two cuboids go through EPA
+bool contact_store(const Shape& shape_a, const Shape& shape_b, Contact& contact, GjkCache* cache = nullptr);
+
+// pushes shape out of the shapes in obstacles, deepest contact first, returning the number of contacts resolved and
+// storing the total push in push_store; obstacles must be grouped by shape type, and each shape resolved is appended to
+// touched_store when it is not null
+int resolve_contacts(
+  Shape& shape
+  , const std::vector<Shape*>& obstacles
+  , float push_store[3]
+  , GjkCacheTable* caches = nullptr
+  , std::vector<const Shape*>* touched_store = nullptr
+  );
+
+#endif
\ No newline at end of file
@@ -0,0 +1,492 @@
+#include "FrameCapture.h"
+
+// reads frames back through pixel buffer objects when the context allows it, which needs GLEW to build
+#define CAPTURE_PIXEL_BUFFERS 1
+
+#if CAPTURE_PIXEL_BUFFERS
+#include <gl/glew.h>
+#endif
+#include <gl/glut.h>
+#include <gl/gl.h>
+
+#include <cstring>
+#include <algorithm>
+using namespace std;
+
+// bytes of image data in each stored deflate block, which holds at most 65535
+#define PNG_STORED_BLOCK_SIZE 65535
+
+static const unsigned char PNG_SIGNATURE[8] = { 137, 'P', 'N', 'G', '\r', '\n', 26, '\n' };
+
+static unsigned int crc32_update(unsigned int crc, const unsigned char* data, const size_t size) {
+  static unsigned int table[256];
+  static bool is_table_built = false;
+
+  if (!is_table_built) {
+    for (unsigned int i = 0; i < 256; i++) {
+      unsigned int value = i;
+      for (int bit = 0; bit < 8; bit++) {
+        value = (value & 1) ? 0xedb88320u ^ (value >> 1) : value >> 1;
+      }
+      table[i] = value;
+    }
+    is_table_built = true;
+  }
+
+  for (size_t i = 0; i < size; i++) {
+    crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+  }
+  return crc;
+}
+
+static void put_big_endian(vector<unsigned char>& bytes, const unsigned int value) {
+  bytes.push_back((unsigned char)(value >> 24));
+  bytes.push_back((unsigned char)(value >> 16));
+  bytes.push_back((unsigned char)(value >> 8));
+  bytes.push_back((unsigned char)value);
+}
+
+// writes the chunk of type with data from bytes[begin, end)
+static void png_chunk_write(FILE* file, const char type[4], const vector<unsigned char>& bytes, const size_t begin, const size_t end) {
+  unsigned char header[8];
+  unsigned char footer[4];
+
+  const unsigned int size = (unsigned int)(end - begin);
+  unsigned int crc = 0xffffffffu;
+
+  for (int i = 0; i < 4; i++) {
+    header[i] = (unsigned char)(size >> (24 - i*8));
+    header[4 + i] = (unsigned char)type[i];
+  }
+
+  crc = crc32_update(crc, header + 4, 4);
+  crc = crc32_update(crc, bytes.data() + begin, size);
+  crc ^= 0xffffffffu;
+
+  for (int i = 0; i < 4; i++) {
+    footer[i] = (unsigned char)(crc >> (24 - i*8));
+  }
+
+  fwrite(header, 1, 8, file);
+  fwrite(bytes.data() + begin, 1, size, file);
+  fwrite(footer, 1, 4, file);
+}
+
+FrameCapture::FrameCapture() {
+  m_is_open = false;
+  m_is_pixel_buffered = false;
+  m_is_y4m = false;
+
+  m_frame_rate = DEFAULT_CAPTURE_FRAME_RATE;
+  m_file = NULL;
+
+  m_stream_width = 0;
+  m_stream_height = 0;
+
+  m_frame_count = 0;
+  m_stall_count = 0;
+  m_drop_count = 0;
+
+  for (int i = 0; i < CAPTURE_READBACK_BUFFERS; i++) {
+    m_pixel_buffers[i] = 0;
+    m_pixel_buffer_sizes[i] = 0;
+    m_readback_widths[i] = 0;
+    m_readback_heights[i] = 0;
+    m_is_readback_pending[i] = false;
+  }
+  m_readback_next = 0;
+
+  m_is_encoding = false;
+  m_is_stopping = false;
+}
+
+FrameCapture::~FrameCapture() {
+  // the context may already be gone, so frames still being read back are dropped
+  encoder_stop();
+}
+
+bool FrameCapture::open(const char* path, const int frame_rate) {
+  const size_t length = strlen(path);
+
+  if (m_is_open) {
+    return false;
+  }
+
+  m_path = path;
+  m_frame_rate = frame_rate > 0 ? frame_rate : DEFAULT_CAPTURE_FRAME_RATE;
+  m_is_y4m = length >= 4 && strcmp(path + length - 4, ".y4m") == 0;
+
+  // the stream header waits for the size of the first frame
+  if (m_is_y4m) {
+    m_file = fopen(path, "wb");
+    if (m_file == NULL) {
+      return false;
+    }
+  }
+
+  m_stream_width = 0;
+  m_stream_height = 0;
+  m_frame_count = 0;
+  m_stall_count = 0;
+  m_drop_count = 0;
+
+  m_is_stopping = false;
+  m_encoder = thread(&FrameCapture::encoder_loop, this);
+
+  m_is_open = true;
+  return true;
+}
+
+bool FrameCapture::readback_init() {
+#if CAPTURE_PIXEL_BUFFERS
+  if (m_is_pixel_buffered) {
+    return true;
+  }
+
+  if (glewInit() != GLEW_OK || !(GLEW_VERSION_2_1 || GLEW_ARB_pixel_buffer_object)) {
+    return false;
+  }
+
+  glGenBuffers(CAPTURE_READBACK_BUFFERS, m_pixel_buffers);
+
+  m_is_pixel_buffered = true;
+  return true;
+#else
+  return false;
+#endif
+}
+
+void FrameCapture::read_framebuffer(const int width, const int height) {
+  if (!m_is_open || width <= 0 || height <= 0) {
+    return;
+  }
+
+#if CAPTURE_PIXEL_BUFFERS
+  if (m_is_pixel_buffered) {
+    const int index = m_readback_next;
+    const int size = width*height*4;
+
+    // the oldest read was started CAPTURE_READBACK_BUFFERS - 1 frames ago, so it has long finished
+    if (m_is_readback_pending[index]) {
+      readback_take(index);
+    }
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, m_pixel_buffers[index]);
+    if (size > m_pixel_buffer_sizes[index]) {
+      glBufferData(GL_PIXEL_PACK_BUFFER, size, nullptr, GL_STREAM_READ);
+      m_pixel_buffer_sizes[index] = size;
+    }
+
+    // returns at once, copying into the buffer once drawing is done
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, (void*)0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    m_readback_widths[index] = width;
+    m_readback_heights[index] = height;
+    m_is_readback_pending[index] = true;
+    m_readback_next = (index + 1) % CAPTURE_READBACK_BUFFERS;
+    return;
+  }
+#endif
+
+  Frame frame;
+  frame_take(width, height, true, true, frame);
+
+  glPixelStorei(GL_PACK_ALIGNMENT, 4);
+  glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, frame.pixels.data());
+
+  frame_push(frame);
+}
+
+void FrameCapture::readback_take(const int index) {
+#if CAPTURE_PIXEL_BUFFERS
+  const int width = m_readback_widths[index];
+  const int height = m_readback_heights[index];
+
+  m_is_readback_pending[index] = false;
+
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, m_pixel_buffers[index]);
+  const unsigned char* pixels = (const unsigned char*)glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+
+  if (pixels != nullptr) {
+    Frame frame;
+    frame_take(width, height, true, true, frame);
+
+    copy(pixels, pixels + width*height*4, frame.pixels.begin());
+    frame_push(frame);
+
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+  }
+
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+#endif
+}
+
+void FrameCapture::submit(const unsigned int* pixels, const int width, const int height) {
+  pixels_submit(pixels, width, height, true);
+}
+
+bool FrameCapture::try_submit(const unsigned int* pixels, const int width, const int height) {
+  return pixels_submit(pixels, width, height, false);
+}
+
+bool FrameCapture::pixels_submit(const unsigned int* pixels, const int width, const int height, const bool is_waiting) {
+  Frame frame;
+
+  if (!m_is_open || width <= 0 || height <= 0) {
+    return false;
+  }
+
+  if (!frame_take(width, height, false, is_waiting, frame)) {
+    return false;
+  }
+
+  for (int i = 0; i < width*height; i++) {
+    frame.pixels[i*4] = (unsigned char)(pixels[i] & 0xff);
+    frame.pixels[i*4 + 1] = (unsigned char)((pixels[i] >> 8) & 0xff);
+    frame.pixels[i*4 + 2] = (unsigned char)((pixels[i] >> 16) & 0xff);
+    frame.pixels[i*4 + 3] = (unsigned char)((pixels[i] >> 24) & 0xff);
+  }
+
+  frame_push(frame);
+  return true;
+}
+
+void FrameCapture::close() {
+  if (!m_is_open) {
+    return;
+  }
+
+  // take the reads still in flight, oldest first
+  for (int i = 0; i < CAPTURE_READBACK_BUFFERS; i++) {
+    const int index = (m_readback_next + i) % CAPTURE_READBACK_BUFFERS;
+
+    if (m_is_readback_pending[index]) {
+      readback_take(index);
+    }
+  }
+
+  encoder_stop();
+}
+
+bool FrameCapture::frame_take(const int width, const int height, const bool is_bottom_up, const bool is_waiting, Frame& frame) {
+  {
+    unique_lock<mutex> lock(m_mutex);
+
+    if (m_queue.size() + (m_is_encoding ? 1 : 0) >= CAPTURE_QUEUE_FRAMES_MAX) {
+      if (!is_waiting) {
+        m_drop_count++;
+        return false;
+      }
+
+      m_stall_count++;
+      m_frame_written.wait(lock, [this] { return m_queue.size() + (m_is_encoding ? 1 : 0) < CAPTURE_QUEUE_FRAMES_MAX; });
+    }
+
+    if (!m_free_frames.empty()) {
+      frame = move(m_free_frames.back());
+      m_free_frames.pop_back();
+    }
+  }
+
+  frame.width = width;
+  frame.height = height;
+  frame.is_bottom_up = is_bottom_up;
+  frame.pixels.resize(width*height*4);
+  return true;
+}
+
+void FrameCapture::frame_push(Frame& frame) {
+  {
+    lock_guard<mutex> lock(m_mutex);
+    m_queue.push_back(move(frame));
+  }
+  m_frame_queued.notify_one();
+}
+
+void FrameCapture::encoder_loop() {
+  char path[1024];
+  Frame frame;
+
+  while (true) {
+    {
+      unique_lock<mutex> lock(m_mutex);
+      m_frame_queued.wait(lock, [this] { return m_is_stopping || !m_queue.empty(); });
+
+      // the queue is emptied before stopping
+      if (m_queue.empty()) {
+        return;
+      }
+
+      frame = move(m_queue.front());
+      m_queue.pop_front();
+      m_is_encoding = true;
+    }
+
+    bool is_written;
+    if (m_is_y4m) {
+      is_written = write_y4m(frame);
+    }
+    else {
+      snprintf(path, sizeof(path), "%s_%06d.png", m_path.c_str(), m_frame_count);
+      is_written = write_png(frame, path);
+    }
+
+    {
+      lock_guard<mutex> lock(m_mutex);
+      if (is_written) {
+        m_frame_count++;
+      }
+      m_is_encoding = false;
+      m_free_frames.push_back(move(frame));
+    }
+    m_frame_written.notify_all();
+  }
+}
+
+void FrameCapture::encoder_stop() {
+  if (!m_encoder.joinable()) {
+    return;
+  }
+
+  {
+    lock_guard<mutex> lock(m_mutex);
+    m_is_stopping = true;
+  }
+  m_frame_queued.notify_one();
+  m_encoder.join();
+
+  if (m_file != NULL) {
+    fclose(m_file);
+    m_file = NULL;
+  }
+
+  m_is_open = false;
+}
+
+bool FrameCapture::write_png(const Frame& frame, const char* path) {
+  FILE* file = fopen(path, "wb");
+
+  if (file == NULL) {
+    return false;
+  }
+
+  const size_t row_size = (size_t)frame.width*3 + 1;
+  const size_t image_size = row_size*frame.height;
+  unsigned int adler_a = 1;
+  unsigned int adler_b = 0;
+
+  m_encoded.clear();
+
+  // IHDR: 8-bit RGB, no interlacing
+  put_big_endian(m_encoded, (unsigned int)frame.width);
+  put_big_endian(m_encoded, (unsigned int)frame.height);
+  m_encoded.push_back(8);
+  m_encoded.push_back(2);
+  m_encoded.push_back(0);
+  m_encoded.push_back(0);
+  m_encoded.push_back(0);
+  const size_t header_end = m_encoded.size();
+
+  // IDAT: a zlib stream of stored blocks, since frames are written faster uncompressed than the encoder could deflate
+  // them
+  m_encoded.push_back(0x78);
+  m_encoded.push_back(0x01);
+
+  size_t block_fill = 0;
+  size_t written = 0;
+
+  for (int y = 0; y < frame.height; y++) {
+    const int row = frame.is_bottom_up ? frame.height - 1 - y : y;
+    const unsigned char* pixels = &frame.pixels[(size_t)row*frame.width*4];
+
+    for (size_t i = 0; i < row_size; i++) {
+      // each row starts with filter type 0
+      const unsigned char byte = i == 0 ? 0 : pixels[((i - 1) / 3)*4 + (i - 1) % 3];
+
+      if (block_fill == 0) {
+        const size_t block_size = min(image_size - written, (size_t)PNG_STORED_BLOCK_SIZE);
+
+        m_encoded.push_back(written + block_size == image_size ? 1 : 0);
+        m_encoded.push_back((unsigned char)block_size);
+        m_encoded.push_back((unsigned char)(block_size >> 8));
+        m_encoded.push_back((unsigned char)~block_size);
+        m_encoded.push_back((unsigned char)(~block_size >> 8));
+        block_fill = block_size;
+      }
+
+      m_encoded.push_back(byte);
+      block_fill--;
+      written++;
+
+      adler_a = (adler_a + byte) % 65521;
+      adler_b = (adler_b + adler_a) % 65521;
+    }
+  }
+  put_big_endian(m_encoded, (adler_b << 16) | adler_a);
+
+  fwrite(PNG_SIGNATURE, 1, 8, file);
+  png_chunk_write(file, "IHDR", m_encoded, 0, header_end);
+  png_chunk_write(file, "IDAT", m_encoded, header_end, m_encoded.size());
+  png_chunk_write(file, "IEND", m_encoded, 0, 0);
+
+  return fclose(file) == 0;
+}
+
+bool FrameCapture::write_y4m(const Frame& frame) {
+  if (m_stream_width == 0) {
+    m_stream_width = frame.width;
+    m_stream_height = frame.height;
+    fprintf(m_file, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n", m_stream_width, m_stream_height, m_frame_rate);
+  }
+
+  const int width = m_stream_width;
+  const int height = m_stream_height;
+  const int chroma_width = (width + 1) / 2;
+  const int chroma_height = (height + 1) / 2;
+
+  m_encoded.resize((size_t)width*height + (size_t)chroma_width*chroma_height*2);
+  unsigned char* plane_y = m_encoded.data();
+  unsigned char* plane_u = plane_y + (size_t)width*height;
+  unsigned char* plane_v = plane_u + (size_t)chroma_width*chroma_height;
+
+  // BT.601 studio swing, with frames of another size than the first cropped or padded with black at the bottom right
+  for (int cy = 0; cy < chroma_height; cy++) {
+    for (int cx = 0; cx < chroma_width; cx++) {
+      int sum[3] = { 0, 0, 0 };
+      int count = 0;
+
+      for (int y = cy*2; y < cy*2 + 2 && y < height; y++) {
+        for (int x = cx*2; x < cx*2 + 2 && x < width; x++) {
+          int rgb[3] = { 0, 0, 0 };
+
+          if (x < frame.width && y < frame.height) {
+            const int row = frame.is_bottom_up ? frame.height - 1 - y : y;
+            const unsigned char* pixel = &frame.pixels[((size_t)row*frame.width + x)*4];
+
+            rgb[0] = pixel[0];
+            rgb[1] = pixel[1];
+            rgb[2] = pixel[2];
+          }
+
+          plane_y[(size_t)y*width + x] = (unsigned char)(((66*rgb[0] + 129*rgb[1] + 25*rgb[2] + 128) >> 8) + 16);
+
+          sum[0] += rgb[0];
+          sum[1] += rgb[1];
+          sum[2] += rgb[2];
+          count++;
+        }
+      }
+
+      const int r = sum[0] / count;
+      const int g = sum[1] / count;
+      const int b = sum[2] / count;
+
+      plane_u[(size_t)cy*chroma_width + cx] = (unsigned char)(((-38*r - 74*g + 112*b + 128) >> 8) + 128);
+      plane_v[(size_t)cy*chroma_width + cx] = (unsigned char)(((112*r - 94*g - 18*b + 128) >> 8) + 128);
+    }
+  }
+
+  fputs("FRAME\n", m_file);
+  return fwrite(m_encoded.data(), 1, m_encoded.size(), m_file) == m_encoded.size();
+}
\ No newline at end of file
@@ -0,0 +1,122 @@
+#ifndef FRAME_CAPTURE_H
+#define FRAME_CAPTURE_H
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#define DEFAULT_CAPTURE_FRAME_RATE 60
+
+// frames read back from OpenGL are encoded this many frames after they were drawn, so that the read never waits
+#define CAPTURE_READBACK_BUFFERS 3
+
+// frames waiting for the encoder, beyond which submitting blocks until one is written
+#define CAPTURE_QUEUE_FRAMES_MAX 8
+
+// writes frames to a numbered PNG sequence or one YUV4MPEG2 stream on a thread of its own, so that capturing costs the
+// caller little more than a copy of the pixels
+class FrameCapture {
+public:
+  FrameCapture();
+  ~FrameCapture();
+
+  const bool& c_is_open = m_is_open;
+  const bool& c_is_pixel_buffered = m_is_pixel_buffered;
+
+  // frames written, submits that had to wait for the encoder, and frames try_submit dropped since it was behind
+  const int& c_frame_count = m_frame_count;
+  const int& c_stall_count = m_stall_count;
+  const int& c_drop_count = m_drop_count;
+
+  // a path ending in .y4m is written as one stream, sized by its first frame, and any other path is the prefix of
+  // path_000000.png, path_000001.png and so on
+  bool open(const char* path, const int frame_rate = DEFAULT_CAPTURE_FRAME_RATE);
+
+  // sets up reading back into pixel buffer objects once the context is current, returning false when they are
+  // unavailable so that read_framebuffer reads synchronously
+  bool readback_init();
+
+  // starts reading the back buffer, which is encoded CAPTURE_READBACK_BUFFERS - 1 calls later when pixel buffer objects
+  // are in use; call after drawing and before swapping
+  void read_framebuffer(const int width, const int height);
+
+  // queues RGBA8 pixels, one unsigned int per pixel with red in the lowest byte, stored top row first
+  void submit(const unsigned int* pixels, const int width, const int height);
+
+  // queues pixels like submit unless CAPTURE_QUEUE_FRAMES_MAX frames are already waiting, in which case the frame is
+  // dropped rather than waited for, returning whether it was queued
+  bool try_submit(const unsigned int* pixels, const int width, const int height);
+
+  // encodes the frames still being read back or queued and closes the output; reading back needs the context current
+  void close();
+
+private:
+  // RGBA8 pixels, stored top row first unless is_bottom_up
+  struct Frame {
+    std::vector<unsigned char> pixels;
+    int width;
+    int height;
+    bool is_bottom_up;
+  };
+
+  bool m_is_open;
+  bool m_is_pixel_buffered;
+  bool m_is_y4m;
+
+  std::string m_path;
+  int m_frame_rate;
+  FILE* m_file;
+
+  // the size of the stream, fixed by its first frame
+  int m_stream_width;
+  int m_stream_height;
+
+  int m_frame_count;
+  int m_stall_count;
+  int m_drop_count;
+
+  // the pixel buffer objects read into in turn, with the size of each and whether it holds a frame not yet taken
+  unsigned int m_pixel_buffers[CAPTURE_READBACK_BUFFERS];
+  int m_pixel_buffer_sizes[CAPTURE_READBACK_BUFFERS];
+  int m_readback_widths[CAPTURE_READBACK_BUFFERS];
+  int m_readback_heights[CAPTURE_READBACK_BUFFERS];
+  bool m_is_readback_pending[CAPTURE_READBACK_BUFFERS];
+  int m_readback_next;
+
+  std::thread m_encoder;
+  std::mutex m_mutex;
+  std::condition_variable m_frame_queued;
+  std::condition_variable m_frame_written;
+  std::deque<Frame> m_queue;
+  bool m_is_encoding;
+  bool m_is_stopping;
+
+  // written frames whose pixel vectors are reused by later ones
+  std::vector<Frame> m_free_frames;
+
+  // the encoded image, only touched by the encoder thread
+  std::vector<unsigned char> m_encoded;
+
+  // stores in frame one with pixels sized for width and height once there is room in the queue, waiting for it when
+  // is_waiting and otherwise returning false when there is none
+  bool frame_take(const int width, const int height, const bool is_bottom_up, const bool is_waiting, Frame& frame);
+  void frame_push(Frame& frame);
+
+  // converts pixels as given to submit into a frame and queues it, returning false when it was dropped
+  bool pixels_submit(const unsigned int* pixels, const int width, const int height, const bool is_waiting);
+
+  // takes the frame read into the pixel buffer at index
+  void readback_take(const int index);
+
+  void encoder_loop();
+  void encoder_stop();
+
+  bool write_png(const Frame& frame, const char* path);
+  bool write_y4m(const Frame& frame);
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,92 @@
+#include "FramePacer.h"
+
+#include <cmath>
+#include <thread>
+using namespace std;
+using namespace std::chrono;
+
+#ifdef _WIN32
+#include <windows.h>
+#pragma comment(lib, "winmm.lib")
+#endif
+
+// weight of each new refresh interval measured
+#define REFRESH_SMOOTHING 0.1f
+
+FramePacer::FramePacer(const float frame_rate_max) {
+  m_frame_rate_max = frame_rate_max;
+  m_refresh_seconds = 0.0f;
+  m_wait_seconds = 0.0f;
+
+  m_deadline = Clock::now();
+  m_last_swap = m_deadline;
+
+#ifdef _WIN32
+  // the default timer resolution rounds sleeps up to about 16 ms
+  timeBeginPeriod(1);
+#endif
+}
+
+FramePacer::~FramePacer() {
+#ifdef _WIN32
+  timeEndPeriod(1);
+#endif
+}
+
+void FramePacer::set_frame_rate_max(const float frame_rate_max) {
+  m_frame_rate_max = frame_rate_max;
+}
+
+void FramePacer::swap_record(const float swap_seconds) {
+  const Clock::time_point now = Clock::now();
+  const float interval = duration<float>(now - m_last_swap).count();
+
+  m_last_swap = now;
+
+  // a swap only blocks when the frame finished before the vertical blank, so the time since the last swap is then one
+  // refresh interval; longer intervals come from slow frames and are left out
+  if (swap_seconds > VSYNC_BLOCK_SECONDS) {
+    if (m_refresh_seconds == 0.0f) {
+      m_refresh_seconds = interval;
+    }
+    else if (interval < m_refresh_seconds*1.5f) {
+      m_refresh_seconds += (interval - m_refresh_seconds)*REFRESH_SMOOTHING;
+    }
+  }
+}
+
+void FramePacer::wait() {
+  const Clock::time_point start = Clock::now();
+
+  if (m_frame_rate_max <= 0.0f) {
+    m_wait_seconds = 0.0f;
+    return;
+  }
+
+  float interval = 1.0f / m_frame_rate_max;
+
+  // land on whole refresh intervals so that the deadlines keep step with the vertical blank; only the sleep below wakes
+  // early, so that the spin reaches the deadline on time
+  if (m_refresh_seconds > 0.0f) {
+    const float refresh_count = ceilf(interval / m_refresh_seconds - 0.1f);
+    interval = (refresh_count > 1.0f ? refresh_count : 1.0f)*m_refresh_seconds;
+  }
+
+  m_deadline += duration_cast<Clock::duration>(duration<float>(interval));
+
+  // after a slow frame, start over from now instead of rushing to catch up
+  if (m_deadline < start) {
+    m_deadline = start;
+  }
+
+  const Clock::time_point sleep_end = m_deadline - duration_cast<Clock::duration>(duration<float>(FRAME_SPIN_SECONDS));
+  if (start < sleep_end) {
+    this_thread::sleep_until(sleep_end);
+  }
+
+  while (Clock::now() < m_deadline) {
+    this_thread::yield();
+  }
+
+  m_wait_seconds = duration<float>(Clock::now() - start).count();
+}
\ No newline at end of file
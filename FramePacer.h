@@ -0,0 +1,49 @@
+#ifndef FRAME_PACER_H
+#define FRAME_PACER_H
+
+#include <chrono>
+
+// a frame rate of zero leaves frames uncapped
+#define DEFAULT_FRAME_RATE_MAX 60.0f
+
+// time before a deadline spent yielding rather than sleeping, since a sleep can overshoot by a scheduler tick
+#define FRAME_SPIN_SECONDS 0.002f
+
+// a swap that blocks for longer than this is taken to be waiting for the vertical blank
+#define VSYNC_BLOCK_SECONDS 0.002f
+
+// holds frames to a maximum rate by sleeping until each deadline; when swaps wait for the vertical blank, the frame
+// interval is rounded up to whole refresh intervals so that the cap does not beat against the display
+class FramePacer {
+public:
+  FramePacer(const float frame_rate_max = DEFAULT_FRAME_RATE_MAX);
+  ~FramePacer();
+
+  const float& c_frame_rate_max = m_frame_rate_max;
+
+  // refresh interval measured from blocking swaps, or zero while swaps do not block
+  const float& c_refresh_seconds = m_refresh_seconds;
+
+  // time spent waiting by the last wait
+  const float& c_wait_seconds = m_wait_seconds;
+
+  void set_frame_rate_max(const float frame_rate_max);
+
+  // call right after swapping buffers with the time the swap took
+  void swap_record(const float swap_seconds);
+
+  // returns once the next frame may start
+  void wait();
+
+private:
+  typedef std::chrono::steady_clock Clock;
+
+  float m_frame_rate_max;
+  float m_refresh_seconds;
+  float m_wait_seconds;
+
+  Clock::time_point m_deadline;
+  Clock::time_point m_last_swap;
+};
+
+#endif
\ No newline at end of file
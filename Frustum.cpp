@@ -0,0 +1,145 @@
+#include "Frustum.h"
+
+#include "macro_constants.h"
+
+#include <cmath>
+using namespace std;
+
+#include "vector3.h"
+
+// stores the plane through point with the given normal, which is normalized
+static void plane_store(const float normal[3], const float point[3], float plane[4]) {
+  __vector_element_assign_opV3(plane, =, normal);
+  normalizeV3(plane);
+  plane[3] = -__dot_productV3(plane, point);
+}
+
+Frustum::Frustum() {
+  for (int i = 0; i < FRUSTUM_PLANE_COUNT; i++) {
+    m_planes[i][0] = 0.0f;
+    m_planes[i][1] = 0.0f;
+    m_planes[i][2] = 0.0f;
+    m_planes[i][3] = 0.0f;
+  }
+
+  for (int i = 0; i < 8; i++) {
+    __vector_element_assign_opV3(m_corners[i], =, ZERO_VECTOR);
+  }
+}
+
+void Frustum::set(const Camera& camera, const float field_of_view_y, const float ratio_wh, const float near_distance, const float far_distance) {
+  float forward[3];
+  float side[3];
+  float up[3];
+
+  float normal[3];
+  float point[3];
+
+  // the same basis gluLookAt builds
+  __vector_element_opV3(camera.c_target, -, camera.c_position, forward);
+  normalizeV3(forward);
+  __cross_productV3(forward, camera.c_vector_up_roll, side);
+  normalizeV3(side);
+  __cross_productV3(side, forward, up);
+
+  const float tan_vertical = tanf(field_of_view_y*0.5f / RAD_TO_DEG);
+  const float tan_horizontal = tan_vertical*ratio_wh;
+
+  // near and far
+  __vector_element_op_and_scalar_opV3(camera.c_position, +, forward, *, near_distance, point);
+  plane_store(forward, point, m_planes[0]);
+
+  __vector_element_op_and_scalar_opV3(camera.c_position, +, forward, *, far_distance, point);
+  __vector_scalar_opV3(forward, *, -1.0f, normal);
+  plane_store(normal, point, m_planes[1]);
+
+  // the sides all pass through the camera position
+  for (int i = 0; i < 3; i++) {
+    normal[i] = forward[i]*tan_horizontal - side[i];
+  }
+  plane_store(normal, camera.c_position, m_planes[2]);
+
+  for (int i = 0; i < 3; i++) {
+    normal[i] = forward[i]*tan_horizontal + side[i];
+  }
+  plane_store(normal, camera.c_position, m_planes[3]);
+
+  for (int i = 0; i < 3; i++) {
+    normal[i] = forward[i]*tan_vertical - up[i];
+  }
+  plane_store(normal, camera.c_position, m_planes[4]);
+
+  for (int i = 0; i < 3; i++) {
+    normal[i] = forward[i]*tan_vertical + up[i];
+  }
+  plane_store(normal, camera.c_position, m_planes[5]);
+
+  // near corners first, then far corners, each going around the signs of side and up
+  for (int c = 0; c < 8; c++) {
+    const float distance = c < 4 ? near_distance : far_distance;
+    const float sign_side = (c & 1) ? 1.0f : -1.0f;
+    const float sign_up = (c & 2) ? 1.0f : -1.0f;
+
+    for (int i = 0; i < 3; i++) {
+      m_corners[c][i] = camera.c_position[i] + (forward[i] + side[i]*sign_side*tan_horizontal + up[i]*sign_up*tan_vertical)*distance;
+    }
+  }
+}
+
+void Frustum::aabb_store(float min[3], float max[3]) const {
+  __vector_element_assign_opV3(min, =, m_corners[0]);
+  __vector_element_assign_opV3(max, =, m_corners[0]);
+
+  for (int c = 1; c < 8; c++) {
+    for (int i = 0; i < 3; i++) {
+      if (m_corners[c][i] < min[i]) {
+        min[i] = m_corners[c][i];
+      }
+      if (m_corners[c][i] > max[i]) {
+        max[i] = m_corners[c][i];
+      }
+    }
+  }
+}
+
+bool Frustum::is_sphere_visible(const float center[3], const float radius) const {
+  for (int p = 0; p < FRUSTUM_PLANE_COUNT; p++) {
+    if (__dot_productV3(m_planes[p], center) + m_planes[p][3] < -radius) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool Frustum::is_aabb_visible(const float min[3], const float max[3]) const {
+  float point[3];
+
+  // the box is outside once its corner furthest along the normal of a plane is outside it
+  for (int p = 0; p < FRUSTUM_PLANE_COUNT; p++) {
+    const float* plane = m_planes[p];
+
+    point[0] = plane[0] >= 0.0f ? max[0] : min[0];
+    point[1] = plane[1] >= 0.0f ? max[1] : min[1];
+    point[2] = plane[2] >= 0.0f ? max[2] : min[2];
+
+    if (__dot_productV3(plane, point) + plane[3] < 0.0f) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool Frustum::is_shape_visible(const Shape& shape) const {
+  float center[3];
+  float radius;
+  float min[3];
+  float max[3];
+
+  shape.bounding_sphere_store(center, radius);
+  if (!is_sphere_visible(center, radius)) {
+    return false;
+  }
+
+  shape.aabb_store(min, max);
+  return is_aabb_visible(min, max);
+}
\ No newline at end of file
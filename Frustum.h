@@ -0,0 +1,33 @@
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include "Camera.h"
+#include "Shape.h"
+
+#define FRUSTUM_PLANE_COUNT 6
+
+// the view volume of a camera with a gluPerspective projection, as planes facing inwards
+class Frustum {
+public:
+  Frustum();
+
+  // matches gluLookAt from the camera position to its target with its roll vector as up, followed by
+  // gluPerspective(field_of_view_y, ratio_wh, near_distance, far_distance)
+  void set(const Camera& camera, const float field_of_view_y, const float ratio_wh, const float near_distance, const float far_distance);
+
+  // world bounds of the corners of the volume
+  void aabb_store(float min[3], float max[3]) const;
+
+  // these may yield true for volumes just outside of the corners, but never false for volumes inside
+  bool is_sphere_visible(const float center[3], const float radius) const;
+  bool is_aabb_visible(const float min[3], const float max[3]) const;
+  bool is_shape_visible(const Shape& shape) const;
+
+private:
+  // each plane is a unit normal and an offset, such that points p inside have normal.p + offset >= 0
+  float m_planes[FRUSTUM_PLANE_COUNT][4];
+
+  float m_corners[8][3];
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,145 @@
+#include "GLState.h"
+
+#include <gl/glut.h>
+#include <gl/gl.h>
+
+#include <algorithm>
+using namespace std;
+
+#include "matrix4.h"
+
+GLState::GLState() {
+  identityM4(m_projection);
+  identityM4(m_modelview);
+
+  m_call_count = 0;
+  m_skip_count = 0;
+
+  invalidate();
+}
+
+void GLState::reset_counts() {
+  m_call_count = 0;
+  m_skip_count = 0;
+}
+
+void GLState::invalidate() {
+  m_is_viewport_valid = false;
+  m_is_projection_valid = false;
+  m_is_modelview_valid = false;
+  m_is_clear_color_valid = false;
+
+  for (int i = 0; i < GL_STATE_LIGHT_COUNT; i++) {
+    m_is_light_valid[i] = false;
+  }
+
+  m_is_material_valid = false;
+}
+
+void GLState::invalidate_material() {
+  m_is_material_valid = false;
+}
+
+void GLState::set_viewport(const int x, const int y, const int width, const int height) {
+  const int viewport[4] = { x, y, width, height };
+
+  if (m_is_viewport_valid && equal(viewport, viewport + 4, m_viewport)) {
+    m_skip_count++;
+    return;
+  }
+
+  copy(viewport, viewport + 4, m_viewport);
+  m_is_viewport_valid = true;
+
+  glViewport(x, y, width, height);
+  m_call_count++;
+}
+
+void GLState::set_projection(const float matrix[16]) {
+  if (m_is_projection_valid && equal(matrix, matrix + 16, m_projection)) {
+    m_skip_count++;
+    return;
+  }
+
+  copy(matrix, matrix + 16, m_projection);
+  m_is_projection_valid = true;
+
+  glMatrixMode(GL_PROJECTION);
+  glLoadMatrixf(matrix);
+  glMatrixMode(GL_MODELVIEW);
+  m_call_count++;
+}
+
+void GLState::set_modelview(const float matrix[16]) {
+  if (m_is_modelview_valid && equal(matrix, matrix + 16, m_modelview)) {
+    m_skip_count++;
+    return;
+  }
+
+  copy(matrix, matrix + 16, m_modelview);
+  m_is_modelview_valid = true;
+
+  glLoadMatrixf(matrix);
+  m_call_count++;
+}
+
+void GLState::set_clear_color(const float color[4]) {
+  if (m_is_clear_color_valid && equal(color, color + 4, m_clear_color)) {
+    m_skip_count++;
+    return;
+  }
+
+  copy(color, color + 4, m_clear_color);
+  m_is_clear_color_valid = true;
+
+  glClearColor(color[0], color[1], color[2], color[3]);
+  m_call_count++;
+}
+
+void GLState::set_light(const int light, const float position[4], const float diffuse[4]) {
+  float eye_position[4];
+
+  // OpenGL keeps the position as transformed when it was set
+  for (int i = 0; i < 4; i++) {
+    eye_position[i] = m_modelview[i]*position[0] + m_modelview[4 + i]*position[1] + m_modelview[8 + i]*position[2] + m_modelview[12 + i]*position[3];
+  }
+
+  if (m_is_light_valid[light]
+    && equal(eye_position, eye_position + 4, m_light_positions[light])
+    && equal(diffuse, diffuse + 4, m_light_diffuse[light])
+    )
+  {
+    m_skip_count++;
+    return;
+  }
+
+  copy(eye_position, eye_position + 4, m_light_positions[light]);
+  copy(diffuse, diffuse + 4, m_light_diffuse[light]);
+  m_is_light_valid[light] = true;
+
+  glLightfv(GL_LIGHT0 + light, GL_POSITION, position);
+  glLightfv(GL_LIGHT0 + light, GL_DIFFUSE, diffuse);
+  m_call_count++;
+}
+
+void GLState::set_material(const float color[4], const float reflectance[4], const float shininess) {
+  if (m_is_material_valid
+    && equal(color, color + 4, m_material_color)
+    && equal(reflectance, reflectance + 4, m_material_reflectance)
+    && shininess == m_material_shininess
+    )
+  {
+    m_skip_count++;
+    return;
+  }
+
+  copy(color, color + 4, m_material_color);
+  copy(reflectance, reflectance + 4, m_material_reflectance);
+  m_material_shininess = shininess;
+  m_is_material_valid = true;
+
+  glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE, color);
+  glMaterialfv(GL_FRONT_AND_BACK, GL_SPECULAR, reflectance);
+  glMaterialfv(GL_FRONT_AND_BACK, GL_SHININESS, &shininess);
+  m_call_count++;
+}
\ No newline at end of file
@@ -0,0 +1,68 @@
+#ifndef GL_STATE_H
+#define GL_STATE_H
+
+#define GL_STATE_LIGHT_COUNT 8
+
+// shadows the OpenGL state the renderer sets each frame so that setting it again to the same values makes no calls and
+// reading it back needs no queries; GL_MODELVIEW is the current matrix mode between calls
+class GLState {
+public:
+  GLState();
+
+  const int* c_viewport = m_viewport;
+  const float* c_projection = m_projection;
+  const float* c_modelview = m_modelview;
+
+  // calls made and calls skipped since the last reset_counts
+  const int& c_call_count = m_call_count;
+  const int& c_skip_count = m_skip_count;
+
+  void reset_counts();
+
+  // forgets the shadowed state so that the next setters reach OpenGL, as needed for a new context
+  void invalidate();
+
+  // needed after drawing code outside of this layer sets materials
+  void invalidate_material();
+
+  void set_viewport(const int x, const int y, const int width, const int height);
+
+  void set_projection(const float matrix[16]);
+  void set_modelview(const float matrix[16]);
+
+  void set_clear_color(const float color[4]);
+
+  // light is the index of the light from GL_LIGHT0; position is in world coordinates and is transformed by the current
+  // modelview matrix, so a light only needs setting again when the view or the light changes
+  void set_light(const int light, const float position[4], const float diffuse[4]);
+
+  void set_material(const float color[4], const float reflectance[4], const float shininess);
+
+private:
+  int m_viewport[4];
+  bool m_is_viewport_valid;
+
+  float m_projection[16];
+  bool m_is_projection_valid;
+
+  float m_modelview[16];
+  bool m_is_modelview_valid;
+
+  float m_clear_color[4];
+  bool m_is_clear_color_valid;
+
+  // positions in eye coordinates, as OpenGL stores them
+  float m_light_positions[GL_STATE_LIGHT_COUNT][4];
+  float m_light_diffuse[GL_STATE_LIGHT_COUNT][4];
+  bool m_is_light_valid[GL_STATE_LIGHT_COUNT];
+
+  float m_material_color[4];
+  float m_material_reflectance[4];
+  float m_material_shininess;
+  bool m_is_material_valid;
+
+  int m_call_count;
+  int m_skip_count;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,780 @@
+#include "Gjk.h"
+
+#include <cmath>
+#include <functional>
+#include <cfloat>
+using namespace std;
+
+#include "Shape.h"
+#include "macro_constants.h"
+#include "vector3.h"
+
+// outcomes of the GJK iteration
+#define GJK_SEPARATED 0
+#define GJK_OVERLAPPING 1
+#define GJK_CONVERGED 2
+
+// the part of a simplex closest to the origin, with the barycentric weights of the closest point
+struct SimplexFeature {
+  int count;
+  int indices[4];
+  float weights[4];
+  float distance_squared;
+};
+
+struct EpaFace {
+  int indices[3];
+  float normal[3];
+  float distance;
+};
+
+// one of the convex sets GJK runs on, which is either a shape or a triangle given by its world corners
+struct GjkSupport {
+  const Shape* shape;
+  const float* corners;
+};
+
+GjkCache::GjkCache() {
+  direction_count = 0;
+}
+
+static void support_store(const GjkSupport& support, const float direction[3], float point[3]) {
+  if (support.shape != nullptr) {
+    support.shape->support_store(direction, point);
+    return;
+  }
+
+  int furthest = 0;
+  float furthest_distance = __dot_productV3(support.corners, direction);
+
+  for (int i = 1; i < 3; i++) {
+    const float distance = __dot_productV3((support.corners + i*3), direction);
+    if (distance > furthest_distance) {
+      furthest = i;
+      furthest_distance = distance;
+    }
+  }
+
+  __vector_element_assign_opV3(point, =, (support.corners + furthest*3));
+}
+
+static void support_center_store(const GjkSupport& support, float center[3]) {
+  if (support.shape != nullptr) {
+    __vector_element_assign_opV3(center, =, support.shape->c_position);
+    return;
+  }
+
+  for (int i = 0; i < 3; i++) {
+    center[i] = (support.corners[i] + support.corners[3 + i] + support.corners[6 + i]) / 3.0f;
+  }
+}
+
+// stores the point of the Minkowski difference of the sets furthest along direction
+static void minkowski_support_store(const GjkSupport& support_a, const GjkSupport& support_b, const float direction[3], GjkVertex& vertex) {
+  float negative_direction[3];
+
+  __negativeV3(direction, negative_direction);
+  support_store(support_a, direction, vertex.point_a);
+  support_store(support_b, negative_direction, vertex.point_b);
+
+  __vector_element_opV3(vertex.point_a, -, vertex.point_b, vertex.point);
+  __vector_element_assign_opV3(vertex.direction, =, direction);
+}
+
+static bool is_duplicate(const GjkVertex* vertices, const int count, const GjkVertex& vertex) {
+  float offset[3];
+
+  for (int i = 0; i < count; i++) {
+    __vector_element_opV3(vertices[i].point, -, vertex.point, offset);
+    if (__dot_productV3(offset, offset) <= GJK_TOLERANCE) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+static void feature_closest_store(const GjkVertex* simplex, SimplexFeature& feature, float closest[3]) {
+  __vector_element_assign_opV3(closest, =, ZERO_VECTOR);
+  for (int i = 0; i < feature.count; i++) {
+    __vector_element_op_and_scalar_opV3(closest, +, simplex[feature.indices[i]].point, *, feature.weights[i], closest);
+  }
+
+  feature.distance_squared = __dot_productV3(closest, closest);
+}
+
+static void point_feature(const GjkVertex* simplex, const int i, SimplexFeature& feature) {
+  float closest[3];
+
+  feature.count = 1;
+  feature.indices[0] = i;
+  feature.weights[0] = 1.0f;
+  feature_closest_store(simplex, feature, closest);
+}
+
+static void segment_feature(const GjkVertex* simplex, const int i, const int j, SimplexFeature& feature) {
+  float edge[3];
+  float closest[3];
+
+  __vector_element_opV3(simplex[j].point, -, simplex[i].point, edge);
+
+  const float length_squared = __dot_productV3(edge, edge);
+  const float t = length_squared > 0.0f ? -__dot_productV3(simplex[i].point, edge) / length_squared : 0.0f;
+
+  if (t <= 0.0f) {
+    point_feature(simplex, i, feature);
+    return;
+  }
+  if (t >= 1.0f) {
+    point_feature(simplex, j, feature);
+    return;
+  }
+
+  feature.count = 2;
+  feature.indices[0] = i;
+  feature.indices[1] = j;
+  feature.weights[0] = 1.0f - t;
+  feature.weights[1] = t;
+  feature_closest_store(simplex, feature, closest);
+}
+
+// finds the closest point of the triangle to the origin by its Voronoi regions
+static void triangle_feature(const GjkVertex* simplex, const int i, const int j, const int k, SimplexFeature& feature) {
+  const float* a = simplex[i].point;
+  const float* b = simplex[j].point;
+  const float* c = simplex[k].point;
+
+  float ab[3];
+  float ac[3];
+  float closest[3];
+  SimplexFeature edge_feature;
+
+  __vector_element_opV3(b, -, a, ab);
+  __vector_element_opV3(c, -, a, ac);
+
+  const float d1 = -__dot_productV3(ab, a);
+  const float d2 = -__dot_productV3(ac, a);
+  if (d1 <= 0.0f && d2 <= 0.0f) {
+    point_feature(simplex, i, feature);
+    return;
+  }
+
+  const float d3 = -__dot_productV3(ab, b);
+  const float d4 = -__dot_productV3(ac, b);
+  if (d3 >= 0.0f && d4 <= d3) {
+    point_feature(simplex, j, feature);
+    return;
+  }
+
+  const float vc = d1*d4 - d3*d2;
+  if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) {
+    segment_feature(simplex, i, j, feature);
+    return;
+  }
+
+  const float d5 = -__dot_productV3(ab, c);
+  const float d6 = -__dot_productV3(ac, c);
+  if (d6 >= 0.0f && d5 <= d6) {
+    point_feature(simplex, k, feature);
+    return;
+  }
+
+  const float vb = d5*d2 - d1*d6;
+  if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) {
+    segment_feature(simplex, i, k, feature);
+    return;
+  }
+
+  const float va = d3*d6 - d5*d4;
+  if (va <= 0.0f && d4 - d3 >= 0.0f && d5 - d6 >= 0.0f) {
+    segment_feature(simplex, j, k, feature);
+    return;
+  }
+
+  // a flat triangle has no interior, so take the closest of its edges
+  if (va + vb + vc <= 0.0f) {
+    segment_feature(simplex, i, j, feature);
+    segment_feature(simplex, j, k, edge_feature);
+    if (edge_feature.distance_squared < feature.distance_squared) {
+      feature = edge_feature;
+    }
+    segment_feature(simplex, i, k, edge_feature);
+    if (edge_feature.distance_squared < feature.distance_squared) {
+      feature = edge_feature;
+    }
+    return;
+  }
+
+  const float denominator = 1.0f / (va + vb + vc);
+
+  feature.count = 3;
+  feature.indices[0] = i;
+  feature.indices[1] = j;
+  feature.indices[2] = k;
+  feature.weights[1] = vb*denominator;
+  feature.weights[2] = vc*denominator;
+  feature.weights[0] = 1.0f - feature.weights[1] - feature.weights[2];
+  feature_closest_store(simplex, feature, closest);
+}
+
+static void tetrahedron_feature(const GjkVertex* simplex, SimplexFeature& feature) {
+  // each face with the vertex opposite it
+  static const int FACES[4][4] = {
+    { 0, 1, 2, 3 }, { 0, 3, 1, 2 }, { 0, 2, 3, 1 }, { 1, 3, 2, 0 }
+  };
+
+  float ab[3];
+  float ac[3];
+  float ad[3];
+  float normal[3];
+  SimplexFeature face_feature;
+
+  bool is_inside = true;
+  feature.distance_squared = -1.0f;
+
+  for (int f = 0; f < 4; f++) {
+    const float* a = simplex[FACES[f][0]].point;
+
+    __vector_element_opV3(simplex[FACES[f][1]].point, -, a, ab);
+    __vector_element_opV3(simplex[FACES[f][2]].point, -, a, ac);
+    __vector_element_opV3(simplex[FACES[f][3]].point, -, a, ad);
+    __cross_productV3(ab, ac, normal);
+
+    const float side_of_origin = -__dot_productV3(normal, a);
+    const float side_of_opposite = __dot_productV3(normal, ad);
+
+    // the face counts as outside when the origin is across it from the opposite vertex, or when the tetrahedron is too
+    // flat for the sides to be told apart
+    if (side_of_origin*side_of_opposite < 0.0f
+      || fabsf(side_of_opposite) <= GJK_RELATIVE_TOLERANCE*__magnitudeV3(normal)*__magnitudeV3(ad)
+      )
+    {
+      is_inside = false;
+
+      triangle_feature(simplex, FACES[f][0], FACES[f][1], FACES[f][2], face_feature);
+      if (feature.distance_squared < 0.0f || face_feature.distance_squared < feature.distance_squared) {
+        feature = face_feature;
+      }
+    }
+  }
+
+  if (is_inside) {
+    feature.count = 4;
+    for (int i = 0; i < 4; i++) {
+      feature.indices[i] = i;
+      feature.weights[i] = 0.25f;
+    }
+    feature.distance_squared = 0.0f;
+  }
+}
+
+// reduces the simplex to its part closest to the origin
+static void reduce_simplex(GjkVertex simplex[4], int& count, float weights[4], float closest[3]) {
+  SimplexFeature feature;
+  GjkVertex reduced[4];
+
+  switch (count) {
+  case 1:
+    point_feature(simplex, 0, feature);
+    break;
+  case 2:
+    segment_feature(simplex, 0, 1, feature);
+    break;
+  case 3:
+    triangle_feature(simplex, 0, 1, 2, feature);
+    break;
+  default:
+    tetrahedron_feature(simplex, feature);
+    break;
+  }
+
+  for (int i = 0; i < feature.count; i++) {
+    reduced[i] = simplex[feature.indices[i]];
+    weights[i] = feature.weights[i];
+  }
+  for (int i = 0; i < feature.count; i++) {
+    simplex[i] = reduced[i];
+  }
+  count = feature.count;
+
+  // a tetrahedron is only kept when it encloses the origin
+  __vector_element_assign_opV3(closest, =, ZERO_VECTOR);
+  if (count < 4) {
+    for (int i = 0; i < count; i++) {
+      __vector_element_op_and_scalar_opV3(closest, +, simplex[i].point, *, weights[i], closest);
+    }
+  }
+}
+
+static int gjk_run(const GjkSupport& support_a, const GjkSupport& support_b, GjkVertex simplex[4], int& count, float weights[4], float closest[3], const bool is_early_out, GjkCache* cache) {
+  float direction[3];
+  float center_a[3];
+  float center_b[3];
+  float distance_squared;
+  GjkVertex vertex;
+
+  // the simplex before the last vertex was added, which only exists after the first iteration
+  GjkVertex previous_simplex[4];
+  float previous_weights[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+  float previous_closest[3] = { 0.0f, 0.0f, 0.0f };
+  float previous_distance_squared = FLT_MAX;
+  int previous_count = 0;
+
+  int status = GJK_CONVERGED;
+  count = 0;
+
+  // start from the simplex of the last query
+  if (cache != nullptr) {
+    for (int i = 0; i < cache->direction_count; i++) {
+      minkowski_support_store(support_a, support_b, cache->directions[i], vertex);
+      if (!is_duplicate(simplex, count, vertex)) {
+        simplex[count++] = vertex;
+      }
+    }
+  }
+
+  if (count == 0) {
+    support_center_store(support_a, center_a);
+    support_center_store(support_b, center_b);
+    __vector_element_opV3(center_a, -, center_b, direction);
+    if (__dot_productV3(direction, direction) == 0.0f) {
+      __vector_element_assign_opV3(direction, =, UNIT_VECTOR_X);
+    }
+
+    minkowski_support_store(support_a, support_b, direction, simplex[count++]);
+  }
+
+  for (int iteration = 0; iteration < GJK_MAX_ITERATIONS; iteration++) {
+    reduce_simplex(simplex, count, weights, closest);
+    distance_squared = __dot_productV3(closest, closest);
+
+    // rounding on a nearly flat simplex can move it away from the origin, so keep the last simplex instead
+    if (iteration > 0 && count < 4 && distance_squared >= previous_distance_squared) {
+      count = previous_count;
+      for (int i = 0; i < count; i++) {
+        simplex[i] = previous_simplex[i];
+        weights[i] = previous_weights[i];
+      }
+      __vector_element_assign_opV3(closest, =, previous_closest);
+
+      status = GJK_CONVERGED;
+      break;
+    }
+
+    if (count == 4 || distance_squared <= GJK_TOLERANCE) {
+      status = GJK_OVERLAPPING;
+      break;
+    }
+
+    __negativeV3(closest, direction);
+    minkowski_support_store(support_a, support_b, direction, vertex);
+
+    // nothing reaches past the origin in this direction, so it separates the shapes
+    if (is_early_out && __dot_productV3(vertex.point, direction) < 0.0f) {
+      status = GJK_SEPARATED;
+      break;
+    }
+
+    // stop once the new point barely gets closer
+    if (distance_squared - __dot_productV3(closest, vertex.point) <= GJK_RELATIVE_TOLERANCE*distance_squared
+      || is_duplicate(simplex, count, vertex)
+      )
+    {
+      status = GJK_CONVERGED;
+      break;
+    }
+
+    previous_count = count;
+    for (int i = 0; i < count; i++) {
+      previous_simplex[i] = simplex[i];
+      previous_weights[i] = weights[i];
+    }
+    __vector_element_assign_opV3(previous_closest, =, closest);
+    previous_distance_squared = distance_squared;
+
+    simplex[count++] = vertex;
+  }
+
+  if (cache != nullptr) {
+    cache->direction_count = count;
+    for (int i = 0; i < count; i++) {
+      __vector_element_assign_opV3(cache->directions[i], =, simplex[i].direction);
+    }
+  }
+
+  return status;
+}
+
+// sets face to the triangle from vertices i, j and k, returning false when it is degenerate
+static bool epa_face_set(const GjkVertex* vertices, const int i, const int j, const int k, EpaFace& face) {
+  float ab[3];
+  float ac[3];
+
+  __vector_element_opV3(vertices[j].point, -, vertices[i].point, ab);
+  __vector_element_opV3(vertices[k].point, -, vertices[i].point, ac);
+  __cross_productV3(ab, ac, face.normal);
+
+  const float length = __magnitudeV3(face.normal);
+  if (length <= 0.0f) {
+    return false;
+  }
+
+  __vector_scalar_assign_opV3(face.normal, /=, length);
+  face.indices[0] = i;
+  face.indices[1] = j;
+  face.indices[2] = k;
+  face.distance = __dot_productV3(face.normal, vertices[i].point);
+  return true;
+}
+
+// grows a simplex touching the origin into a tetrahedron, returning false for shapes too flat to enclose a volume
+static bool epa_expand_simplex(const GjkSupport& support_a, const GjkSupport& support_b, GjkVertex vertices[4], int& count) {
+  static const float SEARCH_AXES[6][3] = {
+    { 1.0f, 0.0f, 0.0f }, { -1.0f, 0.0f, 0.0f },
+    { 0.0f, 1.0f, 0.0f }, { 0.0f, -1.0f, 0.0f },
+    { 0.0f, 0.0f, 1.0f }, { 0.0f, 0.0f, -1.0f }
+  };
+
+  float edge[3];
+  float offset[3];
+  float normal[3];
+  float perpendicular_0[3];
+  float perpendicular_1[3];
+  float direction[3];
+  float angle;
+  int axis;
+  bool is_found;
+
+  while (count < 4) {
+    is_found = false;
+
+    switch (count) {
+    case 1:
+      for (int i = 0; i < 6 && !is_found; i++) {
+        minkowski_support_store(support_a, support_b, SEARCH_AXES[i], vertices[count]);
+        is_found = !is_duplicate(vertices, count, vertices[count]);
+      }
+      break;
+
+    case 2:
+      // search around the segment, starting perpendicular to it along the axis it is least aligned with
+      __vector_element_opV3(vertices[1].point, -, vertices[0].point, edge);
+      axis = fabsf(edge[DIM_X]) < fabsf(edge[DIM_Y]) ? DIM_X : DIM_Y;
+      axis = fabsf(edge[axis]) < fabsf(edge[DIM_Z]) ? axis : DIM_Z;
+
+      __cross_productV3(edge, SEARCH_AXES[axis*2], perpendicular_0);
+      normalizeV3(perpendicular_0);
+      __cross_productV3(edge, perpendicular_0, perpendicular_1);
+      normalizeV3(perpendicular_1);
+
+      for (int i = 0; i < 6 && !is_found; i++) {
+        angle = i*PI / 3.0f;
+        __vector_scalar_opV3(perpendicular_0, *, cosf(angle), direction);
+        __vector_element_op_and_scalar_opV3(direction, +, perpendicular_1, *, sinf(angle), direction);
+        minkowski_support_store(support_a, support_b, direction, vertices[count]);
+
+        __vector_element_opV3(vertices[count].point, -, vertices[0].point, offset);
+        __cross_productV3(offset, edge, normal);
+        is_found = __dot_productV3(normal, normal) > GJK_TOLERANCE*__dot_productV3(edge, edge);
+      }
+      break;
+
+    default:
+      // search to either side of the triangle
+      __vector_element_opV3(vertices[1].point, -, vertices[0].point, edge);
+      __vector_element_opV3(vertices[2].point, -, vertices[0].point, offset);
+      __cross_productV3(edge, offset, normal);
+      normalizeV3(normal);
+
+      for (int side = 0; side < 2 && !is_found; side++) {
+        minkowski_support_store(support_a, support_b, normal, vertices[count]);
+        __vector_element_opV3(vertices[count].point, -, vertices[0].point, offset);
+        is_found = fabsf(__dot_productV3(offset, normal)) > sqrtf(GJK_TOLERANCE);
+        __negativeV3(normal, normal);
+      }
+      break;
+    }
+
+    if (!is_found) {
+      return false;
+    }
+    count++;
+  }
+
+  return true;
+}
+
+static int closest_face_index(const EpaFace* faces, const int face_count) {
+  int closest = 0;
+
+  for (int i = 1; i < face_count; i++) {
+    if (faces[i].distance < faces[closest].distance) {
+      closest = i;
+    }
+  }
+
+  return closest;
+}
+
+// finds the penetration of overlapping shapes from the simplex GJK stopped on
+static void epa_store(const GjkSupport& support_a, const GjkSupport& support_b, const GjkVertex simplex[4], const int simplex_count, GjkResult& result) {
+  static const int TETRAHEDRON_FACES[4][4] = {
+    { 0, 1, 2, 3 }, { 0, 3, 1, 2 }, { 0, 2, 3, 1 }, { 1, 3, 2, 0 }
+  };
+
+  GjkVertex vertices[EPA_MAX_VERTICES];
+  EpaFace faces[EPA_MAX_FACES];
+  int edges[EPA_MAX_FACES*3][2];
+
+  int vertex_count = simplex_count;
+  int face_count = 0;
+  int edge_count;
+
+  float offset[3];
+  float edge_0[3];
+  float edge_1[3];
+  float projection[3];
+
+  for (int i = 0; i < simplex_count; i++) {
+    vertices[i] = simplex[i];
+  }
+
+  result.depth = 0.0f;
+  result.distance = 0.0f;
+  __vector_element_assign_opV3(result.point_a, =, vertices[0].point_a);
+  __vector_element_assign_opV3(result.point_b, =, vertices[0].point_b);
+
+  // fall back to the direction between the centers for shapes that only touch or are flat
+  support_center_store(support_a, offset);
+  support_center_store(support_b, result.normal);
+  __vector_element_opV3(result.normal, -, offset, result.normal);
+  if (__dot_productV3(result.normal, result.normal) > 0.0f) {
+    normalizeV3(result.normal);
+  }
+  else {
+    __vector_element_assign_opV3(result.normal, =, UNIT_VECTOR_Y);
+  }
+
+  if (!epa_expand_simplex(support_a, support_b, vertices, vertex_count)) {
+    return;
+  }
+
+  // wind every face of the tetrahedron away from its opposite vertex
+  for (int f = 0; f < 4; f++) {
+    int j = TETRAHEDRON_FACES[f][1];
+    int k = TETRAHEDRON_FACES[f][2];
+
+    if (!epa_face_set(vertices, TETRAHEDRON_FACES[f][0], j, k, faces[face_count])) {
+      return;
+    }
+
+    __vector_element_opV3(vertices[TETRAHEDRON_FACES[f][3]].point, -, vertices[TETRAHEDRON_FACES[f][0]].point, offset);
+    if (__dot_productV3(faces[face_count].normal, offset) > 0.0f) {
+      epa_face_set(vertices, TETRAHEDRON_FACES[f][0], k, j, faces[face_count]);
+    }
+    face_count++;
+  }
+
+  EpaFace closest = faces[closest_face_index(faces, face_count)];
+
+  for (int iteration = 0; iteration < EPA_MAX_ITERATIONS; iteration++) {
+    GjkVertex& vertex = vertices[vertex_count];
+
+    minkowski_support_store(support_a, support_b, closest.normal, vertex);
+
+    // stop once the closest face lies on the boundary of the Minkowski difference
+    if (__dot_productV3(vertex.point, closest.normal) - closest.distance < EPA_TOLERANCE
+      || vertex_count == EPA_MAX_VERTICES - 1
+      || is_duplicate(vertices, vertex_count, vertex)
+      )
+    {
+      break;
+    }
+
+    // remove every face the new vertex can see, keeping the edges on the boundary of the hole
+    edge_count = 0;
+    for (int f = face_count - 1; f >= 0; f--) {
+      __vector_element_opV3(vertex.point, -, vertices[faces[f].indices[0]].point, offset);
+      if (__dot_productV3(faces[f].normal, offset) <= 0.0f) {
+        continue;
+      }
+
+      for (int e = 0; e < 3; e++) {
+        const int start = faces[f].indices[e];
+        const int end = faces[f].indices[(e + 1) % 3];
+        bool is_shared = false;
+
+        // an edge shared with another removed face is inside the hole
+        for (int i = 0; i < edge_count; i++) {
+          if (edges[i][0] == end && edges[i][1] == start) {
+            edges[i][0] = edges[edge_count - 1][0];
+            edges[i][1] = edges[edge_count - 1][1];
+            edge_count--;
+            is_shared = true;
+            break;
+          }
+        }
+
+        if (!is_shared) {
+          edges[edge_count][0] = start;
+          edges[edge_count][1] = end;
+          edge_count++;
+        }
+      }
+
+      faces[f] = faces[--face_count];
+    }
+
+    // close the hole with faces fanning from the new vertex
+    for (int i = 0; i < edge_count && face_count < EPA_MAX_FACES; i++) {
+      if (epa_face_set(vertices, edges[i][0], edges[i][1], vertex_count, faces[face_count])) {
+        face_count++;
+      }
+    }
+    vertex_count++;
+
+    if (face_count == 0) {
+      break;
+    }
+
+    // the closest face only moves away from the origin while the polytope stays convex, so keep the last one when
+    // rounding on nearly coplanar faces breaks it
+    const EpaFace& next_closest = faces[closest_face_index(faces, face_count)];
+    if (next_closest.distance < closest.distance - EPA_TOLERANCE) {
+      break;
+    }
+    closest = next_closest;
+  }
+
+  const GjkVertex& a = vertices[closest.indices[0]];
+  const GjkVertex& b = vertices[closest.indices[1]];
+  const GjkVertex& c = vertices[closest.indices[2]];
+
+  result.depth = closest.distance > 0.0f ? closest.distance : 0.0f;
+  __vector_element_assign_opV3(result.normal, =, closest.normal);
+
+  // interpolate the support points at the projection of the origin onto the face
+  __vector_scalar_opV3(closest.normal, *, closest.distance, projection);
+  __vector_element_opV3(b.point, -, a.point, edge_0);
+  __vector_element_opV3(c.point, -, a.point, edge_1);
+  __vector_element_opV3(projection, -, a.point, offset);
+
+  const float d00 = __dot_productV3(edge_0, edge_0);
+  const float d01 = __dot_productV3(edge_0, edge_1);
+  const float d11 = __dot_productV3(edge_1, edge_1);
+  const float d20 = __dot_productV3(offset, edge_0);
+  const float d21 = __dot_productV3(offset, edge_1);
+  const float denominator = d00*d11 - d01*d01;
+
+  if (denominator == 0.0f) {
+    return;
+  }
+
+  const float weight_b = (d11*d20 - d01*d21) / denominator;
+  const float weight_c = (d00*d21 - d01*d20) / denominator;
+  const float weight_a = 1.0f - weight_b - weight_c;
+
+  for (int i = 0; i < 3; i++) {
+    result.point_a[i] = a.point_a[i]*weight_a + b.point_a[i]*weight_b + c.point_a[i]*weight_c;
+    result.point_b[i] = a.point_b[i]*weight_a + b.point_b[i]*weight_b + c.point_b[i]*weight_c;
+  }
+}
+
+static bool support_is_overlapping(const GjkSupport& support_a, const GjkSupport& support_b, GjkCache* cache) {
+  GjkVertex simplex[4];
+  float weights[4];
+  float closest[3];
+  int count;
+
+  return gjk_run(support_a, support_b, simplex, count, weights, closest, true, cache) == GJK_OVERLAPPING;
+}
+
+static bool support_query(const GjkSupport& support_a, const GjkSupport& support_b, GjkResult& result, GjkCache* cache) {
+  GjkVertex simplex[4];
+  float weights[4];
+  float closest[3];
+  int count;
+
+  result.is_overlapping = gjk_run(support_a, support_b, simplex, count, weights, closest, false, cache) == GJK_OVERLAPPING;
+
+  if (result.is_overlapping) {
+    epa_store(support_a, support_b, simplex, count, result);
+    return true;
+  }
+
+  // the closest points of the shapes share the weights of the closest point of the simplex
+  __vector_element_assign_opV3(result.point_a, =, ZERO_VECTOR);
+  __vector_element_assign_opV3(result.point_b, =, ZERO_VECTOR);
+  for (int i = 0; i < count; i++) {
+    __vector_element_op_and_scalar_opV3(result.point_a, +, simplex[i].point_a, *, weights[i], result.point_a);
+    __vector_element_op_and_scalar_opV3(result.point_b, +, simplex[i].point_b, *, weights[i], result.point_b);
+  }
+
+  result.depth = 0.0f;
+  result.distance = __magnitudeV3(closest);
+  __vector_scalar_opV3(closest, *, -1.0f / result.distance, result.normal);
+  return false;
+}
+
+bool gjk_is_overlapping(const Shape& shape_a, const Shape& shape_b, GjkCache* cache) {
+  const GjkSupport support_a = { &shape_a, nullptr };
+  const GjkSupport support_b = { &shape_b, nullptr };
+
+  return support_is_overlapping(support_a, support_b, cache);
+}
+
+bool gjk_query(const Shape& shape_a, const Shape& shape_b, GjkResult& result, GjkCache* cache) {
+  const GjkSupport support_a = { &shape_a, nullptr };
+  const GjkSupport support_b = { &shape_b, nullptr };
+
+  return support_query(support_a, support_b, result, cache);
+}
+
+bool gjk_is_triangle_overlapping(const Shape& shape, const float corners[9]) {
+  const GjkSupport support_a = { &shape, nullptr };
+  const GjkSupport support_b = { nullptr, corners };
+
+  return support_is_overlapping(support_a, support_b, nullptr);
+}
+
+bool gjk_query_triangle(const Shape& shape, const float corners[9], GjkResult& result) {
+  const GjkSupport support_a = { &shape, nullptr };
+  const GjkSupport support_b = { nullptr, corners };
+
+  return support_query(support_a, support_b, result, nullptr);
+}
+
+GjkCache& GjkCacheTable::get(const Shape* shape_a, const Shape* shape_b) {
+  return m_caches[make_pair(shape_a, shape_b)];
+}
+
+GjkCache* GjkCacheTable::find(const Shape* shape_a, const Shape* shape_b) {
+  auto found = m_caches.find(make_pair(shape_a, shape_b));
+  return found != m_caches.end() ? &found->second : nullptr;
+}
+
+void GjkCacheTable::remove(const Shape* shape_a, const Shape* shape_b) {
+  m_caches.erase(make_pair(shape_a, shape_b));
+}
+
+void GjkCacheTable::remove(const Shape* shape) {
+  for (auto it = m_caches.begin(); it != m_caches.end();) {
+    if (it->first.first == shape || it->first.second == shape) {
+      it = m_caches.erase(it);
+    }
+    else {
+      it++;
+    }
+  }
+}
+
+void GjkCacheTable::clear() {
+  m_caches.clear();
+}
+
+size_t GjkCacheTable::PairHash::operator()(const pair<const Shape*, const Shape*>& pair) const {
+  const size_t hash_a = hash<const Shape*>()(pair.first);
+  const size_t hash_b = hash<const Shape*>()(pair.second);
+
+  return hash_a ^ (hash_b + 0x9e3779b9 + (hash_a << 6) + (hash_a >> 2));
+}
\ No newline at end of file
@@ -0,0 +1,94 @@
+#ifndef GJK_H
+#define GJK_H
+
+#include <unordered_map>
+#include <utility>
+#include <cstddef>
+
+#define GJK_MAX_ITERATIONS 32
+
+// squared distances of the simplex from the origin below this count as touching
+#define GJK_TOLERANCE 1e-10f
+
+// GJK stops once a new support point improves the distance by less than this fraction
+#define GJK_RELATIVE_TOLERANCE 1e-5f
+
+#define EPA_MAX_ITERATIONS 64
+#define EPA_MAX_VERTICES 64
+#define EPA_MAX_FACES 128
+
+// EPA stops once the polytope is within this distance of the Minkowski difference
+#define EPA_TOLERANCE 1e-4f
+
+class Shape;
+
+// a point of the Minkowski difference of two shapes with the support points and direction that produced it
+struct GjkVertex {
+  float point[3];
+  float point_a[3];
+  float point_b[3];
+  float direction[3];
+};
+
+// the search directions of the simplex that ended the last query of a pair of shapes, which start the next query
+// close to its answer while the shapes move little between frames
+struct GjkCache {
+  GjkCache();
+
+  float directions[4][3];
+  int direction_count;
+};
+
+struct GjkResult {
+  bool is_overlapping;
+
+  // separation of the shapes when apart, 0 otherwise
+  float distance;
+
+  // penetration depth of the shapes when overlapping, 0 otherwise
+  float depth;
+
+  // unit vector from shape_a towards shape_b along which the shapes are closest or least penetrating
+  float normal[3];
+
+  // closest or deepest points of each shape, in world coordinates
+  float point_a[3];
+  float point_b[3];
+};
+
+// tests whether the convex shapes overlap, stopping as soon as a separating direction is found
+bool gjk_is_overlapping(const Shape& shape_a, const Shape& shape_b, GjkCache* cache = nullptr);
+
+// finds the distance and closest points of convex shapes that are apart, or their penetration depth and normal through
+// EPA when they overlap, returning whether they overlap
+bool gjk_query(const Shape& shape_a, const Shape& shape_b, GjkResult& result, GjkCache* cache = nullptr);
+
+// the same tests between a convex shape, as shape_a, and a triangle with the given world corners, as shape_b
+bool gjk_is_triangle_overlapping(const Shape& shape, const float corners[9]);
+bool gjk_query_triangle(const Shape& shape, const float corners[9], GjkResult& result);
+
+// keeps a GjkCache for each ordered pair of shapes
+class GjkCacheTable {
+public:
+  // adds the pair when it has no cache yet
+  GjkCache& get(const Shape* shape_a, const Shape* shape_b);
+
+  // yields null for pairs without a cache, without adding them
+  GjkCache* find(const Shape* shape_a, const Shape* shape_b);
+
+  void remove(const Shape* shape_a, const Shape* shape_b);
+
+  // forgets every pair involving shape, for shapes that are removed
+  void remove(const Shape* shape);
+
+  void clear();
+
+private:
+  struct PairHash {
+    size_t operator()(const std::pair<const Shape*, const Shape*>& pair) const;
+  };
+
+  std::unordered_map<std::pair<const Shape*, const Shape*>, GjkCache, PairHash> m_caches;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,117 @@
+#include "Island.h"
+
+using namespace std;
+
+IslandManager::IslandManager(const int sleep_steps) {
+  m_sleep_steps = sleep_steps;
+}
+
+void IslandManager::add_body(Shape* shape, Acceleration* acceleration) {
+  Body body;
+
+  body.shape = shape;
+  body.acceleration = acceleration;
+  body.rest_steps = 0;
+  body.is_sleeping = false;
+  body.parent = (int)m_bodies.size();
+
+  m_body_indices[shape] = (int)m_bodies.size();
+  m_bodies.push_back(body);
+}
+
+void IslandManager::set_sleep_steps(const int sleep_steps) {
+  m_sleep_steps = sleep_steps;
+}
+
+void IslandManager::touch(const Shape* shape_a, const Shape* shape_b) {
+  auto it_a = m_body_indices.find(shape_a);
+  auto it_b = m_body_indices.find(shape_b);
+
+  if (it_a != m_body_indices.end() && it_b != m_body_indices.end()) {
+    m_touches.push_back(make_pair(it_a->second, it_b->second));
+  }
+}
+
+void IslandManager::update() {
+  // an island is moving when any of its bodies moves and ready when all of them have rested long enough
+  vector<bool> is_island_moving(m_bodies.size(), false);
+  vector<bool> is_island_ready(m_bodies.size(), true);
+
+  for (size_t i = 0; i < m_bodies.size(); i++) {
+    m_bodies[i].parent = (int)i;
+  }
+
+  for (size_t i = 0; i < m_touches.size(); i++) {
+    const int root_a = root_find(m_touches[i].first);
+    const int root_b = root_find(m_touches[i].second);
+
+    if (root_a != root_b) {
+      m_bodies[root_a].parent = root_b;
+    }
+  }
+  m_touches.clear();
+
+  for (size_t i = 0; i < m_bodies.size(); i++) {
+    Body& body = m_bodies[i];
+    const int root = root_find((int)i);
+
+    if (body.acceleration->c_velocity == 0.0f && body.acceleration->c_acceleration_current == 0.0f) {
+      body.rest_steps++;
+    }
+    else {
+      body.rest_steps = 0;
+      is_island_moving[root] = true;
+    }
+
+    if (!body.is_sleeping && body.rest_steps < m_sleep_steps) {
+      is_island_ready[root] = false;
+    }
+  }
+
+  for (size_t i = 0; i < m_bodies.size(); i++) {
+    Body& body = m_bodies[i];
+    const int root = root_find((int)i);
+
+    if (is_island_moving[root]) {
+      if (body.is_sleeping) {
+        body.is_sleeping = false;
+        body.rest_steps = 0;
+      }
+    }
+    else if (is_island_ready[root]) {
+      body.is_sleeping = true;
+    }
+  }
+}
+
+bool IslandManager::is_sleeping(const Shape* shape) const {
+  auto it = m_body_indices.find(shape);
+
+  return it != m_body_indices.end() && m_bodies[it->second].is_sleeping;
+}
+
+void IslandManager::wake(const Shape* shape) {
+  auto it = m_body_indices.find(shape);
+
+  if (it != m_body_indices.end()) {
+    m_bodies[it->second].is_sleeping = false;
+    m_bodies[it->second].rest_steps = 0;
+  }
+}
+
+int IslandManager::root_find(const int index) {
+  int root = index;
+
+  while (m_bodies[root].parent != root) {
+    root = m_bodies[root].parent;
+  }
+
+  // point the whole path at the root so later finds are short
+  for (int i = index; m_bodies[i].parent != root;) {
+    const int next = m_bodies[i].parent;
+    m_bodies[i].parent = root;
+    i = next;
+  }
+
+  return root;
+}
\ No newline at end of file
@@ -0,0 +1,62 @@
+#ifndef ISLAND_H
+#define ISLAND_H
+
+#include <vector>
+#include <unordered_map>
+
+#include "Shape.h"
+#include "Acceleration.h"
+
+// steps a body must stay at rest before it is put to sleep
+#define DEFAULT_SLEEP_STEPS 60
+
+// groups bodies that touch into islands and puts an island to sleep once all of its bodies have been at rest for a
+// while, so that parked bodies skip dynamics and index updates until something moving touches them
+class IslandManager {
+public:
+  IslandManager(const int sleep_steps = DEFAULT_SLEEP_STEPS);
+
+  const int& c_sleep_steps = m_sleep_steps;
+
+  // shapes that are not added are static and never join an island
+  void add_body(Shape* shape, Acceleration* acceleration);
+
+  void set_sleep_steps(const int sleep_steps);
+
+  // records that the shapes touched during this step
+  void touch(const Shape* shape_a, const Shape* shape_b);
+
+  // wakes the islands with a body that moved and puts the rest to sleep once they have rested long enough, then forgets
+  // the touches of this step
+  void update();
+
+  // yields false for shapes that are not bodies
+  bool is_sleeping(const Shape* shape) const;
+
+  // wakes shape right away; the rest of its island wakes once it moves while touching them
+  void wake(const Shape* shape);
+
+private:
+  struct Body {
+    Shape* shape;
+    Acceleration* acceleration;
+
+    int rest_steps;
+    bool is_sleeping;
+
+    // union-find link towards the root body of the island, rebuilt each update
+    int parent;
+  };
+
+  int m_sleep_steps;
+
+  std::vector<Body> m_bodies;
+  std::unordered_map<const Shape*, int> m_body_indices;
+
+  // pairs of body indices that touched this step
+  std::vector<std::pair<int, int>> m_touches;
+
+  int root_find(const int index);
+};
+
+#endif
\ No newline at end of file
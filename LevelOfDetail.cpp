@@ -0,0 +1,176 @@
+#include "LevelOfDetail.h"
+
+#include <cmath>
+#include <algorithm>
+using namespace std;
+
+#include "macro_constants.h"
+#include "vector3.h"
+
+// the number of thresholds in LOD_BOX_PIXELS, LOD_IMPOSTOR_PIXELS and LOD_SKIP_PIXELS that pixels is below
+static int level_for_pixels(const float pixels) {
+  if (pixels >= LOD_BOX_PIXELS) {
+    return LOD_FULL;
+  }
+  if (pixels >= LOD_IMPOSTOR_PIXELS) {
+    return LOD_BOX;
+  }
+  if (pixels >= LOD_SKIP_PIXELS) {
+    return LOD_IMPOSTOR;
+  }
+  return LOD_SKIP;
+}
+
+LevelOfDetail::LevelOfDetail() : m_box_shape(SHAPE_TYPE_CUBOID), m_impostor_shape(SHAPE_TYPE_MESH) {
+  const float square_vertices[12] = {
+    -0.5f, -0.5f, 0.0f
+    , 0.5f, -0.5f, 0.0f
+    , 0.5f, 0.5f, 0.0f
+    , -0.5f, 0.5f, 0.0f
+  };
+  const int square_indices[6] = { 0, 1, 2, 0, 2, 3 };
+
+  m_impostor_mesh.set_geometry(square_vertices, 4, square_indices, 2);
+  m_impostor_shape.set_mesh(&m_impostor_mesh);
+
+  fill(m_level_counts, m_level_counts + LOD_COUNT, 0);
+  m_triangle_count = 0;
+  m_saved_triangle_count = 0;
+
+  m_select_count = 0;
+}
+
+void LevelOfDetail::select(const float position[3], const float field_of_view_y, const int viewport_height, const vector<const Shape*>& shapes, vector<int>& levels_store) {
+  float center[3];
+  float radius;
+
+  // a sphere of radius r at distance d is about r pixel_scale / d pixels across
+  const float pixel_scale = viewport_height / tanf(field_of_view_y*0.5f / RAD_TO_DEG);
+
+  fill(m_level_counts, m_level_counts + LOD_COUNT, 0);
+  m_triangle_count = 0;
+  m_saved_triangle_count = 0;
+  m_select_count++;
+
+  levels_store.resize(shapes.size());
+
+  for (size_t i = 0; i < shapes.size(); i++) {
+    const Shape& shape = *shapes[i];
+
+    shape.bounding_sphere_store(center, radius);
+
+    // the camera inside the bounds sees the shape as large as can be
+    const float distance = __distanceV3(position, center);
+    const float pixels = distance > radius ? radius*pixel_scale / distance : LOD_BOX_PIXELS*2.0f;
+
+    int level = level_for_pixels(pixels);
+
+    // only leave the last level once the size is clear of the threshold by the hysteresis on either side
+    unordered_map<const Shape*, History>::iterator found = m_history.find(&shape);
+    if (found != m_history.end() && found->second.select_count + 1 == m_select_count) {
+      const int level_finest = level_for_pixels(pixels*(1.0f + LOD_HYSTERESIS));
+      const int level_coarsest = level_for_pixels(pixels*(1.0f - LOD_HYSTERESIS));
+
+      level = min(max(found->second.level, level_finest), level_coarsest);
+    }
+
+    History& history = m_history[&shape];
+    history.level = level;
+    history.select_count = m_select_count;
+
+    levels_store[i] = level;
+    m_level_counts[level]++;
+
+    const int full_triangles = level_triangle_count(shape, LOD_FULL);
+    const int triangles = level_triangle_count(shape, level);
+    m_triangle_count += triangles;
+    m_saved_triangle_count += full_triangles - triangles;
+  }
+
+  // forget shapes that left the view, so that the history does not grow with every shape ever seen
+  for (unordered_map<const Shape*, History>::iterator it = m_history.begin(); it != m_history.end();) {
+    if (it->second.select_count != m_select_count) {
+      it = m_history.erase(it);
+    }
+    else {
+      ++it;
+    }
+  }
+}
+
+const Shape* LevelOfDetail::proxy_store(const Shape& shape, const int level, const float position[3], float model[16]) const {
+  float min[3];
+  float max[3];
+  float center[3];
+  float half_extent[3];
+
+  float toward[3];
+  float right[3];
+  float up[3];
+
+  // a box is no cheaper than a cuboid
+  if (level == LOD_FULL || (level == LOD_BOX && shape.c_shape_type == SHAPE_TYPE_CUBOID)) {
+    shape.model_matrix_store(model);
+    return &shape;
+  }
+
+  shape.aabb_store(min, max);
+  for (int i = 0; i < 3; i++) {
+    center[i] = (min[i] + max[i])*0.5f;
+    half_extent[i] = (max[i] - min[i])*0.5f;
+  }
+
+  for (int i = 0; i < 16; i++) {
+    model[i] = 0.0f;
+  }
+  model[12] = center[0];
+  model[13] = center[1];
+  model[14] = center[2];
+  model[15] = 1.0f;
+
+  if (level == LOD_BOX) {
+    model[0] = half_extent[0]*2.0f;
+    model[5] = half_extent[1]*2.0f;
+    model[10] = half_extent[2]*2.0f;
+    return &m_box_shape;
+  }
+
+  // the card turns about the vertical towards the camera, or about the view when looking straight down on it
+  __vector_element_opV3(position, -, center, toward);
+  if (__dot_productV3(toward, toward) == 0.0f) {
+    toward[DIM_Z] = 1.0f;
+  }
+  normalizeV3(toward);
+
+  right[0] = toward[2];
+  right[1] = 0.0f;
+  right[2] = -toward[0];
+  if (__dot_productV3(right, right) < 1e-6f) {
+    right[0] = 1.0f;
+    right[2] = 0.0f;
+  }
+  normalizeV3(right);
+  __cross_productV3(toward, right, up);
+
+  // the card is as wide and tall as the bounds appear from the camera
+  const float width = (fabsf(right[0])*half_extent[0] + fabsf(right[1])*half_extent[1] + fabsf(right[2])*half_extent[2])*2.0f;
+  const float height = (fabsf(up[0])*half_extent[0] + fabsf(up[1])*half_extent[1] + fabsf(up[2])*half_extent[2])*2.0f;
+
+  __vector_scalar_opV3(right, *, width, model);
+  __vector_scalar_opV3(up, *, height, (model + 4));
+  __vector_element_assign_opV3((model + 8), =, toward);
+  return &m_impostor_shape;
+}
+
+int LevelOfDetail::level_triangle_count(const Shape& shape, const int level) {
+  switch (level) {
+  case LOD_FULL:
+    return shape.triangle_count();
+  case LOD_BOX:
+    return 12;
+  case LOD_IMPOSTOR:
+    return 2;
+  default:
+    return 0;
+  }
+}
\ No newline at end of file
@@ -0,0 +1,69 @@
+#ifndef LEVEL_OF_DETAIL_H
+#define LEVEL_OF_DETAIL_H
+
+#include <vector>
+#include <unordered_map>
+
+#include "Shape.h"
+#include "TriangleMesh.h"
+
+// a shape is drawn as itself, as a box over its bounds, as a flat card facing the camera, or not at all
+#define LOD_FULL 0
+#define LOD_BOX 1
+#define LOD_IMPOSTOR 2
+#define LOD_SKIP 3
+#define LOD_COUNT 4
+
+// projected diameters in pixels below which a shape drops to a box, a card, and nothing
+#define LOD_BOX_PIXELS 48.0f
+#define LOD_IMPOSTOR_PIXELS 12.0f
+#define LOD_SKIP_PIXELS 2.0f
+
+// fraction by which the projected diameter must pass a threshold before a shape seen before changes level, so that
+// shapes near a threshold do not pop back and forth
+#define LOD_HYSTERESIS 0.2f
+
+// picks how much detail to draw shapes with from their size on screen, for one view; each view keeps its own
+// instance, since the levels shapes had when last seen are what the hysteresis works from
+class LevelOfDetail {
+public:
+  LevelOfDetail();
+
+  // shapes at each level in the last select
+  const int* c_level_counts = m_level_counts;
+
+  // triangles the last select leaves to draw, and those it saves over drawing every shape in full
+  const int& c_triangle_count = m_triangle_count;
+  const int& c_saved_triangle_count = m_saved_triangle_count;
+
+  // stores the level of each of shapes as seen from position through a vertical field of view spread over
+  // viewport_height pixels
+  void select(const float position[3], const float field_of_view_y, const int viewport_height, const std::vector<const Shape*>& shapes, std::vector<int>& levels_store);
+
+  // stores the model matrix to draw shape with at level and returns the shape whose geometry is drawn, which is
+  // shape itself at LOD_FULL and a shared stand-in otherwise; cards face position
+  const Shape* proxy_store(const Shape& shape, const int level, const float position[3], float model[16]) const;
+
+  static int level_triangle_count(const Shape& shape, const int level);
+
+private:
+  struct History {
+    int level;
+    unsigned int select_count;
+  };
+
+  // a unit cube, and a unit square in the XY-plane facing +Z
+  Shape m_box_shape;
+  Shape m_impostor_shape;
+  TriangleMesh m_impostor_mesh;
+
+  int m_level_counts[LOD_COUNT];
+  int m_triangle_count;
+  int m_saved_triangle_count;
+
+  // the level of each shape as of the last select that saw it
+  std::unordered_map<const Shape*, History> m_history;
+  unsigned int m_select_count;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,171 @@
+#include "Lidar.h"
+
+#include <cmath>
+#include <atomic>
+using namespace std;
+
+#include "macro_constants.h"
+#include "vector3.h"
+
+Lidar::Lidar() {
+  m_mount = NULL_SHAPE_PTR;
+  m_terrain = nullptr;
+
+  __vector_element_assign_opV3(m_offset, =, ZERO_VECTOR);
+
+  m_range = DEFAULT_LIDAR_RANGE;
+
+  m_period = DEFAULT_LIDAR_PERIOD;
+  m_seconds_since_scan = 0.0f;
+
+  m_hit_count = 0;
+  m_scan_count = 0;
+
+  set_beams(DEFAULT_LIDAR_CHANNELS, DEFAULT_LIDAR_AZIMUTH_STEPS, DEFAULT_LIDAR_VERTICAL_ANGLE_MIN, DEFAULT_LIDAR_VERTICAL_ANGLE_MAX);
+}
+
+void Lidar::attach(const Shape* mount) {
+  m_mount = mount;
+}
+
+void Lidar::set_terrain(const Terrain* terrain) {
+  m_terrain = terrain;
+}
+
+void Lidar::set_offset(const float offset_right, const float offset_up, const float offset_forward) {
+  m_offset[DIM_X] = offset_right;
+  m_offset[DIM_Y] = offset_up;
+  m_offset[DIM_Z] = offset_forward;
+}
+
+void Lidar::set_beams(const int channels, const int azimuth_steps, const float vertical_angle_min, const float vertical_angle_max) {
+  m_channels = channels > 0 ? channels : 1;
+  m_azimuth_steps = azimuth_steps > 0 ? azimuth_steps : 1;
+  m_beam_count = m_channels*m_azimuth_steps;
+
+  m_vertical_angle_min = vertical_angle_min;
+  m_vertical_angle_max = vertical_angle_max;
+
+  // allocate the output once so that scans never allocate
+  m_points.assign(m_beam_count*LIDAR_POINT_STRIDE, 0.0f);
+  m_hit_count = 0;
+
+  build_directions();
+}
+
+void Lidar::set_range(const float range) {
+  m_range = range;
+}
+
+void Lidar::set_period(const float seconds) {
+  m_period = seconds > LIDAR_PERIOD_MIN ? seconds : LIDAR_PERIOD_MIN;
+}
+
+bool Lidar::update(const float seconds, const SpatialIndex& index, WorkerPool& pool) {
+  m_seconds_since_scan += seconds;
+
+  if (m_seconds_since_scan < m_period) {
+    return false;
+  }
+
+  // drop whole missed periods instead of scanning several times in one frame
+  m_seconds_since_scan = fmodf(m_seconds_since_scan, m_period);
+
+  scan(index, pool);
+  return true;
+}
+
+void Lidar::scan(const SpatialIndex& index, WorkerPool& pool) {
+  float origin[3];
+  float basis[9];
+  atomic<int> hit_count(0);
+
+  if (m_mount == NULL_SHAPE_PTR) {
+    return;
+  }
+
+  // copy the mount pose so that every worker reads the same one
+  __vector_element_assign_opV3(basis, =, m_mount->c_vector_right);
+  __vector_element_assign_opV3((basis + 3), =, m_mount->c_vector_up);
+  __vector_element_assign_opV3((basis + 6), =, m_mount->c_vector_forward);
+
+  origin[DIM_X] = m_mount->c_position_x + basis[0]*m_offset[DIM_X] + basis[3]*m_offset[DIM_Y] + basis[6]*m_offset[DIM_Z];
+  origin[DIM_Y] = m_mount->c_position_y + basis[1]*m_offset[DIM_X] + basis[4]*m_offset[DIM_Y] + basis[7]*m_offset[DIM_Z];
+  origin[DIM_Z] = m_mount->c_position_z + basis[2]*m_offset[DIM_X] + basis[5]*m_offset[DIM_Y] + basis[8]*m_offset[DIM_Z];
+
+  pool.parallel_for(m_beam_count, LIDAR_BEAMS_PER_TASK, [&](const int begin, const int end) {
+    float direction[3];
+    const float* local;
+    float* point;
+    RayHit hit;
+    bool is_hit;
+    float terrain_distance;
+    int chunk_hit_count = 0;
+
+    for (int i = begin; i < end; i++) {
+      local = &m_directions_local[i*3];
+      point = &m_points[i*LIDAR_POINT_STRIDE];
+
+      direction[DIM_X] = basis[0]*local[DIM_X] + basis[3]*local[DIM_Y] + basis[6]*local[DIM_Z];
+      direction[DIM_Y] = basis[1]*local[DIM_X] + basis[4]*local[DIM_Y] + basis[7]*local[DIM_Z];
+      direction[DIM_Z] = basis[2]*local[DIM_X] + basis[5]*local[DIM_Y] + basis[8]*local[DIM_Z];
+
+      is_hit = index.ray_cast_first(origin, direction, m_range, hit, m_mount);
+
+      // the terrain only needs to be searched up to the closest shape
+      if (m_terrain != nullptr
+        && m_terrain->ray_cast(origin, direction, is_hit ? hit.distance : m_range, terrain_distance, hit.normal)
+        )
+      {
+        is_hit = true;
+        hit.distance = terrain_distance;
+        __vector_element_op_and_scalar_opV3(origin, +, direction, *, terrain_distance, hit.point);
+      }
+
+      if (is_hit) {
+        __vector_element_assign_opV3(point, =, hit.point);
+        point[3] = hit.distance;
+        chunk_hit_count++;
+      }
+      else {
+        __vector_element_op_and_scalar_opV3(origin, +, direction, *, m_range, point);
+        point[3] = LIDAR_NO_RETURN;
+      }
+    }
+
+    hit_count += chunk_hit_count;
+  });
+
+  m_hit_count = hit_count;
+  m_scan_count++;
+}
+
+void Lidar::build_directions() {
+  float angle_horizontal;
+  float angle_vertical;
+  float cos_of_vertical;
+  float* direction;
+
+  m_directions_local.resize(m_beam_count*3);
+
+  for (int step = 0; step < m_azimuth_steps; step++) {
+    angle_horizontal = DOUBLE_PI*step / m_azimuth_steps;
+
+    for (int channel = 0; channel < m_channels; channel++) {
+      // spread the channels evenly between the vertical limits
+      if (m_channels == 1) {
+        angle_vertical = (m_vertical_angle_min + m_vertical_angle_max)*0.5f;
+      }
+      else {
+        angle_vertical = m_vertical_angle_min + (m_vertical_angle_max - m_vertical_angle_min)*channel / (m_channels - 1);
+      }
+
+      cos_of_vertical = cosf(angle_vertical);
+
+      direction = &m_directions_local[(step*m_channels + channel)*3];
+      direction[DIM_X] = sinf(angle_horizontal)*cos_of_vertical;
+      direction[DIM_Y] = sinf(angle_vertical);
+      direction[DIM_Z] = cosf(angle_horizontal)*cos_of_vertical;
+    }
+  }
+}
\ No newline at end of file
@@ -0,0 +1,90 @@
+#ifndef LIDAR_H
+#define LIDAR_H
+
+#include <vector>
+
+#include "Shape.h"
+#include "SpatialIndex.h"
+#include "WorkerPool.h"
+#include "Terrain.h"
+
+#define DEFAULT_LIDAR_CHANNELS 32
+#define DEFAULT_LIDAR_AZIMUTH_STEPS 1024
+#define DEFAULT_LIDAR_VERTICAL_ANGLE_MIN -0.26f
+#define DEFAULT_LIDAR_VERTICAL_ANGLE_MAX 0.09f
+#define DEFAULT_LIDAR_RANGE 100.0f
+#define DEFAULT_LIDAR_PERIOD 0.1f
+
+// shortest period set_period accepts, since update divides the time since the last scan by it
+#define LIDAR_PERIOD_MIN 0.001f
+
+// number of beams handed to a worker at a time
+#define LIDAR_BEAMS_PER_TASK 512
+
+// distance stored for beams that did not hit anything within range
+#define LIDAR_NO_RETURN -1.0f
+
+// elements stored per beam in the point cloud: hit position x, y, z then distance
+#define LIDAR_POINT_STRIDE 4
+
+// a spinning multi-beam range sensor mounted on a shape
+class Lidar {
+public:
+  Lidar();
+
+  const Shape* const& c_mount = m_mount;
+
+  const int& c_channels = m_channels;
+  const int& c_azimuth_steps = m_azimuth_steps;
+  const int& c_beam_count = m_beam_count;
+  const float& c_range = m_range;
+  const float& c_period = m_period;
+
+  // point cloud of the last scan, ordered by azimuth step then channel
+  const std::vector<float>& c_points = m_points;
+  const int& c_hit_count = m_hit_count;
+  const unsigned int& c_scan_count = m_scan_count;
+
+  void attach(const Shape* mount);
+  void set_terrain(const Terrain* terrain);
+
+  void set_offset(const float offset_right, const float offset_up, const float offset_forward);
+  void set_beams(const int channels, const int azimuth_steps, const float vertical_angle_min, const float vertical_angle_max);
+  void set_range(const float range);
+  void set_period(const float seconds);
+
+  // advances the sensor clock and scans once a period has passed, returning whether a new point cloud is ready
+  bool update(const float seconds, const SpatialIndex& index, WorkerPool& pool);
+
+  void scan(const SpatialIndex& index, WorkerPool& pool);
+
+private:
+  const Shape* m_mount;
+  const Terrain* m_terrain;
+
+  // mounting position in the frame of m_mount
+  float m_offset[3];
+
+  int m_channels;
+  int m_azimuth_steps;
+  int m_beam_count;
+
+  float m_vertical_angle_min;
+  float m_vertical_angle_max;
+
+  float m_range;
+
+  float m_period;
+  float m_seconds_since_scan;
+
+  // unit beam directions in the frame of m_mount, three elements per beam
+  std::vector<float> m_directions_local;
+
+  std::vector<float> m_points;
+  int m_hit_count;
+  unsigned int m_scan_count;
+
+  void build_directions();
+};
+
+#endif
\ No newline at end of file
@@ -7,6 +7,7 @@ using namespace std;
 #include "macro_constants.h"
 
 Object::Object() {
+  m_pose_version = 0;
   reset();
 }
 
@@ -23,12 +24,16 @@ void Object::reset() {
   m_matrix_rotation[0] = m_vector_rotation + 0;
   m_matrix_rotation[1] = m_vector_rotation + 3;
   m_matrix_rotation[2] = m_vector_rotation + 6;
+
+  m_pose_version++;
 }
 
 void Object::move(const float distance_right, const float distance_up, const float distance_forward) {
   m_position_x += m_vector_right_x*distance_right + m_vector_up_x*distance_up + m_vector_forward_x*distance_forward;
   m_position_y += m_vector_right_y*distance_right + m_vector_up_y*distance_up + m_vector_forward_y*distance_forward;
   m_position_z += m_vector_right_z*distance_right + m_vector_up_z*distance_up + m_vector_forward_z*distance_forward;
+
+  m_pose_version++;
 }
 void Object::move(const float distance_vector[3]) {
   float temp_vector[3];
@@ -40,6 +45,8 @@ void Object::move(const float distance_vector[3]) {
 
   __vector_scalar_opV3(m_vector_forward, *, distance_vector[DIM_Z], temp_vector);
   __vector_element_assign_opV3(m_position, +=, temp_vector);
+
+  m_pose_version++;
 }
 
 
@@ -47,18 +54,26 @@ void Object::translate(const float vector_x, const float vector_y, const float v
   m_position_x += vector_x;
   m_position_y += vector_y;
   m_position_z += vector_z;
+
+  m_pose_version++;
 }
 void Object::translate(const float vector[3]) {
   __vector_element_assign_opV3(m_position, +=, vector);
+
+  m_pose_version++;
 }
 
 void Object::translate_to(const float vector_x, const float vector_y, const float vector_z) {
   m_position_x = vector_x;
   m_position_y = vector_y;
   m_position_z = vector_z;
+
+  m_pose_version++;
 }
 void Object::translate_to(const float vector[3]) {
   __vector_element_assign_opV3(m_position, =, vector);
+
+  m_pose_version++;
 }
 
 void Object::rotate_horizontal(const float angle) {
@@ -103,6 +118,8 @@ void Object::rotate_horizontal(const float angle) {
   // find the angle from the Z unit vector to this projected vector
   m_angle_horizontal = acosf(__dot_productV3(UNIT_VECTOR_Z, temp_vector));
   m_angle_horizontal *= side_of_vector_signV3(UNIT_VECTOR_Z, temp_vector, UNIT_VECTOR_Y);
+
+  m_pose_version++;
 }
 
 void Object::rotate_vertical(const float angle) {
@@ -190,6 +207,8 @@ void Object::rotate_vertical(const float angle) {
   if (m_angle_vertical != m_angle_vertical) {
     m_angle_vertical = 0.0f;
   }
+
+  m_pose_version++;
 }
 
 void Object::rotate_horizontal_from_vector(const float angle, const float vector[3]) {
@@ -240,4 +259,33 @@ void Object::set_angle_horizontal(const float angle) {
 }
 void Object::set_angle_vertical(const float angle) {
   rotate_vertical(angle - m_angle_vertical);
+}
+
+void Object::set_basis(const float vector_right[3], const float vector_up[3], const float vector_forward[3]) {
+  float projected_vector[3];
+
+  __vector_element_assign_opV3(m_vector_right, =, vector_right);
+  __vector_element_assign_opV3(m_vector_up, =, vector_up);
+  __vector_element_assign_opV3(m_vector_forward, =, vector_forward);
+
+  // project m_vector_forward onto XZ_plane and normalize
+  __vector_element_assign_opV3(projected_vector, =, m_vector_forward);
+  projected_vector[DIM_Y] = 0.0f;
+  normalizeV3(projected_vector);
+
+  // find the angles as rotate_horizontal and rotate_vertical do
+  m_angle_horizontal = acosf(__dot_productV3(UNIT_VECTOR_Z, projected_vector));
+  m_angle_horizontal *= side_of_vector_signV3(UNIT_VECTOR_Z, projected_vector, UNIT_VECTOR_Y);
+
+  m_angle_vertical = acosf(__dot_productV3(projected_vector, m_vector_forward));
+  m_angle_vertical *= -side_of_vector_signV3(projected_vector, m_vector_forward, m_vector_right);
+
+  if (m_angle_horizontal != m_angle_horizontal) {
+    m_angle_horizontal = 0.0f;
+  }
+  if (m_angle_vertical != m_angle_vertical) {
+    m_angle_vertical = 0.0f;
+  }
+
+  m_pose_version++;
 }
\ No newline at end of file
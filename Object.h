@@ -28,8 +28,17 @@ public:
   const float& c_vector_up_y = m_vector_up[1];
   const float& c_vector_up_z = m_vector_up[2];
 
+  const float* c_vector_right = m_vector_right;
+  const float& c_vector_right_x = m_vector_right[0];
+  const float& c_vector_right_y = m_vector_right[1];
+  const float& c_vector_right_z = m_vector_right[2];
+
   const float& c_angle_horizontal = m_angle_horizontal;
   const float& c_angle_vertical = m_angle_vertical;
+
+  // changes whenever the object is moved or rotated, or a subclass changes its extent, so that values derived from its
+  // pose can be cached
+  const unsigned int& c_pose_version = m_pose_version;
   //-----------------------------------------------------------------
 
   virtual void move(const float distance_right, const float distance_up, const float distance_forward);
@@ -50,6 +59,9 @@ public:
   void set_angle_horizontal(const float angle);
   void set_angle_vertical(const float angle);
 
+  // sets the orientation from normalized basis vectors, deriving the angles from vector_forward
+  void set_basis(const float vector_right[3], const float vector_up[3], const float vector_forward[3]);
+
 protected:
   // the position of the object
   float m_position[3];
@@ -79,6 +91,8 @@ protected:
   float m_angle_horizontal;
   float m_angle_vertical;
 
+  unsigned int m_pose_version;
+
   // used for storage of a rotation matrix instead of allocating one for each method call
   float m_vector_rotation[9];
   float* m_matrix_rotation[3];
@@ -0,0 +1,253 @@
+#include "Profiler.h"
+
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <iomanip>
+using namespace std;
+using namespace std::chrono;
+
+static const char* STAGE_NAMES[PROFILE_STAGE_COUNT] = {
+  "step"
+  , "input"
+  , "movement"
+  , "camera"
+  , "culling"
+  , "frame"
+  , "render"
+  , "swap"
+  , "task"
+};
+
+Profiler::Profiler() {
+  m_epoch = steady_clock::now();
+}
+
+Profiler::~Profiler() {
+  for (size_t i = 0; i < m_rings.size(); i++) {
+    delete m_rings[i];
+  }
+}
+
+const char* Profiler::stage_name(const int stage) {
+  return stage >= 0 && stage < PROFILE_STAGE_COUNT ? STAGE_NAMES[stage] : "unknown";
+}
+
+void Profiler::set_thread_name(const string& name) {
+  Ring* ring = ring_find();
+
+  lock_guard<mutex> lock(m_rings_mutex);
+  ring->thread_name = name;
+}
+
+void Profiler::record(const int stage, const steady_clock::time_point start, const float seconds) {
+  Ring* ring = ring_find();
+  unsigned int bits;
+
+  memcpy(&bits, &seconds, sizeof(bits));
+
+  // only this thread writes to ring, so the count can be read and then advanced
+  const unsigned int write_count = ring->write_count.load(memory_order_relaxed);
+  const unsigned int slot = write_count % PROFILE_RING_SIZE;
+
+  // a reader that sees this sample then sees the count published by the last record
+  atomic_thread_fence(memory_order_release);
+
+  ring->samples[slot].store(((unsigned long long)stage << 32) | bits, memory_order_relaxed);
+  ring->starts[slot].store((unsigned long long)duration_cast<nanoseconds>(start - m_epoch).count(), memory_order_relaxed);
+  ring->write_count.store(write_count + 1, memory_order_release);
+}
+
+void Profiler::stats_store(const int stage, ProfileStats& stats) const {
+  vector<Sample> ring_samples;
+  vector<float> samples;
+
+  {
+    lock_guard<mutex> lock(m_rings_mutex);
+
+    for (size_t r = 0; r < m_rings.size(); r++) {
+      samples_append(*m_rings[r], ring_samples);
+    }
+  }
+
+  for (size_t i = 0; i < ring_samples.size(); i++) {
+    if (ring_samples[i].stage == stage) {
+      samples.push_back(ring_samples[i].seconds);
+    }
+  }
+
+  stats.count = (int)samples.size();
+  if (samples.empty()) {
+    stats.min = 0.0f;
+    stats.average = 0.0f;
+    stats.median = 0.0f;
+    stats.p99 = 0.0f;
+    stats.max = 0.0f;
+    return;
+  }
+
+  sort(samples.begin(), samples.end());
+
+  double sum = 0.0;
+  for (size_t i = 0; i < samples.size(); i++) {
+    sum += samples[i];
+  }
+
+  stats.min = samples.front();
+  stats.average = (float)(sum / samples.size());
+  stats.median = samples[samples.size() / 2];
+  stats.p99 = samples[min(samples.size() - 1, samples.size()*99 / 100)];
+  stats.max = samples.back();
+}
+
+void Profiler::report(ostream& out) const {
+  ProfileStats stats;
+
+  out << left << setw(10) << "stage" << right
+    << setw(8) << "count"
+    << setw(10) << "min ms"
+    << setw(10) << "avg ms"
+    << setw(10) << "p50 ms"
+    << setw(10) << "p99 ms"
+    << setw(10) << "max ms" << endl;
+
+  out << fixed << setprecision(3);
+  for (int stage = 0; stage < PROFILE_STAGE_COUNT; stage++) {
+    stats_store(stage, stats);
+    if (stats.count == 0) {
+      continue;
+    }
+
+    out << left << setw(10) << stage_name(stage) << right
+      << setw(8) << stats.count
+      << setw(10) << stats.min*1000.0f
+      << setw(10) << stats.average*1000.0f
+      << setw(10) << stats.median*1000.0f
+      << setw(10) << stats.p99*1000.0f
+      << setw(10) << stats.max*1000.0f << endl;
+  }
+  out.unsetf(ios::floatfield);
+  out << setprecision(6);
+}
+
+bool Profiler::write_trace(const char* path, const int frame_count) const {
+  vector<Sample> samples;
+  vector<size_t> ring_ends;
+  vector<string> thread_names;
+
+  {
+    lock_guard<mutex> lock(m_rings_mutex);
+
+    for (size_t r = 0; r < m_rings.size(); r++) {
+      samples_append(*m_rings[r], samples);
+      ring_ends.push_back(samples.size());
+      thread_names.push_back(m_rings[r]->thread_name);
+    }
+  }
+
+  // the window opens with the earliest of the last frame_count frames, or with the oldest sample held
+  vector<unsigned long long> frame_starts;
+  for (size_t i = 0; i < samples.size(); i++) {
+    if (samples[i].stage == PROFILE_STAGE_FRAME) {
+      frame_starts.push_back(samples[i].start);
+    }
+  }
+  sort(frame_starts.begin(), frame_starts.end());
+
+  unsigned long long window_start = 0;
+  if (frame_count > 0 && (int)frame_starts.size() > frame_count) {
+    window_start = frame_starts[frame_starts.size() - frame_count];
+  }
+
+  FILE* file = fopen(path, "w");
+
+  if (file == NULL) {
+    return false;
+  }
+
+  fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+
+  // threads are numbered in the order they first recorded
+  size_t first = 0;
+  for (size_t r = 0; r < ring_ends.size(); r++) {
+    if (thread_names[r].empty()) {
+      thread_names[r] = "thread " + to_string(r);
+    }
+    fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}", r == 0 ? "" : ",\n", (int)r, thread_names[r].c_str());
+
+    for (size_t i = first; i < ring_ends[r]; i++) {
+      const Sample& sample = samples[i];
+      const unsigned long long duration_ns = (unsigned long long)(sample.seconds*1e9f);
+
+      if (sample.start + duration_ns < window_start) {
+        continue;
+      }
+
+      // complete events in microseconds since the profiler was made
+      fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}"
+        , stage_name(sample.stage)
+        , (int)r
+        , (double)sample.start / 1000.0
+        , (double)duration_ns / 1000.0
+        );
+    }
+    first = ring_ends[r];
+  }
+
+  fprintf(file, "\n]}\n");
+
+  return fclose(file) == 0;
+}
+
+Profiler::Ring* Profiler::ring_find() {
+  // the ring of the calling thread, as long as it records into one profiler
+  thread_local const Profiler* ring_owner = nullptr;
+  thread_local Ring* ring = nullptr;
+
+  if (ring_owner != this) {
+    lock_guard<mutex> lock(m_rings_mutex);
+
+    ring = new Ring();
+    m_rings.push_back(ring);
+    ring_owner = this;
+  }
+
+  return ring;
+}
+
+ProfileTimer::ProfileTimer(Profiler& profiler, const int stage) : m_profiler(profiler) {
+  m_stage = stage;
+  m_start = steady_clock::now();
+}
+
+ProfileTimer::~ProfileTimer() {
+  m_profiler.record(m_stage, m_start, duration<float>(steady_clock::now() - m_start).count());
+}
+
+void Profiler::samples_append(const Ring& ring, vector<Sample>& samples) const {
+  const unsigned int write_count = ring.write_count.load(memory_order_acquire);
+  const unsigned int read_count = min(write_count, (unsigned int)PROFILE_RING_SIZE);
+  const size_t first = samples.size();
+  Sample sample;
+
+  for (unsigned int i = write_count - read_count; i != write_count; i++) {
+    const unsigned long long packed = ring.samples[i % PROFILE_RING_SIZE].load(memory_order_relaxed);
+    const unsigned int bits = (unsigned int)packed;
+
+    sample.stage = (int)(packed >> 32);
+    memcpy(&sample.seconds, &bits, sizeof(sample.seconds));
+    sample.start = ring.starts[i % PROFILE_RING_SIZE].load(memory_order_relaxed);
+    samples.push_back(sample);
+  }
+
+  // every sample written while copying may have replaced one of the oldest copied, and once the ring is full the
+  // oldest slot may also be half written by a sample not yet counted
+  atomic_thread_fence(memory_order_acquire);
+  unsigned int lapped_count = ring.write_count.load(memory_order_relaxed) - write_count;
+  if (read_count == PROFILE_RING_SIZE) {
+    lapped_count++;
+  }
+  lapped_count = min(lapped_count, read_count);
+
+  samples.erase(samples.begin() + first, samples.begin() + first + lapped_count);
+}
\ No newline at end of file
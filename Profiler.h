@@ -0,0 +1,110 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// stages timed on the simulation thread
+#define PROFILE_STAGE_STEP 0
+#define PROFILE_STAGE_INPUT 1
+#define PROFILE_STAGE_MOVEMENT 2
+#define PROFILE_STAGE_CAMERA 3
+#define PROFILE_STAGE_CULLING 4
+
+// stages timed on the GLUT thread
+#define PROFILE_STAGE_FRAME 5
+#define PROFILE_STAGE_RENDER 6
+#define PROFILE_STAGE_SWAP 7
+
+// the chunks a thread ran of one parallel_for
+#define PROFILE_STAGE_TASK 8
+
+#define PROFILE_STAGE_COUNT 9
+
+// samples kept for each thread, after which the oldest are overwritten
+#define PROFILE_RING_SIZE 4096
+
+// durations in seconds over the samples of one stage
+struct ProfileStats {
+  int count;
+  float min;
+  float average;
+  float median;
+  float p99;
+  float max;
+};
+
+// keeps the last PROFILE_RING_SIZE durations recorded by each thread in a ring of its own, so that threads never wait
+// on each other or on a reader to record
+class Profiler {
+public:
+  Profiler();
+  ~Profiler();
+
+  static const char* stage_name(const int stage);
+
+  // names the calling thread in traces
+  void set_thread_name(const std::string& name);
+
+  // locks only the first time the calling thread records
+  void record(const int stage, const std::chrono::steady_clock::time_point start, const float seconds);
+
+  // over the samples of stage still held by every thread
+  void stats_store(const int stage, ProfileStats& stats) const;
+
+  // writes a line of stats for each stage with samples, in milliseconds
+  void report(std::ostream& out) const;
+
+  // writes the samples of every thread that end within the last frame_count frames as Chrome trace events, which
+  // chrome://tracing and Perfetto open
+  bool write_trace(const char* path, const int frame_count) const;
+
+private:
+  struct Sample {
+    int stage;
+    float seconds;
+
+    // nanoseconds since the profiler was made
+    unsigned long long start;
+  };
+
+  // each sample packs the stage into the high word and the bits of the float duration into the low word, with its
+  // start kept alongside
+  struct Ring {
+    std::atomic<unsigned long long> samples[PROFILE_RING_SIZE];
+    std::atomic<unsigned long long> starts[PROFILE_RING_SIZE];
+    std::atomic<unsigned int> write_count;
+
+    // only changed with m_rings_mutex held
+    std::string thread_name;
+  };
+
+  std::chrono::steady_clock::time_point m_epoch;
+
+  // rings are only added, and are kept until the profiler goes
+  mutable std::mutex m_rings_mutex;
+  std::vector<Ring*> m_rings;
+
+  Ring* ring_find();
+
+  // appends the samples of ring still held once copied, oldest first, with m_rings_mutex held
+  void samples_append(const Ring& ring, std::vector<Sample>& samples) const;
+};
+
+// records the time from its construction to its destruction
+class ProfileTimer {
+public:
+  ProfileTimer(Profiler& profiler, const int stage);
+  ~ProfileTimer();
+
+private:
+  Profiler& m_profiler;
+  int m_stage;
+  std::chrono::steady_clock::time_point m_start;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,478 @@
+#include "RenderQueue.h"
+
+// draws cuboids with one instanced call when the context allows it, which needs GLEW to build
+#define RENDER_INSTANCING 1
+
+#if RENDER_INSTANCING
+#include <gl/glew.h>
+#endif
+#include <gl/glut.h>
+#include <gl/gl.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+using namespace std;
+
+#include "matrix4.h"
+
+#define CUBE_VERTEX_COUNT 36
+
+#if RENDER_INSTANCING
+// generic attribute locations; 0 aliases the vertex position
+#define ATTRIBUTE_POSITION 0
+#define ATTRIBUTE_NORMAL 1
+#define ATTRIBUTE_MODEL 2
+#define ATTRIBUTE_COLOR 6
+#define ATTRIBUTE_REFLECTANCE 7
+#define ATTRIBUTE_SHININESS 8
+
+// light 0 and the material as the fixed-function pipeline applies them with a viewer at infinity; the model matrix is
+// a rotation and scale, so normals only need each column divided by its squared length
+static const char* VERTEX_SHADER_SOURCE =
+  "#version 120\n"
+  "attribute vec3 position;\n"
+  "attribute vec3 normal;\n"
+  "attribute vec4 model_0;\n"
+  "attribute vec4 model_1;\n"
+  "attribute vec4 model_2;\n"
+  "attribute vec4 model_3;\n"
+  "attribute vec4 color;\n"
+  "attribute vec4 reflectance;\n"
+  "attribute float shininess;\n"
+  "varying vec4 lit_color;\n"
+  "void main() {\n"
+  "  mat4 model_view = gl_ModelViewMatrix*mat4(model_0, model_1, model_2, model_3);\n"
+  "  mat3 basis = mat3(model_view);\n"
+  "  vec3 scale_squared = vec3(dot(basis[0], basis[0]), dot(basis[1], basis[1]), dot(basis[2], basis[2]));\n"
+  "  vec3 eye_normal = normalize(basis*(normal/scale_squared));\n"
+  "  float diffuse = max(dot(eye_normal, normalize(gl_LightSource[0].position.xyz)), 0.0);\n"
+  "  vec4 result = gl_LightModel.ambient*color + gl_LightSource[0].ambient*color + gl_LightSource[0].diffuse*color*diffuse;\n"
+  "  if (diffuse > 0.0) {\n"
+  "    result += gl_LightSource[0].specular*reflectance*pow(max(dot(eye_normal, normalize(gl_LightSource[0].halfVector.xyz)), 0.0), shininess);\n"
+  "  }\n"
+  "  lit_color = vec4(clamp(result.rgb, 0.0, 1.0), color.a);\n"
+  "  gl_Position = gl_ProjectionMatrix*model_view*vec4(position, 1.0);\n"
+  "}\n";
+
+static const char* FRAGMENT_SHADER_SOURCE =
+  "#version 120\n"
+  "varying vec4 lit_color;\n"
+  "void main() {\n"
+  "  gl_FragColor = lit_color;\n"
+  "}\n";
+
+// compiles one stage, printing the log when it fails
+static GLuint shader_compile(const GLenum type, const char* source) {
+  GLint is_compiled = GL_FALSE;
+  char log[1024];
+
+  GLuint shader = glCreateShader(type);
+  glShaderSource(shader, 1, &source, nullptr);
+  glCompileShader(shader);
+
+  glGetShaderiv(shader, GL_COMPILE_STATUS, &is_compiled);
+  if (is_compiled != GL_TRUE) {
+    glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+    cerr << "Failed to compile the instancing shader: " << log << endl;
+
+    glDeleteShader(shader);
+    return 0;
+  }
+
+  return shader;
+}
+#endif
+
+// glutSolidCube(1.0) as positions followed by normals, with each face as two counterclockwise triangles
+static void cube_vertices_store(float vertices[CUBE_VERTEX_COUNT*6]) {
+  static const int TRIANGLE_CORNERS[6][2] = { { 0, 0 }, { 1, 0 }, { 1, 1 }, { 0, 0 }, { 1, 1 }, { 0, 1 } };
+  int v = 0;
+
+  for (int axis = 0; axis < 3; axis++) {
+    for (int side = -1; side <= 1; side += 2) {
+      const int axis_0 = (axis + (side > 0 ? 1 : 2)) % 3;
+      const int axis_1 = (axis + (side > 0 ? 2 : 1)) % 3;
+
+      for (int i = 0; i < 6; i++, v++) {
+        float* vertex = &vertices[v*6];
+
+        vertex[axis] = side*0.5f;
+        vertex[axis_0] = TRIANGLE_CORNERS[i][0] - 0.5f;
+        vertex[axis_1] = TRIANGLE_CORNERS[i][1] - 0.5f;
+
+        vertex[3] = 0.0f;
+        vertex[4] = 0.0f;
+        vertex[5] = 0.0f;
+        vertex[3 + axis] = (float)side;
+      }
+    }
+  }
+}
+
+RenderQueue::RenderQueue(const bool is_record_only) {
+  m_is_record_only = is_record_only;
+  m_is_instancing = false;
+
+  m_cube_buffer = 0;
+  m_instance_buffer = 0;
+  m_program = 0;
+
+  m_command_count = 0;
+  m_material_count = 0;
+  m_mesh_count = 0;
+
+  m_material_change_count = 0;
+  m_mesh_change_count = 0;
+}
+
+void RenderQueue::set_record_only(const bool is_record_only) {
+  m_is_record_only = is_record_only;
+}
+
+bool RenderQueue::instancing_init() {
+  if (m_is_record_only) {
+    m_is_instancing = true;
+    return true;
+  }
+
+#if RENDER_INSTANCING
+  float vertices[CUBE_VERTEX_COUNT*6];
+  GLint is_linked = GL_FALSE;
+
+  if (m_is_instancing) {
+    return true;
+  }
+
+  if (glewInit() != GLEW_OK || !GLEW_VERSION_3_3) {
+    return false;
+  }
+
+  GLuint vertex_shader = shader_compile(GL_VERTEX_SHADER, VERTEX_SHADER_SOURCE);
+  GLuint fragment_shader = shader_compile(GL_FRAGMENT_SHADER, FRAGMENT_SHADER_SOURCE);
+
+  if (vertex_shader == 0 || fragment_shader == 0) {
+    glDeleteShader(vertex_shader);
+    glDeleteShader(fragment_shader);
+    return false;
+  }
+
+  m_program = glCreateProgram();
+  glAttachShader(m_program, vertex_shader);
+  glAttachShader(m_program, fragment_shader);
+
+  glBindAttribLocation(m_program, ATTRIBUTE_POSITION, "position");
+  glBindAttribLocation(m_program, ATTRIBUTE_NORMAL, "normal");
+  glBindAttribLocation(m_program, ATTRIBUTE_MODEL, "model_0");
+  glBindAttribLocation(m_program, ATTRIBUTE_MODEL + 1, "model_1");
+  glBindAttribLocation(m_program, ATTRIBUTE_MODEL + 2, "model_2");
+  glBindAttribLocation(m_program, ATTRIBUTE_MODEL + 3, "model_3");
+  glBindAttribLocation(m_program, ATTRIBUTE_COLOR, "color");
+  glBindAttribLocation(m_program, ATTRIBUTE_REFLECTANCE, "reflectance");
+  glBindAttribLocation(m_program, ATTRIBUTE_SHININESS, "shininess");
+  glLinkProgram(m_program);
+
+  // the program keeps the stages alive
+  glDeleteShader(vertex_shader);
+  glDeleteShader(fragment_shader);
+
+  glGetProgramiv(m_program, GL_LINK_STATUS, &is_linked);
+  if (is_linked != GL_TRUE) {
+    glDeleteProgram(m_program);
+    m_program = 0;
+    return false;
+  }
+
+  // the cube never changes, so it is uploaded once
+  cube_vertices_store(vertices);
+
+  glGenBuffers(1, &m_cube_buffer);
+  glBindBuffer(GL_ARRAY_BUFFER, m_cube_buffer);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+
+  glGenBuffers(1, &m_instance_buffer);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+  m_is_instancing = true;
+  return true;
+#else
+  return false;
+#endif
+}
+
+void RenderQueue::clear() {
+  m_commands.clear();
+  m_materials.clear();
+  m_meshes.clear();
+
+  m_command_count = 0;
+  m_material_count = 0;
+  m_mesh_count = 0;
+}
+
+int RenderQueue::add(const Shape& shape) {
+  float model[16];
+
+  shape.model_matrix_store(model);
+  return add(shape, model, shape.c_color, shape.c_reflectance, shape.c_shininess);
+}
+int RenderQueue::add(const Shape& shape, const float model[16], const float color[4], const float reflectance[4], const float shininess) {
+  Command command;
+
+  command.material_key = material_key_find(color, reflectance, shininess);
+  command.mesh_key = mesh_key_find(shape);
+  command.shape = &shape;
+  copy(model, model + 16, command.model);
+
+  m_commands.push_back(command);
+  return m_command_count++;
+}
+
+int RenderQueue::material_key(const int index) const {
+  return m_commands[index].material_key;
+}
+int RenderQueue::mesh_key(const int index) const {
+  return m_commands[index].mesh_key;
+}
+
+void RenderQueue::submit(GLState& gl_state) {
+  float view[16];
+  float model_view[16];
+
+  int material_key = -1;
+  int mesh_key = -1;
+
+  m_material_change_count = 0;
+  m_mesh_change_count = 0;
+  m_records.clear();
+  m_instances.clear();
+
+  // a stable sort keeps shapes with the same keys in the order they were added
+  m_order.resize(m_commands.size());
+  for (size_t i = 0; i < m_commands.size(); i++) {
+    m_order[i].first = ((unsigned long long)m_commands[i].material_key << 32) | (unsigned int)m_commands[i].mesh_key;
+    m_order[i].second = (int)i;
+  }
+  stable_sort(m_order.begin(), m_order.end(), [](const pair<unsigned long long, int>& a, const pair<unsigned long long, int>& b) {
+    return a.first < b.first;
+  });
+
+  copy(gl_state.c_modelview, gl_state.c_modelview + 16, view);
+
+  for (size_t i = 0; i < m_order.size(); i++) {
+    const Command& command = m_commands[m_order[i].second];
+
+    // cuboids are gathered and drawn together at the end
+    if (m_is_instancing && command.shape->c_shape_type == SHAPE_TYPE_CUBOID) {
+      const Material& material = m_materials[command.material_key];
+
+      m_instances.insert(m_instances.end(), command.model, command.model + 16);
+      m_instances.insert(m_instances.end(), material.color, material.color + 4);
+      m_instances.insert(m_instances.end(), material.reflectance, material.reflectance + 4);
+      m_instances.push_back(material.shininess);
+      continue;
+    }
+
+    if (command.material_key != material_key) {
+      material_key = command.material_key;
+      m_material_change_count++;
+
+      if (m_is_record_only) {
+        m_records.push_back({ RENDER_RECORD_MATERIAL, material_key });
+      }
+      else {
+        const Material& material = m_materials[material_key];
+
+        gl_state.set_material(material.color, material.reflectance, material.shininess);
+      }
+    }
+
+    // immediate mode geometry has nothing to bind, but the changes are counted all the same
+    if (command.mesh_key != mesh_key) {
+      mesh_key = command.mesh_key;
+      m_mesh_change_count++;
+
+      if (m_is_record_only) {
+        m_records.push_back({ RENDER_RECORD_MESH, mesh_key });
+      }
+    }
+
+    if (m_is_record_only) {
+      m_records.push_back({ RENDER_RECORD_DRAW, m_order[i].second });
+    }
+    else {
+      // load the whole transform rather than pushing and popping the matrix around each shape
+      multiplyM4(view, command.model, model_view);
+      gl_state.set_modelview(model_view);
+      command.shape->draw_model_GLUT();
+    }
+  }
+
+  if (!m_is_record_only) {
+    gl_state.set_modelview(view);
+  }
+
+  if (!m_instances.empty()) {
+    instances_draw();
+  }
+}
+
+int RenderQueue::instancing_difference(GLState& gl_state, const int width, const int height) {
+#if RENDER_INSTANCING
+  vector<unsigned char> pixels[2];
+  GLuint framebuffer;
+  GLuint renderbuffers[2];
+  int difference = 0;
+
+  if (!m_is_instancing) {
+    return -1;
+  }
+
+  // OpenGL 3.3 has framebuffer objects, so the drawings need no window
+  glGenFramebuffers(1, &framebuffer);
+  glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+  glGenRenderbuffers(2, renderbuffers);
+  glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[0]);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderbuffers[0]);
+  glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[1]);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, renderbuffers[1]);
+  glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+  gl_state.set_viewport(0, 0, width, height);
+
+  for (int pass = 0; pass < 2; pass++) {
+    m_is_instancing = pass == 0;
+
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    submit(gl_state);
+
+    pixels[pass].resize(width*height*4);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels[pass].data());
+  }
+  m_is_instancing = true;
+
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  glDeleteRenderbuffers(2, renderbuffers);
+  glDeleteFramebuffers(1, &framebuffer);
+
+  for (int i = 0; i < width*height; i++) {
+    for (int channel = 0; channel < 3; channel++) {
+      if (abs(pixels[0][i*4 + channel] - pixels[1][i*4 + channel]) > RENDER_CHECK_TOLERANCE) {
+        difference++;
+        break;
+      }
+    }
+  }
+
+  return difference;
+#else
+  return -1;
+#endif
+}
+
+void RenderQueue::instances_draw() {
+  const int instance_count = (int)m_instances.size() / RENDER_INSTANCE_FLOATS;
+
+  if (m_is_record_only) {
+    m_records.push_back({ RENDER_RECORD_INSTANCES, instance_count });
+    return;
+  }
+
+#if RENDER_INSTANCING
+  const GLsizei stride = RENDER_INSTANCE_FLOATS*sizeof(float);
+
+  glUseProgram(m_program);
+
+  glBindBuffer(GL_ARRAY_BUFFER, m_cube_buffer);
+  glEnableVertexAttribArray(ATTRIBUTE_POSITION);
+  glVertexAttribPointer(ATTRIBUTE_POSITION, 3, GL_FLOAT, GL_FALSE, 6*sizeof(float), (const void*)0);
+  glEnableVertexAttribArray(ATTRIBUTE_NORMAL);
+  glVertexAttribPointer(ATTRIBUTE_NORMAL, 3, GL_FLOAT, GL_FALSE, 6*sizeof(float), (const void*)(3*sizeof(float)));
+
+  // the instances change every frame, so the buffer is refilled
+  glBindBuffer(GL_ARRAY_BUFFER, m_instance_buffer);
+  glBufferData(GL_ARRAY_BUFFER, m_instances.size()*sizeof(float), m_instances.data(), GL_STREAM_DRAW);
+
+  for (int i = 0; i < 4; i++) {
+    glEnableVertexAttribArray(ATTRIBUTE_MODEL + i);
+    glVertexAttribPointer(ATTRIBUTE_MODEL + i, 4, GL_FLOAT, GL_FALSE, stride, (const void*)(i*4*sizeof(float)));
+    glVertexAttribDivisor(ATTRIBUTE_MODEL + i, 1);
+  }
+  glEnableVertexAttribArray(ATTRIBUTE_COLOR);
+  glVertexAttribPointer(ATTRIBUTE_COLOR, 4, GL_FLOAT, GL_FALSE, stride, (const void*)(16*sizeof(float)));
+  glVertexAttribDivisor(ATTRIBUTE_COLOR, 1);
+  glEnableVertexAttribArray(ATTRIBUTE_REFLECTANCE);
+  glVertexAttribPointer(ATTRIBUTE_REFLECTANCE, 4, GL_FLOAT, GL_FALSE, stride, (const void*)(20*sizeof(float)));
+  glVertexAttribDivisor(ATTRIBUTE_REFLECTANCE, 1);
+  glEnableVertexAttribArray(ATTRIBUTE_SHININESS);
+  glVertexAttribPointer(ATTRIBUTE_SHININESS, 1, GL_FLOAT, GL_FALSE, stride, (const void*)(24*sizeof(float)));
+  glVertexAttribDivisor(ATTRIBUTE_SHININESS, 1);
+
+  glDrawArraysInstanced(GL_TRIANGLES, 0, CUBE_VERTEX_COUNT, instance_count);
+
+  // leave the state as the immediate mode drawing expects it
+  for (int i = ATTRIBUTE_POSITION; i <= ATTRIBUTE_SHININESS; i++) {
+    glVertexAttribDivisor(i, 0);
+    glDisableVertexAttribArray(i);
+  }
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  glUseProgram(0);
+#endif
+}
+
+int RenderQueue::material_key_find(const float color[4], const float reflectance[4], const float shininess) {
+  // few materials are in use, and shapes added together often share one, so search from the last
+  for (int i = m_material_count - 1; i >= 0; i--) {
+    const Material& material = m_materials[i];
+
+    if (equal(material.color, material.color + 4, color)
+      && equal(material.reflectance, material.reflectance + 4, reflectance)
+      && material.shininess == shininess
+      )
+    {
+      return i;
+    }
+  }
+
+  Material material;
+
+  copy(color, color + 4, material.color);
+  copy(reflectance, reflectance + 4, material.reflectance);
+  material.shininess = shininess;
+
+  m_materials.push_back(material);
+  return m_material_count++;
+}
+
+int RenderQueue::mesh_key_find(const Shape& shape) {
+  Mesh mesh;
+
+  // unit cubes and spheres are shared, as are meshes, but capsules and cylinders are built from the scale of each shape
+  switch (shape.c_shape_type) {
+  case SHAPE_TYPE_MESH:
+  case SHAPE_TYPE_CONVEX_HULL:
+    mesh.shape_type = SHAPE_TYPE_MESH;
+    mesh.source = shape.c_mesh;
+    break;
+  case SHAPE_TYPE_CAPSULE:
+  case SHAPE_TYPE_CYLINDER:
+    mesh.shape_type = shape.c_shape_type;
+    mesh.source = &shape;
+    break;
+  default:
+    mesh.shape_type = shape.c_shape_type;
+    mesh.source = nullptr;
+    break;
+  }
+
+  for (int i = m_mesh_count - 1; i >= 0; i--) {
+    if (m_meshes[i].shape_type == mesh.shape_type && m_meshes[i].source == mesh.source) {
+      return i;
+    }
+  }
+
+  m_meshes.push_back(mesh);
+  return m_mesh_count++;
+}
\ No newline at end of file
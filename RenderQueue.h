@@ -0,0 +1,127 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include <vector>
+
+#include "Shape.h"
+#include "GLState.h"
+
+#define RENDER_RECORD_MATERIAL 0
+#define RENDER_RECORD_MESH 1
+#define RENDER_RECORD_DRAW 2
+#define RENDER_RECORD_INSTANCES 3
+
+// floats per instance: the model matrix, color, reflectance and shininess
+#define RENDER_INSTANCE_FLOATS 25
+
+// channels of the instanced and immediate drawings that differ by at most this many levels are taken to match
+#define RENDER_CHECK_TOLERANCE 2
+
+// a state change or draw made by submit, kept instead of calling OpenGL in record-only mode
+struct RenderRecord {
+  int type;
+
+  // the material or mesh key, the index of the command drawn, or the number of instances drawn
+  int key;
+};
+
+// collects the shapes to draw in a frame and draws them sorted by material and then mesh, so that the material is only
+// set when it changes
+class RenderQueue {
+public:
+  RenderQueue(const bool is_record_only = false);
+
+  const bool& c_is_record_only = m_is_record_only;
+  const bool& c_is_instancing = m_is_instancing;
+
+  const int& c_command_count = m_command_count;
+  const int& c_material_count = m_material_count;
+  const int& c_mesh_count = m_mesh_count;
+
+  // state changes made by the last submit
+  const int& c_material_change_count = m_material_change_count;
+  const int& c_mesh_change_count = m_mesh_change_count;
+
+  const std::vector<RenderRecord>& c_records = m_records;
+
+  void set_record_only(const bool is_record_only);
+
+  // sets up drawing every cuboid with one instanced call once the context is current, returning false when it lacks
+  // OpenGL 3.3 so that cuboids keep being drawn one at a time; in record-only mode this only turns on the grouping
+  bool instancing_init();
+
+  // forgets the commands, materials and meshes of the last frame
+  void clear();
+
+  // returns the index of the command
+  int add(const Shape& shape);
+
+  // adds shape with the model matrix and material given instead of its own, so that a shape can be drawn as it was
+  // copied while another thread moves it; only its type, scale and mesh are read
+  int add(const Shape& shape, const float model[16], const float color[4], const float reflectance[4], const float shininess);
+
+  // keys of the command at index, which are numbered from 0 in the order they were first added since the last clear
+  int material_key(const int index) const;
+  int mesh_key(const int index) const;
+
+  // draws with the modelview of gl_state as the view matrix, which is current again afterwards
+  void submit(GLState& gl_state);
+
+  // submits the commands offscreen at width by height pixels once instanced and once one shape at a time, returning the
+  // number of pixels that differ, or -1 when instancing is off; the viewport is left at the offscreen size
+  int instancing_difference(GLState& gl_state, const int width, const int height);
+
+private:
+  struct Material {
+    float color[4];
+    float reflectance[4];
+    float shininess;
+  };
+
+  // geometry drawn the same for every shape with the same type and source
+  struct Mesh {
+    int shape_type;
+    const void* source;
+  };
+
+  struct Command {
+    int material_key;
+    int mesh_key;
+    const Shape* shape;
+    float model[16];
+  };
+
+  bool m_is_record_only;
+  bool m_is_instancing;
+
+  // the unit cube as positions and normals, the per-instance attributes, and the program that lights them like the
+  // fixed-function pipeline does
+  unsigned int m_cube_buffer;
+  unsigned int m_instance_buffer;
+  unsigned int m_program;
+
+  std::vector<float> m_instances;
+
+  int m_command_count;
+  int m_material_count;
+  int m_mesh_count;
+
+  int m_material_change_count;
+  int m_mesh_change_count;
+
+  std::vector<Command> m_commands;
+  std::vector<Material> m_materials;
+  std::vector<Mesh> m_meshes;
+
+  // material key in the high bits and mesh key in the low bits, paired with the command index
+  std::vector<std::pair<unsigned long long, int>> m_order;
+
+  std::vector<RenderRecord> m_records;
+
+  int material_key_find(const float color[4], const float reflectance[4], const float shininess);
+  int mesh_key_find(const Shape& shape);
+
+  void instances_draw();
+};
+
+#endif
\ No newline at end of file
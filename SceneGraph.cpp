@@ -0,0 +1,212 @@
+#include "SceneGraph.h"
+
+#include <algorithm>
+using namespace std;
+
+#include "matrix4.h"
+#include "vector3.h"
+
+// stores the rigid matrix with the basis vectors as its columns and position as its translation
+static void pose_matrix_store(const float position[3], const float vector_right[3], const float vector_up[3], const float vector_forward[3], float matrix[16]) {
+  __vector_element_assign_opV3(matrix, =, vector_right);
+  __vector_element_assign_opV3((matrix + 4), =, vector_up);
+  __vector_element_assign_opV3((matrix + 8), =, vector_forward);
+  __vector_element_assign_opV3((matrix + 12), =, position);
+
+  matrix[3] = 0.0f;
+  matrix[7] = 0.0f;
+  matrix[11] = 0.0f;
+  matrix[15] = 1.0f;
+}
+
+SceneGraph::SceneGraph() {
+  m_node_count = 0;
+  m_is_order_dirty = false;
+  m_update_count = 0;
+}
+
+int SceneGraph::add_node(const int parent) {
+  Node node;
+  const int handle = m_node_count++;
+
+  node.parent_index = SCENE_NODE_NONE;
+  node.subtree_size = 1;
+  identityM4(node.local);
+  identityM4(node.world);
+  node.source = nullptr;
+  node.source_version = 0;
+  node.target = nullptr;
+  node.is_dirty = true;
+  node.is_subtree_dirty = true;
+  node.changed_update = 0;
+
+  m_indices.push_back((int)m_nodes.size());
+  m_nodes.push_back(node);
+
+  m_parents.push_back(parent);
+  m_first_children.push_back(SCENE_NODE_NONE);
+  m_last_children.push_back(SCENE_NODE_NONE);
+  m_next_siblings.push_back(SCENE_NODE_NONE);
+
+  // append to the children of parent so that siblings keep the order they were added in
+  if (parent == SCENE_NODE_NONE) {
+    m_roots.push_back(handle);
+  }
+  else if (m_last_children[parent] == SCENE_NODE_NONE) {
+    m_first_children[parent] = handle;
+    m_last_children[parent] = handle;
+  }
+  else {
+    m_next_siblings[m_last_children[parent]] = handle;
+    m_last_children[parent] = handle;
+  }
+
+  m_is_order_dirty = true;
+  return handle;
+}
+
+void SceneGraph::set_local_pose(const int node, const float offset[3], const float vector_right[3], const float vector_up[3], const float vector_forward[3]) {
+  pose_matrix_store(offset, vector_right, vector_up, vector_forward, m_nodes[m_indices[node]].local);
+  dirty_mark(node);
+}
+void SceneGraph::set_local_offset(const int node, const float offset[3]) {
+  __vector_element_assign_opV3((m_nodes[m_indices[node]].local + 12), =, offset);
+  dirty_mark(node);
+}
+
+void SceneGraph::set_source(const int node, const Object* object) {
+  Node& scene_node = m_nodes[m_indices[node]];
+
+  if (scene_node.source == nullptr) {
+    m_sourced_nodes.push_back(node);
+  }
+
+  scene_node.source = object;
+  scene_node.source_version = object->c_pose_version - 1;
+}
+
+void SceneGraph::set_target(const int node, Object* object) {
+  m_nodes[m_indices[node]].target = object;
+  dirty_mark(node);
+}
+
+void SceneGraph::update() {
+  float source_matrix[16];
+
+  if (m_is_order_dirty) {
+    order_rebuild();
+  }
+
+  m_update_count++;
+
+  // roots follow their objects whenever those move
+  for (size_t i = 0; i < m_sourced_nodes.size(); i++) {
+    const Node& node = m_nodes[m_indices[m_sourced_nodes[i]]];
+
+    if (node.source != nullptr && node.source->c_pose_version != node.source_version) {
+      dirty_mark(m_sourced_nodes[i]);
+    }
+  }
+
+  int i = 0;
+  while (i < (int)m_nodes.size()) {
+    Node& node = m_nodes[i];
+    const bool is_parent_changed = node.parent_index != SCENE_NODE_NONE && m_nodes[node.parent_index].changed_update == m_update_count;
+
+    // nothing in a clean subtree under an unchanged parent moves
+    if (!node.is_subtree_dirty && !is_parent_changed) {
+      i += node.subtree_size;
+      continue;
+    }
+
+    if (node.is_dirty || is_parent_changed) {
+      if (node.parent_index != SCENE_NODE_NONE) {
+        multiplyM4(m_nodes[node.parent_index].world, node.local, node.world);
+      }
+      else if (node.source != nullptr) {
+        pose_matrix_store(node.source->c_position, node.source->c_vector_right, node.source->c_vector_up, node.source->c_vector_forward, source_matrix);
+        multiplyM4(source_matrix, node.local, node.world);
+        node.source_version = node.source->c_pose_version;
+      }
+      else {
+        for (int j = 0; j < 16; j++) {
+          node.world[j] = node.local[j];
+        }
+      }
+
+      if (node.target != nullptr) {
+        node.target->set_basis(node.world, node.world + 4, node.world + 8);
+        node.target->translate_to(node.world + 12);
+      }
+
+      node.changed_update = m_update_count;
+    }
+
+    node.is_dirty = false;
+    node.is_subtree_dirty = false;
+    i++;
+  }
+}
+
+const float* SceneGraph::world_matrix(const int node) const {
+  return m_nodes[m_indices[node]].world;
+}
+
+void SceneGraph::dirty_mark(const int node) {
+  int index = m_indices[node];
+
+  m_nodes[index].is_dirty = true;
+
+  // the parent indices are only valid once the order is rebuilt, which marks every node anyway
+  if (m_is_order_dirty) {
+    return;
+  }
+
+  while (index != SCENE_NODE_NONE && !m_nodes[index].is_subtree_dirty) {
+    m_nodes[index].is_subtree_dirty = true;
+    index = m_nodes[index].parent_index;
+  }
+}
+
+void SceneGraph::order_rebuild() {
+  vector<Node> nodes;
+  vector<int> stack;
+
+  nodes.reserve(m_nodes.size());
+
+  // visit roots and children in the order they were added
+  for (int r = (int)m_roots.size() - 1; r >= 0; r--) {
+    stack.push_back(m_roots[r]);
+  }
+
+  while (!stack.empty()) {
+    const int handle = stack.back();
+    stack.pop_back();
+
+    Node node = m_nodes[m_indices[handle]];
+    node.parent_index = m_parents[handle] == SCENE_NODE_NONE ? SCENE_NODE_NONE : m_indices[m_parents[handle]];
+    node.subtree_size = 1;
+    node.is_dirty = true;
+    node.is_subtree_dirty = true;
+
+    // parents come first, so the index of the parent is already the new one
+    m_indices[handle] = (int)nodes.size();
+    nodes.push_back(node);
+
+    const size_t first = stack.size();
+    for (int child = m_first_children[handle]; child != SCENE_NODE_NONE; child = m_next_siblings[child]) {
+      stack.push_back(child);
+    }
+    reverse(stack.begin() + first, stack.end());
+  }
+
+  // each subtree follows its root, so sizes sum from the back
+  for (int i = (int)nodes.size() - 1; i >= 0; i--) {
+    if (nodes[i].parent_index != SCENE_NODE_NONE) {
+      nodes[nodes[i].parent_index].subtree_size += nodes[i].subtree_size;
+    }
+  }
+
+  m_nodes.swap(nodes);
+  m_is_order_dirty = false;
+}
\ No newline at end of file
@@ -0,0 +1,80 @@
+#ifndef SCENE_GRAPH_H
+#define SCENE_GRAPH_H
+
+#include <vector>
+
+#include "Object.h"
+
+#define SCENE_NODE_NONE (-1)
+
+// a hierarchy of rigid transforms whose world matrices are cached and only recomputed below nodes that changed; the
+// nodes are kept in depth-first order so that an update is one sweep that skips clean subtrees whole
+class SceneGraph {
+public:
+  SceneGraph();
+
+  const int& c_node_count = m_node_count;
+
+  // adds a node with an identity local pose under parent, or as a root, returning its handle
+  int add_node(const int parent = SCENE_NODE_NONE);
+
+  // sets the pose of node in the frame of its parent, with offset and the basis given along the parent's right, up and
+  // forward vectors
+  void set_local_pose(const int node, const float offset[3], const float vector_right[3], const float vector_up[3], const float vector_forward[3]);
+  void set_local_offset(const int node, const float offset[3]);
+
+  // makes object the frame of the root node, so that the node follows it
+  void set_source(const int node, const Object* object);
+
+  // poses object at the world transform of node after every update that moves the node
+  void set_target(const int node, Object* object);
+
+  void update();
+
+  // column-major world matrix of node as of the last update
+  const float* world_matrix(const int node) const;
+
+private:
+  struct Node {
+    // index of the parent in m_nodes, and the number of nodes in the subtree of this node including itself
+    int parent_index;
+    int subtree_size;
+
+    float local[16];
+    float world[16];
+
+    const Object* source;
+    unsigned int source_version;
+    Object* target;
+
+    // the local pose changed, or some node in the subtree did
+    bool is_dirty;
+    bool is_subtree_dirty;
+
+    // the update in which world last changed
+    unsigned int changed_update;
+  };
+
+  int m_node_count;
+
+  // depth-first order, except for nodes added since the last update, which are appended until the order is rebuilt
+  std::vector<Node> m_nodes;
+  bool m_is_order_dirty;
+
+  // by handle
+  std::vector<int> m_indices;
+  std::vector<int> m_parents;
+  std::vector<int> m_first_children;
+  std::vector<int> m_last_children;
+  std::vector<int> m_next_siblings;
+
+  std::vector<int> m_roots;
+  std::vector<int> m_sourced_nodes;
+
+  unsigned int m_update_count;
+
+  void dirty_mark(const int node);
+  void order_rebuild();
+};
+
+#endif
\ No newline at end of file
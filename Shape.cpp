@@ -3,12 +3,76 @@
 #include <gl/glut.h>
 #include <gl/gl.h>
 
+#include <cmath>
+#include <cfloat>
+using namespace std;
+
 #include "macro_constants.h"
 #include "vector3.h"
 #include "colors.h"
+#include "CollisionKernel.h"
 
 #define DRAW_AXES 0
 
+// lists the kernels for TYPE_A against every shape type, in the order of the type codes
+#define __collision_function_row(TYPE_A) \
+  { \
+    CollisionKernel<TYPE_A, SHAPE_TYPE_CUBOID>::is_overlapping, \
+    CollisionKernel<TYPE_A, SHAPE_TYPE_MESH>::is_overlapping, \
+    CollisionKernel<TYPE_A, SHAPE_TYPE_SPHERE>::is_overlapping, \
+    CollisionKernel<TYPE_A, SHAPE_TYPE_CAPSULE>::is_overlapping, \
+    CollisionKernel<TYPE_A, SHAPE_TYPE_CYLINDER>::is_overlapping, \
+    CollisionKernel<TYPE_A, SHAPE_TYPE_CONVEX_HULL>::is_overlapping \
+  }
+
+static const CollisionFunction COLLISION_FUNCTIONS[SHAPE_TYPE_COUNT][SHAPE_TYPE_COUNT] = {
+  __collision_function_row(SHAPE_TYPE_CUBOID),
+  __collision_function_row(SHAPE_TYPE_MESH),
+  __collision_function_row(SHAPE_TYPE_SPHERE),
+  __collision_function_row(SHAPE_TYPE_CAPSULE),
+  __collision_function_row(SHAPE_TYPE_CYLINDER),
+  __collision_function_row(SHAPE_TYPE_CONVEX_HULL)
+};
+
+// used for shape types without a kernel
+static bool is_never_overlapping(const Shape&, const Shape&, GjkCache*) {
+  return false;
+}
+
+// yields the distance along direction at which the ray from origin enters the infinite cylinder of radius around the
+// local y axis, or a negative value when it misses or starts inside
+static float ray_cylinder_side_distance(const float origin[3], const float direction[3], const float radius) {
+  const float a = direction[DIM_X]*direction[DIM_X] + direction[DIM_Z]*direction[DIM_Z];
+  const float b = origin[DIM_X]*direction[DIM_X] + origin[DIM_Z]*direction[DIM_Z];
+  const float c = origin[DIM_X]*origin[DIM_X] + origin[DIM_Z]*origin[DIM_Z] - radius*radius;
+  const float discriminant = b*b - a*c;
+
+  if (a == 0.0f || c <= 0.0f || b > 0.0f || discriminant < 0.0f) {
+    return -1.0f;
+  }
+
+  return (-b - sqrtf(discriminant)) / a;
+}
+
+// yields the smallest non-negative distance along direction at which the ray from origin meets the sphere, or a
+// negative value when it misses
+static float ray_sphere_distance(const float origin[3], const float direction[3], const float center[3], const float radius) {
+  float offset[3];
+
+  __vector_element_opV3(origin, -, center, offset);
+
+  const float a = __dot_productV3(direction, direction);
+  const float b = __dot_productV3(offset, direction);
+  const float c = __dot_productV3(offset, offset) - radius*radius;
+  const float discriminant = b*b - a*c;
+
+  if (a == 0.0f || discriminant < 0.0f || (c > 0.0f && b > 0.0f)) {
+    return -1.0f;
+  }
+
+  return fmaxf((-b - sqrtf(discriminant)) / a, 0.0f);
+}
+
 Shape::Shape(const int shape_type) {
   m_shape_type = shape_type;
 
@@ -27,27 +91,36 @@ Shape::Shape(const int shape_type) {
   m_reflectance[3] = 1.0f;
 
   m_shininess = 0.0f;
+
+  m_mesh = nullptr;
+
+  m_bounds_version = m_pose_version - 1;
 }
 
 void Shape::set_scale(const float scale_x, const float scale_y, const float scale_z) {
   m_scale_x = scale_x;
   m_scale_y = scale_y;
   m_scale_z = scale_z;
+  m_pose_version++;
 }
 void Shape::set_scale(const float dimensions[3]) {
   m_scale_x = dimensions[0];
   m_scale_y = dimensions[1];
   m_scale_z = dimensions[2];
+  m_pose_version++;
 }
 
 void Shape::set_scale_x(const float scale_x) {
   m_scale_x = scale_x;
+  m_pose_version++;
 }
 void Shape::set_scale_y(const float scale_y) {
   m_scale_y = scale_y;
+  m_pose_version++;
 }
 void Shape::set_scale_z(const float scale_z) {
   m_scale_z = scale_z;
+  m_pose_version++;
 }
 
 void Shape::set_color(const float red, const float green, const float blue, const float alpha) {
@@ -80,10 +153,26 @@ void Shape::set_shininess(const float shininess) {
   m_shininess = shininess;
 }
 
+void Shape::set_mesh(const TriangleMesh* mesh) {
+  m_mesh = mesh;
+  m_pose_version++;
+}
+
 bool Shape::is_point_inside(const float point[3]) const {
   float temp_vector[3];
   float plane_distance;
 
+  float local[3];
+  float radius = m_scale_x*0.5f;
+  float half_length;
+
+  float bounds_min[3];
+  float bounds_max[3];
+  float center[3];
+  float edge_0[3];
+  float edge_1[3];
+  float normal[3];
+
   bool is_inside = true;
   bool is_on_positive_normal_side;
   bool is_on_negative_normal_side;
@@ -91,11 +180,11 @@ bool Shape::is_point_inside(const float point[3]) const {
   switch (m_shape_type) {
     case SHAPE_TYPE_CUBOID:
       // find if point is on the far side of the right cuboid plane
-      plane_distance = m_scale_x;
+      plane_distance = m_scale_x*0.5f;
       __test_cuboid_plane_outside(point, m_vector_right, m_position, plane_distance, temp_vector, is_on_positive_normal_side);
 
       // find if point is on the far side of the left cuboid plane
-      plane_distance = -m_scale_x;
+      plane_distance = -m_scale_x*0.5f;
       __test_cuboid_plane_outside(point, m_vector_right, m_position, plane_distance, temp_vector, is_on_negative_normal_side);
 
       // find if the point is between these two planes
@@ -104,11 +193,11 @@ bool Shape::is_point_inside(const float point[3]) const {
       // -------------------------------------------------------
 
       // find if point is on the far side of the up cuboid plane
-      plane_distance = m_scale_y;
+      plane_distance = m_scale_y*0.5f;
       __test_cuboid_plane_outside(point, m_vector_up, m_position, plane_distance, temp_vector, is_on_positive_normal_side);
 
       // find if point is on the far side of the down cuboid plane
-      plane_distance = -m_scale_y;
+      plane_distance = -m_scale_y*0.5f;
       __test_cuboid_plane_outside(point, m_vector_up, m_position, plane_distance, temp_vector, is_on_negative_normal_side);
 
       // find if the point is between these two planes
@@ -117,11 +206,11 @@ bool Shape::is_point_inside(const float point[3]) const {
       // -------------------------------------------------------
 
       // find if point is on the far side of the forward cuboid plane
-      plane_distance = m_scale_z;
+      plane_distance = m_scale_z*0.5f;
       __test_cuboid_plane_outside(point, m_vector_forward, m_position, plane_distance, temp_vector, is_on_positive_normal_side);
 
       // find if point is on the far side of the backward cuboid plane
-      plane_distance = -m_scale_z;
+      plane_distance = -m_scale_z*0.5f;
       __test_cuboid_plane_outside(point, m_vector_forward, m_position, plane_distance, temp_vector, is_on_negative_normal_side);
 
       // find if the point is between these two planes
@@ -129,12 +218,115 @@ bool Shape::is_point_inside(const float point[3]) const {
 
       return is_inside;
 
+  case SHAPE_TYPE_SPHERE:
+    local_point_store(point, local);
+    return __dot_productV3(local, local) <= radius*radius;
+
+  case SHAPE_TYPE_CAPSULE:
+    // measure from the closest point of the core segment
+    local_point_store(point, local);
+    half_length = fmaxf(m_scale_y*0.5f - radius, 0.0f);
+    local[DIM_Y] -= fminf(fmaxf(local[DIM_Y], -half_length), half_length);
+    return __dot_productV3(local, local) <= radius*radius;
+
+  case SHAPE_TYPE_CYLINDER:
+    local_point_store(point, local);
+    return fabsf(local[DIM_Y]) <= m_scale_y*0.5f && local[DIM_X]*local[DIM_X] + local[DIM_Z]*local[DIM_Z] <= radius*radius;
+
+  case SHAPE_TYPE_CONVEX_HULL:
+    if (m_mesh == nullptr || m_mesh->c_triangle_count == 0) {
+      return false;
+    }
+
+    // the point is inside when it is on the same side of every face plane as the center of the bounds
+    local_point_store(point, local);
+
+    m_mesh->aabb_store(bounds_min, bounds_max);
+    __vector_element_opV3(bounds_min, +, bounds_max, center);
+    __vector_scalar_assign_opV3(center, *=, 0.5f);
+
+    for (int i = 0; i < m_mesh->c_triangle_count; i++) {
+      const float* corners = &m_mesh->c_triangle_vertices[i*9];
+
+      __vector_element_opV3((corners + 3), -, corners, edge_0);
+      __vector_element_opV3((corners + 6), -, corners, edge_1);
+      __cross_productV3(edge_0, edge_1, normal);
+
+      // orient the face normal away from the center
+      __vector_element_opV3(center, -, corners, temp_vector);
+      if (__dot_productV3(normal, temp_vector) > 0.0f) {
+        __negativeV3(normal, normal);
+      }
+
+      __vector_element_opV3(local, -, corners, temp_vector);
+      if (__dot_productV3(normal, temp_vector) > 0.0f) {
+        return false;
+      }
+    }
+    return true;
+
   default:
     return false;
   }
 }
 
+void Shape::classify_points(const float* points, const int point_count, unsigned char* inside_store) const {
+  float half_extent_x = m_scale_x*0.5f;
+  float half_extent_y = m_scale_y*0.5f;
+  float half_extent_z = m_scale_z*0.5f;
+
+  // offsets that move world coordinates into the local frame once the basis is applied
+  float offset_x = -__dot_productV3(m_vector_right, m_position);
+  float offset_y = -__dot_productV3(m_vector_up, m_position);
+  float offset_z = -__dot_productV3(m_vector_forward, m_position);
+
+  float local_x;
+  float local_y;
+  float local_z;
+
+  switch (m_shape_type) {
+  case SHAPE_TYPE_CUBOID:
+    // transform each point into the local frame and compare against the half dimensions without branching
+    for (int i = 0; i < point_count; i++) {
+      const float* point = points + i*3;
+
+      local_x = m_vector_right_x*point[0] + m_vector_right_y*point[1] + m_vector_right_z*point[2] + offset_x;
+      local_y = m_vector_up_x*point[0] + m_vector_up_y*point[1] + m_vector_up_z*point[2] + offset_y;
+      local_z = m_vector_forward_x*point[0] + m_vector_forward_y*point[1] + m_vector_forward_z*point[2] + offset_z;
+
+      inside_store[i] = (unsigned char)(
+        (fabsf(local_x) <= half_extent_x)
+        & (fabsf(local_y) <= half_extent_y)
+        & (fabsf(local_z) <= half_extent_z)
+        );
+    }
+    break;
+
+  default:
+    for (int i = 0; i < point_count; i++) {
+      inside_store[i] = (unsigned char)is_point_inside(points + i*3);
+    }
+    break;
+  }
+}
+
 bool Shape::is_shape_inside(const Shape& shape) const {
+  return collision_function(m_shape_type, shape.m_shape_type)(*this, shape, nullptr);
+}
+
+CollisionFunction Shape::collision_function(const int shape_type_a, const int shape_type_b) {
+  if (shape_type_a < 0 || shape_type_a >= SHAPE_TYPE_COUNT || shape_type_b < 0 || shape_type_b >= SHAPE_TYPE_COUNT) {
+    return is_never_overlapping;
+  }
+
+  return COLLISION_FUNCTIONS[shape_type_a][shape_type_b];
+}
+
+bool Shape::is_collision_cached(const int shape_type_a, const int shape_type_b) {
+  return collision_function(shape_type_a, shape_type_b) == gjk_is_overlapping;
+}
+
+bool Shape::is_cuboid_overlapping_cuboid(const Shape& shape) const {
   bool is_inside;
 
   float this_axis_min;
@@ -143,79 +335,447 @@ bool Shape::is_shape_inside(const Shape& shape) const {
   float shape_axis_min;
   float shape_axis_max;
 
+  is_inside = true;
+
+  // get min and max point values along the right vector of this
+  axis_min_max_store(m_vector_right, this_axis_min, this_axis_max);
+  shape.axis_min_max_store(m_vector_right, shape_axis_min, shape_axis_max);
+
+  // check whether they intersect
+  is_inside &= (this_axis_min < shape_axis_max && shape_axis_min < this_axis_max);
+
+  // get min and max point values along the up vector of this
+  axis_min_max_store(m_vector_up, this_axis_min, this_axis_max);
+  shape.axis_min_max_store(m_vector_up, shape_axis_min, shape_axis_max);
+
+  // check whether they intersect
+  is_inside &= (this_axis_min < shape_axis_max && shape_axis_min < this_axis_max);
+
+  // get min and max point values along the forward vector of this
+  axis_min_max_store(m_vector_forward, this_axis_min, this_axis_max);
+  shape.axis_min_max_store(m_vector_forward, shape_axis_min, shape_axis_max);
+
+  // check whether they intersect
+  is_inside &= (this_axis_min < shape_axis_max && shape_axis_min < this_axis_max);
+
+  // get min and max point values along the right vector of shape
+  axis_min_max_store(shape.m_vector_right, this_axis_min, this_axis_max);
+  shape.axis_min_max_store(shape.m_vector_right, shape_axis_min, shape_axis_max);
+
+  // check whether they intersect
+  is_inside &= (this_axis_min < shape_axis_max && shape_axis_min < this_axis_max);
+
+  // get min and max point values along the up vector of shape
+  axis_min_max_store(shape.m_vector_up, this_axis_min, this_axis_max);
+  shape.axis_min_max_store(shape.m_vector_up, shape_axis_min, shape_axis_max);
+
+  // check whether they intersect
+  is_inside &= (this_axis_min < shape_axis_max && shape_axis_min < this_axis_max);
+
+  // get min and max point values along the forward vector of shape
+  axis_min_max_store(shape.m_vector_forward, this_axis_min, this_axis_max);
+  shape.axis_min_max_store(shape.m_vector_forward, shape_axis_min, shape_axis_max);
+
+  // check whether they intersect
+  is_inside &= (this_axis_min < shape_axis_max && shape_axis_min < this_axis_max);
+
+  return is_inside;
+}
+
+void Shape::aabb_store(float min[3], float max[3]) const {
+  bounds_update();
+
+  __vector_element_assign_opV3(min, =, m_bounds_min);
+  __vector_element_assign_opV3(max, =, m_bounds_max);
+}
+
+void Shape::bounding_sphere_store(float center[3], float& radius) const {
+  bounds_update();
+
+  __vector_element_assign_opV3(center, =, m_bounds_center);
+  radius = m_bounds_radius;
+}
+
+void Shape::bounds_update() const {
+  if (m_bounds_version == m_pose_version) {
+    return;
+  }
+
+  float half_extent[3];
+  float center[3];
+  float local_min[3];
+  float local_max[3];
+  float local_center[3];
+  float local_half_extent[3];
+
+  __vector_element_assign_opV3(center, =, m_position);
+  m_bounds_radius = 0.0f;
+
   switch (m_shape_type) {
   case SHAPE_TYPE_CUBOID:
-    is_inside = true;
+    // project the half dimensions of the cuboid onto each world axis
+    for (int i = 0; i < 3; i++) {
+      half_extent[i] =
+        fabsf(m_vector_right[i])*m_scale_x*0.5f
+        + fabsf(m_vector_up[i])*m_scale_y*0.5f
+        + fabsf(m_vector_forward[i])*m_scale_z*0.5f;
+    }
+    m_bounds_radius = sqrtf(m_scale_x*m_scale_x + m_scale_y*m_scale_y + m_scale_z*m_scale_z)*0.5f;
+    break;
+  case SHAPE_TYPE_MESH:
+  case SHAPE_TYPE_CONVEX_HULL:
+    if (m_mesh == nullptr) {
+      __vector_element_assign_opV3(half_extent, =, ZERO_VECTOR);
+      break;
+    }
+
+    // move the center of the local bounds into the world and project their half dimensions as for a cuboid
+    m_mesh->aabb_store(local_min, local_max);
+    for (int i = 0; i < 3; i++) {
+      local_center[i] = (local_min[i] + local_max[i])*0.5f;
+      local_half_extent[i] = (local_max[i] - local_min[i])*0.5f;
+    }
+
+    for (int i = 0; i < 3; i++) {
+      center[i] += m_vector_right[i]*local_center[DIM_X] + m_vector_up[i]*local_center[DIM_Y] + m_vector_forward[i]*local_center[DIM_Z];
+      half_extent[i] =
+        fabsf(m_vector_right[i])*local_half_extent[DIM_X]
+        + fabsf(m_vector_up[i])*local_half_extent[DIM_Y]
+        + fabsf(m_vector_forward[i])*local_half_extent[DIM_Z];
+    }
+    m_bounds_radius = __magnitudeV3(local_half_extent);
+    break;
+  case SHAPE_TYPE_SPHERE:
+  case SHAPE_TYPE_CAPSULE:
+  case SHAPE_TYPE_CYLINDER:
+    // the furthest points along each world axis bound the rounded shapes tightly
+    for (int i = 0; i < 3; i++) {
+      const float axis[3] = { i == DIM_X ? 1.0f : 0.0f, i == DIM_Y ? 1.0f : 0.0f, i == DIM_Z ? 1.0f : 0.0f };
+      support_store(axis, local_max);
+      half_extent[i] = local_max[i] - m_position[i];
+    }
+
+    if (m_shape_type == SHAPE_TYPE_SPHERE) {
+      m_bounds_radius = m_scale_x*0.5f;
+    }
+    else if (m_shape_type == SHAPE_TYPE_CAPSULE) {
+      m_bounds_radius = fmaxf(m_scale_x, m_scale_y)*0.5f;
+    }
+    else {
+      m_bounds_radius = sqrtf(m_scale_x*m_scale_x + m_scale_y*m_scale_y)*0.5f;
+    }
+    break;
+  default:
+    __vector_element_assign_opV3(half_extent, =, ZERO_VECTOR);
+    break;
+  }
+
+  __vector_element_opV3(center, -, half_extent, m_bounds_min);
+  __vector_element_opV3(center, +, half_extent, m_bounds_max);
+  __vector_element_assign_opV3(m_bounds_center, =, center);
+  m_bounds_version = m_pose_version;
+}
+
+void Shape::model_matrix_store(float matrix[16]) const {
+  float scale[3] = { 1.0f, 1.0f, 1.0f };
+
+  // meshes and hulls are already in local units, and spheres only use scale_x
+  if (m_shape_type == SHAPE_TYPE_CUBOID) {
+    scale[0] = m_scale_x;
+    scale[1] = m_scale_y;
+    scale[2] = m_scale_z;
+  }
+  else if (m_shape_type == SHAPE_TYPE_SPHERE) {
+    scale[0] = m_scale_x;
+    scale[1] = m_scale_x;
+    scale[2] = m_scale_x;
+  }
 
-    // get min and max point values along the right vector of this
-    axis_min_max_store(m_vector_right, this_axis_min, this_axis_max);
-    shape.axis_min_max_store(m_vector_right, shape_axis_min, shape_axis_max);
+  // the scaled basis vectors form the first three columns
+  __vector_scalar_opV3(m_vector_right, *, scale[0], matrix);
+  __vector_scalar_opV3(m_vector_up, *, scale[1], (matrix + 4));
+  __vector_scalar_opV3(m_vector_forward, *, scale[2], (matrix + 8));
+  __vector_element_assign_opV3((matrix + 12), =, m_position);
 
-    // check whether they intersect
-    is_inside &= (this_axis_min < shape_axis_max && shape_axis_min < this_axis_max);
+  matrix[3] = 0.0f;
+  matrix[7] = 0.0f;
+  matrix[11] = 0.0f;
+  matrix[15] = 1.0f;
+}
 
-    // get min and max point values along the up vector of this
-    axis_min_max_store(m_vector_up, this_axis_min, this_axis_max);
-    shape.axis_min_max_store(m_vector_up, shape_axis_min, shape_axis_max);
+bool Shape::ray_cast(const float origin[3], const float direction[3], const float max_distance, float& distance, float normal[3]) const {
+  float local_origin[3];
+  float local_direction[3];
+  float half_extent[3];
 
-    // check whether they intersect
-    is_inside &= (this_axis_min < shape_axis_max && shape_axis_min < this_axis_max);
+  float distance_near = 0.0f;
+  float distance_far = max_distance;
+  float distance_0;
+  float distance_1;
+  float sign;
 
-    // get min and max point values along the forward vector of this
-    axis_min_max_store(m_vector_forward, this_axis_min, this_axis_max);
-    shape.axis_min_max_store(m_vector_forward, shape_axis_min, shape_axis_max);
+  int near_axis = -1;
+  float near_sign = 0.0f;
 
-    // check whether they intersect
-    is_inside &= (this_axis_min < shape_axis_max && shape_axis_min < this_axis_max);
+  float local_normal[3];
+  float local_point[3];
+  float end_center[3] = { 0.0f, 0.0f, 0.0f };
 
-    // get min and max point values along the right vector of shape
-    axis_min_max_store(shape.m_vector_right, this_axis_min, this_axis_max);
-    shape.axis_min_max_store(shape.m_vector_right, shape_axis_min, shape_axis_max);
+  const float radius = m_scale_x*0.5f;
+  float half_length;
 
-    // check whether they intersect
-    is_inside &= (this_axis_min < shape_axis_max && shape_axis_min < this_axis_max);
+  // express the ray in the local frame of the shape
+  local_point_store(origin, local_origin);
+  local_vector_store(direction, local_direction);
 
-    // get min and max point values along the up vector of shape
-    axis_min_max_store(shape.m_vector_up, this_axis_min, this_axis_max);
-    shape.axis_min_max_store(shape.m_vector_up, shape_axis_min, shape_axis_max);
+  // rays starting inside a solid shape hit immediately, facing back along the ray
+  if (m_shape_type != SHAPE_TYPE_CUBOID && m_shape_type != SHAPE_TYPE_MESH && is_point_inside(origin)) {
+    distance = 0.0f;
+    __negativeV3(direction, normal);
+    return true;
+  }
 
-    // check whether they intersect
-    is_inside &= (this_axis_min < shape_axis_max && shape_axis_min < this_axis_max);
+  switch (m_shape_type) {
+  case SHAPE_TYPE_CUBOID:
+    half_extent[DIM_X] = m_scale_x*0.5f;
+    half_extent[DIM_Y] = m_scale_y*0.5f;
+    half_extent[DIM_Z] = m_scale_z*0.5f;
+
+    // clip the ray against each pair of slabs
+    for (int i = 0; i < 3; i++) {
+      if (local_direction[i] == 0.0f) {
+        if (local_origin[i] < -half_extent[i] || local_origin[i] > half_extent[i]) {
+          return false;
+        }
+        continue;
+      }
+
+      distance_0 = (-half_extent[i] - local_origin[i]) / local_direction[i];
+      distance_1 = (half_extent[i] - local_origin[i]) / local_direction[i];
+      sign = -1.0f;
+
+      if (distance_0 > distance_1) {
+        float temp = distance_0;
+        distance_0 = distance_1;
+        distance_1 = temp;
+        sign = 1.0f;
+      }
+
+      if (distance_0 > distance_near) {
+        distance_near = distance_0;
+        near_axis = i;
+        near_sign = sign;
+      }
+      if (distance_1 < distance_far) {
+        distance_far = distance_1;
+      }
+      if (distance_near > distance_far) {
+        return false;
+      }
+    }
+
+    distance = distance_near;
+
+    // a ray starting inside the cuboid hits immediately, facing back along the ray
+    if (near_axis < 0) {
+      __negativeV3(direction, normal);
+      return true;
+    }
+
+    switch (near_axis) {
+    case DIM_X:
+      __vector_scalar_opV3(m_vector_right, *, near_sign, normal);
+      break;
+    case DIM_Y:
+      __vector_scalar_opV3(m_vector_up, *, near_sign, normal);
+      break;
+    default:
+      __vector_scalar_opV3(m_vector_forward, *, near_sign, normal);
+      break;
+    }
+    return true;
+
+  case SHAPE_TYPE_MESH:
+  case SHAPE_TYPE_CONVEX_HULL:
+    if (m_mesh == nullptr || !m_mesh->ray_cast(local_origin, local_direction, max_distance, distance, local_normal)) {
+      return false;
+    }
+    break;
 
-    // get min and max point values along the forward vector of shape
-    axis_min_max_store(shape.m_vector_forward, this_axis_min, this_axis_max);
-    shape.axis_min_max_store(shape.m_vector_forward, shape_axis_min, shape_axis_max);
+  case SHAPE_TYPE_SPHERE:
+    distance_near = ray_sphere_distance(local_origin, local_direction, ZERO_VECTOR, radius);
+    if (distance_near < 0.0f || distance_near > max_distance) {
+      return false;
+    }
 
-    // check whether they intersect
-    is_inside &= (this_axis_min < shape_axis_max && shape_axis_min < this_axis_max);
+    distance = distance_near;
+    __vector_element_op_and_scalar_opV3(local_origin, +, local_direction, *, distance, local_normal);
+    __vector_scalar_assign_opV3(local_normal, /=, radius);
+    break;
 
-    return is_inside;
+  case SHAPE_TYPE_CAPSULE:
+    half_length = fmaxf(m_scale_y*0.5f - radius, 0.0f);
+
+    // take the nearest of the side and the two end spheres
+    distance_near = ray_cylinder_side_distance(local_origin, local_direction, radius);
+    if (distance_near >= 0.0f && fabsf(local_origin[DIM_Y] + local_direction[DIM_Y]*distance_near) > half_length) {
+      distance_near = -1.0f;
+    }
+
+    for (int side = -1; side <= 1; side += 2) {
+      end_center[DIM_Y] = side*half_length;
+      distance_0 = ray_sphere_distance(local_origin, local_direction, end_center, radius);
+      if (distance_0 >= 0.0f && (distance_near < 0.0f || distance_0 < distance_near)) {
+        distance_near = distance_0;
+      }
+    }
+
+    if (distance_near < 0.0f || distance_near > max_distance) {
+      return false;
+    }
+
+    // the normal points away from the closest point of the core segment
+    distance = distance_near;
+    __vector_element_op_and_scalar_opV3(local_origin, +, local_direction, *, distance, local_normal);
+    local_normal[DIM_Y] -= fminf(fmaxf(local_normal[DIM_Y], -half_length), half_length);
+    __vector_scalar_assign_opV3(local_normal, /=, radius);
+    break;
+
+  case SHAPE_TYPE_CYLINDER:
+    half_length = m_scale_y*0.5f;
+
+    distance_near = ray_cylinder_side_distance(local_origin, local_direction, radius);
+    if (distance_near >= 0.0f && fabsf(local_origin[DIM_Y] + local_direction[DIM_Y]*distance_near) <= half_length) {
+      __vector_element_op_and_scalar_opV3(local_origin, +, local_direction, *, distance_near, local_normal);
+      local_normal[DIM_Y] = 0.0f;
+      __vector_scalar_assign_opV3(local_normal, /=, radius);
+    }
+    else {
+      distance_near = -1.0f;
+    }
+
+    // the caps are only reached through the plane on the side of the origin
+    if (local_direction[DIM_Y] != 0.0f && fabsf(local_origin[DIM_Y]) > half_length) {
+      sign = local_origin[DIM_Y] > 0.0f ? 1.0f : -1.0f;
+      distance_0 = (sign*half_length - local_origin[DIM_Y]) / local_direction[DIM_Y];
+      __vector_element_op_and_scalar_opV3(local_origin, +, local_direction, *, distance_0, local_point);
+
+      if (distance_0 >= 0.0f
+        && local_point[DIM_X]*local_point[DIM_X] + local_point[DIM_Z]*local_point[DIM_Z] <= radius*radius
+        && (distance_near < 0.0f || distance_0 < distance_near)
+        )
+      {
+        distance_near = distance_0;
+        __vector_element_assign_opV3(local_normal, =, ZERO_VECTOR);
+        local_normal[DIM_Y] = sign;
+      }
+    }
+
+    if (distance_near < 0.0f || distance_near > max_distance) {
+      return false;
+    }
+
+    distance = distance_near;
+    break;
 
   default:
     return false;
   }
+
+  // the basis is orthonormal, so distances carry over and the normal only needs rotating back
+  for (int i = 0; i < 3; i++) {
+    normal[i] = m_vector_right[i]*local_normal[DIM_X] + m_vector_up[i]*local_normal[DIM_Y] + m_vector_forward[i]*local_normal[DIM_Z];
+  }
+  return true;
 }
 
-void Shape::draw_GLUT() const {
-  glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE, m_color);
-  glMaterialfv(GL_FRONT_AND_BACK, GL_SPECULAR, m_reflectance);
-  glMaterialfv(GL_FRONT_AND_BACK, GL_SHININESS, &m_shininess);
+void Shape::support_store(const float direction[3], float point[3]) const {
+  float local_direction[3];
+  float local_point[3];
+  float radial_length;
+  float projection;
+  float best_projection;
 
-  glPushMatrix();
+  const float radius = m_scale_x*0.5f;
 
-  glTranslatef(m_position_x, m_position_y, m_position_z);
-  glRotatef(m_angle_vertical*RAD_TO_DEG, m_vector_right_x, 0.0f, m_vector_right_z);
-  glRotatef(-m_angle_horizontal*RAD_TO_DEG, 0.0f, 1.0f, 0.0f);
-  glScalef(m_scale_x, m_scale_y, m_scale_z);
+  local_vector_store(direction, local_direction);
 
   switch (m_shape_type) {
   case SHAPE_TYPE_CUBOID:
-    glutSolidCube(1.0);
+    local_point[DIM_X] = local_direction[DIM_X] < 0.0f ? -m_scale_x*0.5f : m_scale_x*0.5f;
+    local_point[DIM_Y] = local_direction[DIM_Y] < 0.0f ? -m_scale_y*0.5f : m_scale_y*0.5f;
+    local_point[DIM_Z] = local_direction[DIM_Z] < 0.0f ? -m_scale_z*0.5f : m_scale_z*0.5f;
     break;
+
+  case SHAPE_TYPE_SPHERE:
+  case SHAPE_TYPE_CAPSULE:
+    // the sphere around the end of the core segment that lies furthest along direction
+    __vector_element_assign_opV3(local_point, =, local_direction);
+    radial_length = __magnitudeV3(local_direction);
+    if (radial_length > 0.0f) {
+      __vector_scalar_assign_opV3(local_point, *=, radius / radial_length);
+    }
+
+    if (m_shape_type == SHAPE_TYPE_CAPSULE) {
+      projection = fmaxf(m_scale_y*0.5f - radius, 0.0f);
+      local_point[DIM_Y] += local_direction[DIM_Y] < 0.0f ? -projection : projection;
+    }
+    break;
+
+  case SHAPE_TYPE_CYLINDER:
+    // the rim of the cap that lies furthest along direction
+    local_point[DIM_X] = local_direction[DIM_X];
+    local_point[DIM_Y] = local_direction[DIM_Y] < 0.0f ? -m_scale_y*0.5f : m_scale_y*0.5f;
+    local_point[DIM_Z] = local_direction[DIM_Z];
+
+    radial_length = sqrtf(local_direction[DIM_X]*local_direction[DIM_X] + local_direction[DIM_Z]*local_direction[DIM_Z]);
+    if (radial_length > 0.0f) {
+      local_point[DIM_X] *= radius / radial_length;
+      local_point[DIM_Z] *= radius / radial_length;
+    }
+    break;
+
+  case SHAPE_TYPE_MESH:
+  case SHAPE_TYPE_CONVEX_HULL:
+    // the vertex furthest along direction
+    __vector_element_assign_opV3(local_point, =, ZERO_VECTOR);
+    if (m_mesh == nullptr) {
+      break;
+    }
+
+    best_projection = -FLT_MAX;
+    for (size_t i = 0; i < m_mesh->c_triangle_vertices.size(); i += 3) {
+      const float* vertex = &m_mesh->c_triangle_vertices[i];
+
+      projection = __dot_productV3(vertex, local_direction);
+      if (projection > best_projection) {
+        best_projection = projection;
+        __vector_element_assign_opV3(local_point, =, vertex);
+      }
+    }
+    break;
+
   default:
+    __vector_element_assign_opV3(local_point, =, ZERO_VECTOR);
     break;
   }
 
+  for (int i = 0; i < 3; i++) {
+    point[i] = m_position[i] + m_vector_right[i]*local_point[DIM_X] + m_vector_up[i]*local_point[DIM_Y] + m_vector_forward[i]*local_point[DIM_Z];
+  }
+}
+
+void Shape::draw_GLUT() const {
+  glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE, m_color);
+  glMaterialfv(GL_FRONT_AND_BACK, GL_SPECULAR, m_reflectance);
+  glMaterialfv(GL_FRONT_AND_BACK, GL_SHININESS, &m_shininess);
+
+  float model[16];
+  model_matrix_store(model);
+
+  glPushMatrix();
+  glMultMatrixf(model);
+  draw_model_GLUT();
   glPopMatrix();
 
 #if DRAW_AXES
@@ -247,6 +807,185 @@ void Shape::draw_GLUT() const {
 #endif
 }
 
+void Shape::draw_model_GLUT() const {
+  switch (m_shape_type) {
+  case SHAPE_TYPE_CUBOID:
+    glutSolidCube(1.0);
+    break;
+  case SHAPE_TYPE_MESH:
+  case SHAPE_TYPE_CONVEX_HULL:
+    if (m_mesh != nullptr) {
+      m_mesh->draw_GLUT();
+    }
+    break;
+  case SHAPE_TYPE_SPHERE:
+    glutSolidSphere(0.5, ROUND_SHAPE_SLICES, ROUND_SHAPE_STACKS);
+    break;
+  case SHAPE_TYPE_CAPSULE:
+  case SHAPE_TYPE_CYLINDER:
+    draw_round_GLUT();
+    break;
+  default:
+    break;
+  }
+}
+
+int Shape::triangle_count() const {
+  // GLUT spheres fan the poles and strip the stacks between them, and GLU draws one ring of slices for the side of a
+  // cylinder and for each disk
+  const int sphere_triangles = 2*ROUND_SHAPE_SLICES*(ROUND_SHAPE_STACKS - 1);
+  const int side_triangles = 2*ROUND_SHAPE_SLICES;
+
+  switch (m_shape_type) {
+  case SHAPE_TYPE_CUBOID:
+    return 12;
+  case SHAPE_TYPE_MESH:
+  case SHAPE_TYPE_CONVEX_HULL:
+    return m_mesh != nullptr ? m_mesh->c_triangle_count : 0;
+  case SHAPE_TYPE_SPHERE:
+    return sphere_triangles;
+  case SHAPE_TYPE_CAPSULE:
+    return side_triangles + sphere_triangles*2;
+  case SHAPE_TYPE_CYLINDER:
+    return side_triangles + ROUND_SHAPE_SLICES*2;
+  default:
+    return 0;
+  }
+}
+
+void Shape::draw_round_GLUT() const {
+  static GLUquadric* quadric = gluNewQuadric();
+
+  const double radius = m_scale_x*0.5;
+  const double half_length = m_shape_type == SHAPE_TYPE_CAPSULE ? fmax(m_scale_y*0.5 - radius, 0.0) : m_scale_y*0.5;
+
+  // GLU builds along the z axis, so turn it onto the up vector
+  glRotatef(-90.0f, 1.0f, 0.0f, 0.0f);
+  glTranslated(0.0, 0.0, -half_length);
+
+  gluCylinder(quadric, radius, radius, half_length*2.0, ROUND_SHAPE_SLICES, 1);
+
+  if (m_shape_type == SHAPE_TYPE_CAPSULE) {
+    glutSolidSphere(radius, ROUND_SHAPE_SLICES, ROUND_SHAPE_STACKS);
+    glTranslated(0.0, 0.0, half_length*2.0);
+    glutSolidSphere(radius, ROUND_SHAPE_SLICES, ROUND_SHAPE_STACKS);
+  }
+  else {
+    // the bottom cap faces down the axis
+    glPushMatrix();
+    glRotatef(180.0f, 1.0f, 0.0f, 0.0f);
+    gluDisk(quadric, 0.0, radius, ROUND_SHAPE_SLICES, 1);
+    glPopMatrix();
+
+    glTranslated(0.0, 0.0, half_length*2.0);
+    gluDisk(quadric, 0.0, radius, ROUND_SHAPE_SLICES, 1);
+  }
+}
+
+bool Shape::is_mesh_overlapping_cuboid(const Shape& mesh_shape, const Shape& cuboid_shape) {
+  float relative_center[3];
+  float center[3];
+  float axes[3][3];
+  float half_extent[3];
+
+  const float* cuboid_axes[3] = { cuboid_shape.m_vector_right, cuboid_shape.m_vector_up, cuboid_shape.m_vector_forward };
+
+  if (mesh_shape.m_mesh == nullptr) {
+    return false;
+  }
+
+  // express the cuboid in the local frame of the mesh
+  __vector_element_opV3(cuboid_shape.m_position, -, mesh_shape.m_position, relative_center);
+
+  center[DIM_X] = __dot_productV3(relative_center, mesh_shape.m_vector_right);
+  center[DIM_Y] = __dot_productV3(relative_center, mesh_shape.m_vector_up);
+  center[DIM_Z] = __dot_productV3(relative_center, mesh_shape.m_vector_forward);
+
+  for (int i = 0; i < 3; i++) {
+    axes[i][DIM_X] = __dot_productV3(cuboid_axes[i], mesh_shape.m_vector_right);
+    axes[i][DIM_Y] = __dot_productV3(cuboid_axes[i], mesh_shape.m_vector_up);
+    axes[i][DIM_Z] = __dot_productV3(cuboid_axes[i], mesh_shape.m_vector_forward);
+  }
+
+  half_extent[DIM_X] = cuboid_shape.m_scale_x*0.5f;
+  half_extent[DIM_Y] = cuboid_shape.m_scale_y*0.5f;
+  half_extent[DIM_Z] = cuboid_shape.m_scale_z*0.5f;
+
+  return mesh_shape.m_mesh->is_box_overlapping(center, axes, half_extent);
+}
+
+bool Shape::is_mesh_overlapping_convex(const Shape& mesh_shape, const Shape& shape) {
+  thread_local vector<int> triangle_indices;
+  float corners[9];
+
+  if (mesh_shape.m_mesh == nullptr) {
+    return false;
+  }
+
+  mesh_shape.mesh_triangles_store(shape, triangle_indices);
+
+  for (const int triangle_index : triangle_indices) {
+    mesh_shape.mesh_triangle_store(triangle_index, corners);
+    if (gjk_is_triangle_overlapping(shape, corners)) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void Shape::mesh_triangles_store(const Shape& shape, vector<int>& triangle_indices) const {
+  float min[3];
+  float max[3];
+  float center[3];
+  float half_extent[3];
+  float local_center[3];
+  float reach;
+
+  const float* axes[3] = { m_vector_right, m_vector_up, m_vector_forward };
+
+  // bound the world bounds of shape with an axis-aligned box in the mesh frame
+  shape.aabb_store(min, max);
+  for (int i = 0; i < 3; i++) {
+    center[i] = (min[i] + max[i])*0.5f;
+    half_extent[i] = (max[i] - min[i])*0.5f;
+  }
+  local_point_store(center, local_center);
+
+  for (int i = 0; i < 3; i++) {
+    reach = fabsf(axes[i][DIM_X])*half_extent[DIM_X] + fabsf(axes[i][DIM_Y])*half_extent[DIM_Y] + fabsf(axes[i][DIM_Z])*half_extent[DIM_Z];
+    min[i] = local_center[i] - reach;
+    max[i] = local_center[i] + reach;
+  }
+
+  m_mesh->triangles_store(min, max, triangle_indices);
+}
+
+void Shape::mesh_triangle_store(const int triangle_index, float corners[9]) const {
+  const float* local = &m_mesh->c_triangle_vertices[triangle_index*9];
+
+  // meshes are not scaled, so the local corners only need rotating and moving
+  for (int i = 0; i < 3; i++) {
+    const float* corner = local + i*3;
+    for (int j = 0; j < 3; j++) {
+      corners[i*3 + j] = m_position[j] + m_vector_right[j]*corner[DIM_X] + m_vector_up[j]*corner[DIM_Y] + m_vector_forward[j]*corner[DIM_Z];
+    }
+  }
+}
+
+void Shape::local_point_store(const float point[3], float local[3]) const {
+  float relative[3];
+
+  __vector_element_opV3(point, -, m_position, relative);
+  local_vector_store(relative, local);
+}
+
+void Shape::local_vector_store(const float vector[3], float local[3]) const {
+  local[DIM_X] = __dot_productV3(vector, m_vector_right);
+  local[DIM_Y] = __dot_productV3(vector, m_vector_up);
+  local[DIM_Z] = __dot_productV3(vector, m_vector_forward);
+}
+
 void Shape::axis_min_max_store(const float axis[3], float& min, float& max) const {
   float cuboid_corner_point[3];
 
@@ -2,11 +2,31 @@
 #define SHAPE_H
 
 #include "Object.h"
+#include "TriangleMesh.h"
 
 #define SHAPE_TYPE_CUBOID 0
+#define SHAPE_TYPE_MESH 1
+
+// radius scale_x / 2
+#define SHAPE_TYPE_SPHERE 2
+
+// radius scale_x / 2 and total height scale_y along the up vector, including the caps
+#define SHAPE_TYPE_CAPSULE 3
+
+// radius scale_x / 2 and height scale_y along the up vector
+#define SHAPE_TYPE_CYLINDER 4
+
+// the convex hull of the vertices of a mesh set with set_mesh, not scaled
+#define SHAPE_TYPE_CONVEX_HULL 5
+
+#define SHAPE_TYPE_COUNT 6
 
 #define SHAPE_TYPE_DEFAULT SHAPE_TYPE_CUBOID
 
+// tessellation of the rounded shapes drawn with GLUT and GLU, and on the CPU by SoftwareRenderer
+#define ROUND_SHAPE_SLICES 24
+#define ROUND_SHAPE_STACKS 12
+
 #define __test_cuboid_plane_outside(point, plane_vector, origin, edge_plane_distance, temp_vector, bool_store) \
       /* find vector to edge of cuboid */ \
       __vector_scalar_opV3(plane_vector, *, edge_plane_distance, temp_vector); \
@@ -19,6 +39,16 @@
 
 #define NULL_SHAPE_PTR (Shape*)0
 
+class Shape;
+struct GjkCache;
+
+// a collision test specialized for one pair of shape types; kernels that run GJK warm start from cache when it is not
+// null
+typedef bool (*CollisionFunction)(const Shape& shape_a, const Shape& shape_b, GjkCache* cache);
+
+template <int TYPE_A, int TYPE_B>
+struct CollisionKernel;
+
 class Shape : public Object {
 public:
   Shape(const int shape_type = SHAPE_TYPE_DEFAULT);
@@ -29,10 +59,12 @@ public:
   const float& c_scale_y = m_scale_y;
   const float& c_scale_z = m_scale_z;
 
-  const float* c_color;
-  const float* c_reflectance;
+  const float* c_color = m_color;
+  const float* c_reflectance = m_reflectance;
   const float& c_shininess = m_shininess;
 
+  const TriangleMesh* const& c_mesh = m_mesh;
+
   void set_scale(const float scale_x, const float scale_y, const float scale_z);
   void set_scale(const float dimensions[3]);
 
@@ -48,11 +80,50 @@ public:
 
   void set_shininess(const float shininess);
 
+  // uses mesh for the geometry of a SHAPE_TYPE_MESH or SHAPE_TYPE_CONVEX_HULL shape; its vertices are in the local frame
+  // and are not scaled
+  void set_mesh(const TriangleMesh* mesh);
+
   bool is_point_inside(const float point[3]) const;
   bool is_shape_inside(const Shape& shape) const;
 
+  // yields the collision kernel for a pair of shape types so that loops over many pairs of the same types look it up once
+  static CollisionFunction collision_function(const int shape_type_a, const int shape_type_b);
+
+  // whether the kernel for a pair of shape types runs GJK on the shapes and so reads and updates a GjkCache
+  static bool is_collision_cached(const int shape_type_a, const int shape_type_b);
+
+  // replaces triangle_indices with the triangles of a mesh shape whose leaves overlap the bounds of shape
+  void mesh_triangles_store(const Shape& shape, std::vector<int>& triangle_indices) const;
+
+  // stores the world corners of a triangle of a mesh shape
+  void mesh_triangle_store(const int triangle_index, float corners[9]) const;
+
+  // stores the point of the shape furthest along direction, in world coordinates
+  void support_store(const float direction[3], float point[3]) const;
+
+  // classifies point_count points, stored as consecutive x, y, z elements, storing 1 in inside_store for each one inside
+  void classify_points(const float* points, const int point_count, unsigned char* inside_store) const;
+
+  // the bounds are cached until the pose, scale or mesh changes, so the first call after a change must not race with
+  // others on the same shape
+  void aabb_store(float min[3], float max[3]) const;
+  void bounding_sphere_store(float center[3], float& radius) const;
+
+  // stores the column-major matrix that maps the unit shape to its scaled world pose; capsules and cylinders do not scale
+  // evenly, so their matrix is the unscaled pose
+  void model_matrix_store(float matrix[16]) const;
+
+  bool ray_cast(const float origin[3], const float direction[3], const float max_distance, float& distance, float normal[3]) const;
+
   void draw_GLUT() const;
 
+  // draws the geometry alone in the frame of model_matrix_store, leaving the material and matrix to the caller
+  void draw_model_GLUT() const;
+
+  // the number of triangles draw_model_GLUT draws
+  int triangle_count() const;
+
 private:
   // a code that defines what shape the object has
   int m_shape_type;
@@ -65,7 +136,37 @@ private:
   float m_reflectance[4];
   float m_shininess;
 
+  const TriangleMesh* m_mesh;
+
+  // world bounds as of c_pose_version m_bounds_version
+  mutable float m_bounds_min[3];
+  mutable float m_bounds_max[3];
+  mutable float m_bounds_center[3];
+  mutable float m_bounds_radius;
+  mutable unsigned int m_bounds_version;
+
+  template <int TYPE_A, int TYPE_B>
+  friend struct CollisionKernel;
+
+  bool is_cuboid_overlapping_cuboid(const Shape& shape) const;
+
+  // tests the triangles of the mesh shape against the cuboid shape
+  static bool is_mesh_overlapping_cuboid(const Shape& mesh_shape, const Shape& cuboid_shape);
+
+  // tests the triangles of the mesh shape near the convex shape against it one at a time with GJK
+  static bool is_mesh_overlapping_convex(const Shape& mesh_shape, const Shape& shape);
+
+  // expresses a world point or direction in the local frame
+  void local_point_store(const float point[3], float local[3]) const;
+  void local_vector_store(const float vector[3], float local[3]) const;
+
+  // draws a capsule or cylinder in the local frame
+  void draw_round_GLUT() const;
+
   void axis_min_max_store(const float axis[3], float& min, float& max) const;
+
+  // recomputes the cached bounds when the shape changed since they were found
+  void bounds_update() const;
 };
 
 #endif
\ No newline at end of file
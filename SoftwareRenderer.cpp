@@ -0,0 +1,629 @@
+#include "SoftwareRenderer.h"
+
+#include <cmath>
+#include <cstdio>
+#include <algorithm>
+using namespace std;
+
+#include "macro_constants.h"
+#include "vector3.h"
+#include "matrix4.h"
+
+// largest polygon produced by clipping a quad against the five clip planes
+#define MAX_CLIPPED_VERTICES 16
+
+// rings of the outline of a round shape: a pole and ROUND_SHAPE_STACKS / 2 more for each end, or four for a cylinder
+#define ROUND_RINGS_MAX (ROUND_SHAPE_STACKS + 4)
+
+#define __pack_color(red, green, blue, alpha) \
+  ((unsigned int)((red) > 1.0f ? 255.0f : (red)*255.0f) \
+  | ((unsigned int)((green) > 1.0f ? 255.0f : (green)*255.0f) << 8) \
+  | ((unsigned int)((blue) > 1.0f ? 255.0f : (blue)*255.0f) << 16) \
+  | ((unsigned int)((alpha) > 1.0f ? 255.0f : (alpha)*255.0f) << 24))
+
+// clip planes as coefficients of x, y, z and w that are non-negative inside the view volume
+static const float CLIP_PLANES[5][4] = {
+  { 0.0f, 0.0f, 1.0f, 1.0f },
+  { 1.0f, 0.0f, 0.0f, 1.0f },
+  { -1.0f, 0.0f, 0.0f, 1.0f },
+  { 0.0f, 1.0f, 0.0f, 1.0f },
+  { 0.0f, -1.0f, 0.0f, 1.0f }
+};
+
+SoftwareRenderer::SoftwareRenderer(const int width, const int height) {
+  const float clear_color[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+  const float light_position[4] = { 0.0f, 1.0f, 0.0f, 0.0f };
+  const float light_intensity[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+
+  m_tile_size = DEFAULT_TILE_SIZE;
+
+  m_field_of_view_y = DEFAULT_FIELD_OF_VIEW_Y;
+  m_near_distance = DEFAULT_NEAR_DISTANCE;
+  m_far_distance = DEFAULT_FAR_DISTANCE;
+
+  m_triangle_count = 0;
+
+  set_clear_color(clear_color);
+  set_light(light_position, light_intensity);
+
+  resize(width, height);
+}
+
+void SoftwareRenderer::resize(const int width, const int height) {
+  m_width = width > 0 ? width : 1;
+  m_height = height > 0 ? height : 1;
+
+  m_color_buffer.assign(m_width*m_height, m_clear_color);
+  m_depth_buffer.assign(m_width*m_height, 1.0f);
+
+  set_tile_size(m_tile_size);
+}
+
+void SoftwareRenderer::set_tile_size(const int tile_size) {
+  m_tile_size = tile_size > 0 ? tile_size : DEFAULT_TILE_SIZE;
+
+  m_tiles_x = (m_width + m_tile_size - 1) / m_tile_size;
+  m_tiles_y = (m_height + m_tile_size - 1) / m_tile_size;
+
+  m_tile_bins.assign(m_tiles_x*m_tiles_y, vector<int>());
+}
+
+void SoftwareRenderer::set_perspective(const float field_of_view_y, const float near_distance, const float far_distance) {
+  m_field_of_view_y = field_of_view_y;
+  m_near_distance = near_distance;
+  m_far_distance = far_distance;
+}
+
+void SoftwareRenderer::set_clear_color(const float color[4]) {
+  m_clear_color = __pack_color(color[0], color[1], color[2], color[3]);
+}
+
+void SoftwareRenderer::set_light(const float position[4], const float intensity[4]) {
+  // only directional lights are supported, so the position is treated as a direction
+  __vector_element_assign_opV3(m_light_direction, =, position);
+  normalizeV3(m_light_direction);
+
+  for (int i = 0; i < 4; i++) {
+    m_light_intensity[i] = intensity[i];
+  }
+}
+
+void SoftwareRenderer::render(const vector<Shape*>& shapes, const Camera& camera, WorkerPool& pool) {
+  ShapeSnapshot shape_snapshot;
+
+  frame_begin(camera.c_position, camera.c_target, camera.c_vector_up_roll);
+
+  for (size_t i = 0; i < shapes.size(); i++) {
+    const Shape& shape = *shapes[i];
+
+    shape_snapshot.shape = &shape;
+    shape.model_matrix_store(shape_snapshot.model);
+    copy(shape.c_color, shape.c_color + 4, shape_snapshot.color);
+    copy(shape.c_reflectance, shape.c_reflectance + 4, shape_snapshot.reflectance);
+    shape_snapshot.shininess = shape.c_shininess;
+
+    setup_shape(shape_snapshot);
+  }
+
+  frame_finish(pool);
+}
+
+void SoftwareRenderer::render(const WorldSnapshot& snapshot, const ViewSnapshot& view, WorkerPool& pool) {
+  frame_begin(view.camera_position, view.camera_target, view.camera_vector_up);
+
+  for (size_t i = 0; i < view.shape_indices.size(); i++) {
+    setup_shape(snapshot.shapes[view.shape_indices[i]]);
+  }
+
+  frame_finish(pool);
+}
+
+bool SoftwareRenderer::write_ppm(const char* path) const {
+  FILE* file = fopen(path, "wb");
+  unsigned char pixel[3];
+
+  if (file == NULL) {
+    return false;
+  }
+
+  fprintf(file, "P6\n%d %d\n255\n", m_width, m_height);
+
+  for (int i = 0; i < m_width*m_height; i++) {
+    pixel[0] = (unsigned char)(m_color_buffer[i] & 0xff);
+    pixel[1] = (unsigned char)((m_color_buffer[i] >> 8) & 0xff);
+    pixel[2] = (unsigned char)((m_color_buffer[i] >> 16) & 0xff);
+    fwrite(pixel, 1, 3, file);
+  }
+
+  return fclose(file) == 0;
+}
+
+void SoftwareRenderer::frame_begin(const float eye[3], const float target[3], const float vector_up[3]) {
+  float projection[16];
+  float view[16];
+  float view_direction[3];
+
+  perspectiveM4(m_field_of_view_y, (float)m_width / (float)m_height, m_near_distance, m_far_distance, projection);
+  look_atM4(eye, target, vector_up, view);
+  multiplyM4(projection, view, m_view_projection);
+
+  __vector_element_assign_opV3(m_eye, =, eye);
+
+  // specular highlights use a viewer at infinity, as in the fixed-function pipeline
+  __vector_element_opV3(target, -, eye, view_direction);
+  normalizeV3(view_direction);
+  __vector_element_opV3(m_light_direction, -, view_direction, m_half_vector);
+  normalizeV3(m_half_vector);
+
+  // transform, clip and bin every triangle
+  m_triangles.clear();
+  for (size_t i = 0; i < m_tile_bins.size(); i++) {
+    m_tile_bins[i].clear();
+  }
+}
+
+void SoftwareRenderer::frame_finish(WorkerPool& pool) {
+  for (size_t i = 0; i < m_triangles.size(); i++) {
+    const RasterTriangle& triangle = m_triangles[i];
+
+    for (int tile_y = triangle.min_y / m_tile_size; tile_y <= triangle.max_y / m_tile_size; tile_y++) {
+      for (int tile_x = triangle.min_x / m_tile_size; tile_x <= triangle.max_x / m_tile_size; tile_x++) {
+        m_tile_bins[tile_y*m_tiles_x + tile_x].push_back((int)i);
+      }
+    }
+  }
+
+  m_triangle_count = (int)m_triangles.size();
+
+  // each tile owns its pixels, so tiles can be filled without synchronization
+  pool.parallel_for(m_tiles_x*m_tiles_y, 1, [this](const int begin, const int end) {
+    for (int i = begin; i < end; i++) {
+      rasterize_tile(i);
+    }
+  });
+}
+
+void SoftwareRenderer::setup_shape(const ShapeSnapshot& shape) {
+  float model_view_projection[16];
+
+  float normal[3];
+  float face_center[3];
+  float to_eye[3];
+  float corner[3];
+  float clip_vertices[4][4];
+
+  int axis_0;
+  int axis_1;
+
+  // the columns of the model matrix are the scaled axes of the cuboid, and the last one its center
+  const float* axes[3] = { shape.model, shape.model + 4, shape.model + 8 };
+  const float* center = shape.model + 12;
+
+  // corners of a face in the two axes perpendicular to its normal, in winding order
+  static const float FACE_CORNERS[4][2] = {
+    { -0.5f, -0.5f }, { 0.5f, -0.5f }, { 0.5f, 0.5f }, { -0.5f, 0.5f }
+  };
+
+  const int shape_type = shape.shape->c_shape_type;
+
+  if (shape_type == SHAPE_TYPE_MESH || shape_type == SHAPE_TYPE_CONVEX_HULL) {
+    setup_mesh(shape);
+    return;
+  }
+
+  if (shape_type == SHAPE_TYPE_SPHERE || shape_type == SHAPE_TYPE_CAPSULE || shape_type == SHAPE_TYPE_CYLINDER) {
+    setup_round(shape);
+    return;
+  }
+
+  if (shape_type != SHAPE_TYPE_CUBOID) {
+    return;
+  }
+
+  multiplyM4(m_view_projection, shape.model, model_view_projection);
+
+  for (int axis = 0; axis < 3; axis++) {
+    for (int side = -1; side <= 1; side += 2) {
+      // skip faces pointing away from the camera
+      __vector_element_op_and_scalar_opV3(center, +, axes[axis], *, side*0.5f, face_center);
+      __vector_element_opV3(m_eye, -, face_center, to_eye);
+      __vector_scalar_opV3(axes[axis], *, (float)side, normal);
+      if (__dot_productV3(normal, to_eye) <= 0.0f) {
+        continue;
+      }
+      normalizeV3(normal);
+
+      // transform the corners of the face to clip space
+      axis_0 = (axis + 1) % 3;
+      axis_1 = (axis + 2) % 3;
+
+      for (int i = 0; i < 4; i++) {
+        corner[axis] = side*0.5f;
+        corner[axis_0] = FACE_CORNERS[i][0];
+        corner[axis_1] = FACE_CORNERS[i][1];
+        __transform_pointM4(model_view_projection, corner, clip_vertices[i]);
+      }
+
+      add_polygon(clip_vertices, 4, shade_face(shape, normal));
+    }
+  }
+}
+
+void SoftwareRenderer::setup_mesh(const ShapeSnapshot& shape) {
+  float model_view_projection[16];
+
+  float corners[3][4];
+  float edge_0[3];
+  float edge_1[3];
+  float normal[3];
+  float to_eye[3];
+  float clip_vertices[3][4];
+
+  const TriangleMesh* mesh = shape.shape->c_mesh;
+
+  if (mesh == nullptr) {
+    return;
+  }
+
+  multiplyM4(m_view_projection, shape.model, model_view_projection);
+
+  for (int i = 0; i < mesh->c_triangle_count; i++) {
+    const float* local_corners = &mesh->c_triangle_vertices[i*9];
+
+    for (int j = 0; j < 3; j++) {
+      __transform_pointM4(shape.model, (local_corners + j*3), corners[j]);
+      __transform_pointM4(model_view_projection, (local_corners + j*3), clip_vertices[j]);
+    }
+
+    // meshes are drawn without culling, so light the side that faces the camera
+    __vector_element_opV3(corners[1], -, corners[0], edge_0);
+    __vector_element_opV3(corners[2], -, corners[0], edge_1);
+    __cross_productV3(edge_0, edge_1, normal);
+    if (__dot_productV3(normal, normal) == 0.0f) {
+      continue;
+    }
+    normalizeV3(normal);
+
+    __vector_element_opV3(m_eye, -, corners[0], to_eye);
+    if (__dot_productV3(normal, to_eye) < 0.0f) {
+      __negativeV3(normal, normal);
+    }
+
+    add_polygon(clip_vertices, 3, shade_face(shape, normal));
+  }
+}
+
+void SoftwareRenderer::setup_round(const ShapeSnapshot& shape) {
+  float model_view_projection[16];
+
+  // radius and height of each ring of the outline from the bottom up
+  float ring_radii[ROUND_RINGS_MAX];
+  float ring_heights[ROUND_RINGS_MAX];
+  int ring_count = 0;
+
+  float slice_cos[ROUND_SHAPE_SLICES + 1];
+  float slice_sin[ROUND_SHAPE_SLICES + 1];
+
+  float local_corners[4][3];
+  float corners[4][3];
+  float clip_vertices[4][4];
+  float diagonal_0[3];
+  float diagonal_1[3];
+  float normal[3];
+  float face_center[3];
+  float to_eye[3];
+  float to_face[3];
+
+  const Shape& source = *shape.shape;
+  const float* center = shape.model + 12;
+
+  // spheres are scaled by their model matrix, but capsules and cylinders are in world units
+  const float radius = source.c_shape_type == SHAPE_TYPE_SPHERE ? 0.5f : source.c_scale_x*0.5f;
+  const float half_length =
+    source.c_shape_type == SHAPE_TYPE_SPHERE ? 0.0f
+    : source.c_shape_type == SHAPE_TYPE_CAPSULE ? fmaxf(source.c_scale_y*0.5f - radius, 0.0f)
+    : source.c_scale_y*0.5f;
+
+  if (source.c_shape_type == SHAPE_TYPE_CYLINDER) {
+    const float radii[4] = { 0.0f, radius, radius, 0.0f };
+    const float heights[4] = { -half_length, -half_length, half_length, half_length };
+
+    for (ring_count = 0; ring_count < 4; ring_count++) {
+      ring_radii[ring_count] = radii[ring_count];
+      ring_heights[ring_count] = heights[ring_count];
+    }
+  }
+  else {
+    // a hemisphere at each end, with the side between the two equators left flat for a sphere
+    const int stacks = max(ROUND_SHAPE_STACKS / 2, 1);
+
+    for (int end = 0; end < 2; end++) {
+      for (int i = 0; i <= stacks; i++) {
+        const int step = i + end*stacks;
+        const float angle = HALF_PI*((float)step / (float)stacks - 1.0f);
+
+        // the poles are exactly on the axis, so that their faces are triangles
+        ring_radii[ring_count] = step == 0 || step == stacks*2 ? 0.0f : radius*cosf(angle);
+        ring_heights[ring_count] = radius*sinf(angle) + (end == 0 ? -half_length : half_length);
+        ring_count++;
+      }
+    }
+  }
+
+  for (int i = 0; i <= ROUND_SHAPE_SLICES; i++) {
+    const float angle = DOUBLE_PI*(float)i / (float)ROUND_SHAPE_SLICES;
+
+    slice_cos[i] = cosf(angle);
+    slice_sin[i] = sinf(angle);
+  }
+
+  multiplyM4(m_view_projection, shape.model, model_view_projection);
+
+  for (int ring = 0; ring + 1 < ring_count; ring++) {
+    if (ring_radii[ring] == ring_radii[ring + 1] && ring_heights[ring] == ring_heights[ring + 1]) {
+      continue;
+    }
+
+    for (int slice = 0; slice < ROUND_SHAPE_SLICES; slice++) {
+      int vertex_count = 0;
+
+      // a pole meets the next ring in a triangle, so the repeated corner is left out
+      for (int i = 0; i < 4; i++) {
+        const int corner_ring = ring + (i >= 2 ? 1 : 0);
+        const int corner_slice = slice + (i == 1 || i == 2 ? 1 : 0);
+
+        if (ring_radii[corner_ring] == 0.0f && (i == 1 || i == 3)) {
+          continue;
+        }
+
+        local_corners[vertex_count][0] = ring_radii[corner_ring]*slice_cos[corner_slice];
+        local_corners[vertex_count][1] = ring_heights[corner_ring];
+        local_corners[vertex_count][2] = ring_radii[corner_ring]*slice_sin[corner_slice];
+        vertex_count++;
+      }
+
+      for (int i = 0; i < vertex_count; i++) {
+        __transform_pointM4(shape.model, local_corners[i], corners[i]);
+        __transform_pointM4(model_view_projection, local_corners[i], clip_vertices[i]);
+      }
+
+      // the diagonals give the normal of triangles and quads alike, turned away from the center of the convex shape
+      __vector_element_opV3(corners[vertex_count == 4 ? 2 : 1], -, corners[0], diagonal_0);
+      __vector_element_opV3(corners[vertex_count == 4 ? 3 : 2], -, corners[1], diagonal_1);
+      __cross_productV3(diagonal_0, diagonal_1, normal);
+      if (__dot_productV3(normal, normal) == 0.0f) {
+        continue;
+      }
+      normalizeV3(normal);
+
+      __vector_element_assign_opV3(face_center, =, corners[0]);
+      for (int i = 1; i < vertex_count; i++) {
+        __vector_element_opV3(face_center, +, corners[i], face_center);
+      }
+      __vector_scalar_assign_opV3(face_center, /=, (float)vertex_count);
+
+      __vector_element_opV3(face_center, -, center, to_face);
+      if (__dot_productV3(normal, to_face) < 0.0f) {
+        __negativeV3(normal, normal);
+      }
+
+      // skip faces pointing away from the camera
+      __vector_element_opV3(m_eye, -, face_center, to_eye);
+      if (__dot_productV3(normal, to_eye) <= 0.0f) {
+        continue;
+      }
+
+      add_polygon(clip_vertices, vertex_count, shade_face(shape, normal));
+    }
+  }
+}
+
+unsigned int SoftwareRenderer::shade_face(const ShapeSnapshot& shape, const float normal[3]) const {
+  float diffuse;
+  float specular;
+  float color[3];
+
+  diffuse = __dot_productV3(normal, m_light_direction);
+  specular = 0.0f;
+  if (diffuse > 0.0f) {
+    specular = __dot_productV3(normal, m_half_vector);
+    specular = specular > 0.0f ? powf(specular, shape.shininess) : 0.0f;
+  }
+  else {
+    diffuse = 0.0f;
+  }
+
+  for (int i = 0; i < 3; i++) {
+    color[i] =
+      shape.color[i]*(DEFAULT_AMBIENT_INTENSITY + diffuse*m_light_intensity[i])
+      + shape.reflectance[i]*specular*m_light_intensity[i];
+  }
+
+  return __pack_color(color[0], color[1], color[2], shape.color[3]);
+}
+
+void SoftwareRenderer::add_polygon(const float clip_vertices[][4], const int vertex_count, const unsigned int color) {
+  float polygon[2][MAX_CLIPPED_VERTICES][4];
+  int polygon_size[2];
+  int current = 0;
+
+  float distance_0;
+  float distance_1;
+  float fraction;
+
+  RasterTriangle triangle;
+  float window[MAX_CLIPPED_VERTICES][3];
+
+  for (int i = 0; i < vertex_count; i++) {
+    for (int j = 0; j < 4; j++) {
+      polygon[0][i][j] = clip_vertices[i][j];
+    }
+  }
+  polygon_size[0] = vertex_count;
+
+  // clip the polygon against each plane in turn
+  for (int plane = 0; plane < 5; plane++) {
+    const float* coefficients = CLIP_PLANES[plane];
+    const int next = 1 - current;
+    polygon_size[next] = 0;
+
+    for (int i = 0; i < polygon_size[current]; i++) {
+      const float* vertex_0 = polygon[current][i];
+      const float* vertex_1 = polygon[current][(i + 1) % polygon_size[current]];
+
+      distance_0 = coefficients[0]*vertex_0[0] + coefficients[1]*vertex_0[1] + coefficients[2]*vertex_0[2] + coefficients[3]*vertex_0[3];
+      distance_1 = coefficients[0]*vertex_1[0] + coefficients[1]*vertex_1[1] + coefficients[2]*vertex_1[2] + coefficients[3]*vertex_1[3];
+
+      if (distance_0 >= 0.0f) {
+        for (int j = 0; j < 4; j++) {
+          polygon[next][polygon_size[next]][j] = vertex_0[j];
+        }
+        polygon_size[next]++;
+      }
+
+      if ((distance_0 >= 0.0f) != (distance_1 >= 0.0f)) {
+        fraction = distance_0 / (distance_0 - distance_1);
+        for (int j = 0; j < 4; j++) {
+          polygon[next][polygon_size[next]][j] = vertex_0[j] + (vertex_1[j] - vertex_0[j])*fraction;
+        }
+        polygon_size[next]++;
+      }
+    }
+
+    current = next;
+    if (polygon_size[current] < 3) {
+      return;
+    }
+  }
+
+  // perspective divide and viewport transform
+  for (int i = 0; i < polygon_size[current]; i++) {
+    const float* vertex = polygon[current][i];
+
+    window[i][0] = (vertex[0] / vertex[3] + 1.0f)*0.5f*m_width;
+    window[i][1] = (1.0f - vertex[1] / vertex[3])*0.5f*m_height;
+    window[i][2] = (vertex[2] / vertex[3] + 1.0f)*0.5f;
+  }
+
+  // fan triangulate the clipped polygon
+  triangle.color = color;
+
+  for (int i = 1; i + 1 < polygon_size[current]; i++) {
+    const int corners[3] = { 0, i, i + 1 };
+    float min_x = (float)m_width;
+    float min_y = (float)m_height;
+    float max_x = 0.0f;
+    float max_y = 0.0f;
+
+    for (int j = 0; j < 3; j++) {
+      triangle.x[j] = window[corners[j]][0];
+      triangle.y[j] = window[corners[j]][1];
+      triangle.z[j] = window[corners[j]][2];
+
+      min_x = fminf(min_x, triangle.x[j]);
+      min_y = fminf(min_y, triangle.y[j]);
+      max_x = fmaxf(max_x, triangle.x[j]);
+      max_y = fmaxf(max_y, triangle.y[j]);
+    }
+
+    // bounds of the pixel centers that can be covered
+    triangle.min_x = (int)fmaxf(ceilf(min_x - 0.5f), 0.0f);
+    triangle.min_y = (int)fmaxf(ceilf(min_y - 0.5f), 0.0f);
+    triangle.max_x = (int)fminf(floorf(max_x - 0.5f), (float)(m_width - 1));
+    triangle.max_y = (int)fminf(floorf(max_y - 0.5f), (float)(m_height - 1));
+
+    if (triangle.min_x > triangle.max_x || triangle.min_y > triangle.max_y) {
+      continue;
+    }
+
+    m_triangles.push_back(triangle);
+  }
+}
+
+void SoftwareRenderer::rasterize_tile(const int tile_index) {
+  const int tile_min_x = (tile_index % m_tiles_x)*m_tile_size;
+  const int tile_min_y = (tile_index / m_tiles_x)*m_tile_size;
+  const int tile_max_x = tile_min_x + m_tile_size - 1 < m_width - 1 ? tile_min_x + m_tile_size - 1 : m_width - 1;
+  const int tile_max_y = tile_min_y + m_tile_size - 1 < m_height - 1 ? tile_min_y + m_tile_size - 1 : m_height - 1;
+
+  const vector<int>& bin = m_tile_bins[tile_index];
+
+  // clear the tile
+  for (int y = tile_min_y; y <= tile_max_y; y++) {
+    for (int x = tile_min_x; x <= tile_max_x; x++) {
+      m_color_buffer[y*m_width + x] = m_clear_color;
+      m_depth_buffer[y*m_width + x] = 1.0f;
+    }
+  }
+
+  for (size_t i = 0; i < bin.size(); i++) {
+    const RasterTriangle& triangle = m_triangles[bin[i]];
+
+    const int min_x = triangle.min_x > tile_min_x ? triangle.min_x : tile_min_x;
+    const int min_y = triangle.min_y > tile_min_y ? triangle.min_y : tile_min_y;
+    const int max_x = triangle.max_x < tile_max_x ? triangle.max_x : tile_max_x;
+    const int max_y = triangle.max_y < tile_max_y ? triangle.max_y : tile_max_y;
+
+    // edge function coefficients so that edge_i(x, y) = a_i*x + b_i*y + c_i
+    float a[3];
+    float b[3];
+    float c[3];
+    float area;
+
+    for (int j = 0; j < 3; j++) {
+      const int k = (j + 1) % 3;
+      const int l = (j + 2) % 3;
+      a[j] = triangle.y[k] - triangle.y[l];
+      b[j] = triangle.x[l] - triangle.x[k];
+      c[j] = triangle.x[k]*triangle.y[l] - triangle.x[l]*triangle.y[k];
+    }
+
+    area = a[0]*triangle.x[0] + b[0]*triangle.y[0] + c[0];
+    if (area == 0.0f) {
+      continue;
+    }
+
+    // orient the edges so that covered pixels are non-negative for either winding
+    if (area < 0.0f) {
+      for (int j = 0; j < 3; j++) {
+        a[j] = -a[j];
+        b[j] = -b[j];
+        c[j] = -c[j];
+      }
+      area = -area;
+    }
+
+    // interpolate depth linearly in window space
+    const float depth_a = (a[0]*triangle.z[0] + a[1]*triangle.z[1] + a[2]*triangle.z[2]) / area;
+    const float depth_b = (b[0]*triangle.z[0] + b[1]*triangle.z[1] + b[2]*triangle.z[2]) / area;
+    const float depth_c = (c[0]*triangle.z[0] + c[1]*triangle.z[1] + c[2]*triangle.z[2]) / area;
+
+    for (int y = min_y; y <= max_y; y++) {
+      const float center_y = y + 0.5f;
+      float center_x = min_x + 0.5f;
+
+      float edge_0 = a[0]*center_x + b[0]*center_y + c[0];
+      float edge_1 = a[1]*center_x + b[1]*center_y + c[1];
+      float edge_2 = a[2]*center_x + b[2]*center_y + c[2];
+      float depth = depth_a*center_x + depth_b*center_y + depth_c;
+
+      unsigned int* color_row = &m_color_buffer[y*m_width];
+      float* depth_row = &m_depth_buffer[y*m_width];
+
+      for (int x = min_x; x <= max_x; x++) {
+        if (edge_0 >= 0.0f && edge_1 >= 0.0f && edge_2 >= 0.0f
+          && depth >= 0.0f && depth < depth_row[x]
+          )
+        {
+          depth_row[x] = depth;
+          color_row[x] = triangle.color;
+        }
+
+        edge_0 += a[0];
+        edge_1 += a[1];
+        edge_2 += a[2];
+        depth += depth_a;
+      }
+    }
+  }
+}
\ No newline at end of file
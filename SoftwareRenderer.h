@@ -0,0 +1,114 @@
+#ifndef SOFTWARE_RENDERER_H
+#define SOFTWARE_RENDERER_H
+
+#include <vector>
+
+#include "Shape.h"
+#include "Camera.h"
+#include "WorkerPool.h"
+#include "WorldSnapshot.h"
+
+#define DEFAULT_TILE_SIZE 64
+
+#define DEFAULT_FIELD_OF_VIEW_Y 30.0f
+#define DEFAULT_NEAR_DISTANCE 0.1f
+#define DEFAULT_FAR_DISTANCE 400.0f
+
+// global ambient light applied to every material, as in the fixed-function pipeline
+#define DEFAULT_AMBIENT_INTENSITY 0.2f
+
+// renders shapes on the CPU into color and depth buffers, splitting the image into tiles that are filled in parallel
+class SoftwareRenderer {
+public:
+  SoftwareRenderer(const int width, const int height);
+
+  const int& c_width = m_width;
+  const int& c_height = m_height;
+
+  // RGBA8 pixels, one unsigned int per pixel with red in the lowest byte, stored top row first
+  const std::vector<unsigned int>& c_color_buffer = m_color_buffer;
+
+  // window-space depth in [0, 1], stored top row first
+  const std::vector<float>& c_depth_buffer = m_depth_buffer;
+
+  const int& c_triangle_count = m_triangle_count;
+
+  void resize(const int width, const int height);
+  void set_tile_size(const int tile_size);
+
+  void set_perspective(const float field_of_view_y, const float near_distance, const float far_distance);
+
+  void set_clear_color(const float color[4]);
+  void set_light(const float position[4], const float intensity[4]);
+
+  void render(const std::vector<Shape*>& shapes, const Camera& camera, WorkerPool& pool);
+
+  // renders the shapes of view from snapshot as copied, so that the simulation can move the shapes meanwhile
+  void render(const WorldSnapshot& snapshot, const ViewSnapshot& view, WorkerPool& pool);
+
+  bool write_ppm(const char* path) const;
+
+private:
+  struct RasterTriangle {
+    float x[3];
+    float y[3];
+    float z[3];
+
+    unsigned int color;
+
+    // pixel bounds, inclusive
+    int min_x;
+    int min_y;
+    int max_x;
+    int max_y;
+  };
+
+  int m_width;
+  int m_height;
+
+  int m_tile_size;
+  int m_tiles_x;
+  int m_tiles_y;
+
+  float m_field_of_view_y;
+  float m_near_distance;
+  float m_far_distance;
+
+  unsigned int m_clear_color;
+
+  // normalized direction towards the light and its color
+  float m_light_direction[3];
+  float m_light_intensity[4];
+
+  std::vector<unsigned int> m_color_buffer;
+  std::vector<float> m_depth_buffer;
+
+  std::vector<RasterTriangle> m_triangles;
+  std::vector<std::vector<int>> m_tile_bins;
+  int m_triangle_count;
+
+  // the camera of the frame being set up
+  float m_view_projection[16];
+  float m_eye[3];
+  float m_half_vector[3];
+
+  // sets up the camera and empties the triangles and tiles of the last frame
+  void frame_begin(const float eye[3], const float target[3], const float vector_up[3]);
+
+  // bins the triangles set up since frame_begin and fills the tiles over the workers of pool
+  void frame_finish(WorkerPool& pool);
+
+  void setup_shape(const ShapeSnapshot& shape);
+  void setup_mesh(const ShapeSnapshot& shape);
+
+  // sweeps the outline of a sphere, capsule or cylinder around its up axis in ROUND_SHAPE_SLICES flat faces
+  void setup_round(const ShapeSnapshot& shape);
+
+  // shades a face of shape with the world normal once, as flat fixed-function lighting would
+  unsigned int shade_face(const ShapeSnapshot& shape, const float normal[3]) const;
+  void add_polygon(const float clip_vertices[][4], const int vertex_count, const unsigned int color);
+
+  void rasterize_tile(const int tile_index);
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,601 @@
+#include "SpatialIndex.h"
+
+#include <cmath>
+#include <algorithm>
+#include <atomic>
+using namespace std;
+
+#include "vector3.h"
+#include "Frustum.h"
+
+// keeps shapes that touch a cell boundary binned on both sides of it
+#define BOUNDS_EPSILON 1e-4f
+
+#define DISTANCE_INFINITE 1e30f
+
+// stores the reciprocal of each direction element, using a large finite value for zero elements
+#define __direction_inverse_store(direction, vec_store) \
+  vec_store[0] = direction[0] == 0.0f ? DISTANCE_INFINITE : 1.0f / direction[0]; \
+  vec_store[1] = direction[1] == 0.0f ? DISTANCE_INFINITE : 1.0f / direction[1]; \
+  vec_store[2] = direction[2] == 0.0f ? DISTANCE_INFINITE : 1.0f / direction[2];
+
+SpatialIndex::SpatialIndex(const float cell_size) {
+  m_cell_size = cell_size;
+  m_cell_size_inverse = 1.0f / cell_size;
+
+  m_grid_min_x = 0.0f;
+  m_grid_min_z = 0.0f;
+  m_cells_x = 0;
+  m_cells_z = 0;
+
+  m_shape_count = 0;
+}
+
+void SpatialIndex::build(const vector<Shape*>& shapes, const float padding) {
+  float min[3];
+  float max[3];
+
+  float grid_min[3] = { 0.0f, 0.0f, 0.0f };
+  float grid_max[3] = { 0.0f, 0.0f, 0.0f };
+
+  m_shapes.assign(shapes.begin(), shapes.end());
+  m_shape_indices.clear();
+  m_shape_count = (int)m_shapes.size();
+
+  m_bounds.resize(m_shapes.size()*6);
+  m_cell_ranges.assign(m_shapes.size()*4, -1);
+  m_oversized.clear();
+
+  // find the XZ extent of every shape
+  for (int i = 0; i < m_shape_count; i++) {
+    m_shape_indices[m_shapes[i]] = i;
+
+    m_shapes[i]->aabb_store(min, max);
+
+    if (i == 0) {
+      __vector_element_assign_opV3(grid_min, =, min);
+      __vector_element_assign_opV3(grid_max, =, max);
+    }
+    else {
+      for (int j = 0; j < 3; j++) {
+        grid_min[j] = fminf(grid_min[j], min[j]);
+        grid_max[j] = fmaxf(grid_max[j], max[j]);
+      }
+    }
+  }
+
+  // pad the grid so that shapes can move a little before they fall outside of it
+  m_grid_min_x = grid_min[DIM_X] - padding;
+  m_grid_min_z = grid_min[DIM_Z] - padding;
+  m_cells_x = (int)ceilf((grid_max[DIM_X] + padding - m_grid_min_x)*m_cell_size_inverse);
+  m_cells_z = (int)ceilf((grid_max[DIM_Z] + padding - m_grid_min_z)*m_cell_size_inverse);
+
+  if (m_cells_x < 1) {
+    m_cells_x = 1;
+  }
+  if (m_cells_z < 1) {
+    m_cells_z = 1;
+  }
+
+  m_cells.assign(m_cells_x*m_cells_z, vector<int>());
+
+  for (int i = 0; i < m_shape_count; i++) {
+    insert_shape(i);
+  }
+}
+
+void SpatialIndex::update_shape(const Shape* shape) {
+  const int shape_index = this->shape_index(shape);
+
+  if (shape_index == NULL_SHAPE_INDEX) {
+    return;
+  }
+
+  remove_shape(shape_index);
+  insert_shape(shape_index);
+}
+
+int SpatialIndex::shape_index(const Shape* shape) const {
+  unordered_map<const Shape*, int>::const_iterator found = m_shape_indices.find(shape);
+
+  return found != m_shape_indices.end() ? found->second : NULL_SHAPE_INDEX;
+}
+
+void SpatialIndex::query_aabb(const float min[3], const float max[3], vector<const Shape*>& shapes_store) const {
+  auto is_accepted = [&](const float* bounds) {
+    return bounds[0] <= max[0] && min[0] <= bounds[3]
+      && bounds[1] <= max[1] && min[1] <= bounds[4]
+      && bounds[2] <= max[2] && min[2] <= bounds[5];
+  };
+
+  query(min, max, is_accepted, shapes_store);
+}
+
+int SpatialIndex::query_frustum(const Frustum& frustum, vector<const Shape*>& shapes_store) const {
+  float min[3];
+  float max[3];
+
+  auto is_accepted = [&](const float* bounds) {
+    return frustum.is_aabb_visible(bounds, bounds + 3);
+  };
+
+  // only the cells under the bounds of the frustum can hold visible shapes
+  frustum.aabb_store(min, max);
+  query(min, max, is_accepted, shapes_store);
+
+  return m_shape_count - (int)shapes_store.size();
+}
+
+bool SpatialIndex::ray_cast_first(const float origin[3], const float direction[3], const float max_distance, RayHit& hit, const Shape* ignored) const {
+  float direction_inverse[3];
+  RayHit candidate;
+
+  __direction_inverse_store(direction, direction_inverse);
+
+  hit.shape = NULL_SHAPE_PTR;
+  hit.distance = max_distance;
+
+  for (size_t i = 0; i < m_oversized.size(); i++) {
+    if (m_shapes[m_oversized[i]] != ignored
+      && ray_cast_shape(m_oversized[i], origin, direction, direction_inverse, 0.0f, hit.distance, candidate)
+      )
+    {
+      hit = candidate;
+    }
+  }
+
+  // a shape is binned in every cell its bounds touch, so each cell only needs to search its own stretch of the ray,
+  // and the closest hit is final once the cell it lies in has been searched
+  auto visitor = [&](const vector<int>& cell, const float distance_enter, const float distance_exit) -> bool {
+    for (size_t i = 0; i < cell.size(); i++) {
+      if (m_shapes[cell[i]] != ignored
+        && ray_cast_shape(cell[i], origin, direction, direction_inverse, distance_enter, fminf(hit.distance, distance_exit), candidate)
+        )
+      {
+        hit = candidate;
+      }
+    }
+    return hit.shape != NULL_SHAPE_PTR && hit.distance <= distance_exit;
+  };
+
+  traverse(origin, direction, hit.distance, visitor);
+
+  if (hit.shape == NULL_SHAPE_PTR) {
+    return false;
+  }
+
+  __vector_element_op_and_scalar_opV3(origin, +, direction, *, hit.distance, hit.point);
+  return true;
+}
+
+bool SpatialIndex::ray_cast_any(const float origin[3], const float direction[3], const float max_distance, const Shape* ignored) const {
+  float direction_inverse[3];
+  RayHit candidate;
+  bool is_hit = false;
+
+  __direction_inverse_store(direction, direction_inverse);
+
+  for (size_t i = 0; i < m_oversized.size(); i++) {
+    if (m_shapes[m_oversized[i]] != ignored
+      && ray_cast_shape(m_oversized[i], origin, direction, direction_inverse, 0.0f, max_distance, candidate)
+      )
+    {
+      return true;
+    }
+  }
+
+  // a hit past this cell is found again from the cell it lies in
+  auto visitor = [&](const vector<int>& cell, const float distance_enter, const float distance_exit) -> bool {
+    for (size_t i = 0; i < cell.size(); i++) {
+      if (m_shapes[cell[i]] != ignored
+        && ray_cast_shape(cell[i], origin, direction, direction_inverse, distance_enter, distance_exit, candidate)
+        )
+      {
+        is_hit = true;
+        return true;
+      }
+    }
+    return false;
+  };
+
+  traverse(origin, direction, max_distance, visitor);
+
+  return is_hit;
+}
+
+int SpatialIndex::ray_cast_all(const float origin[3], const float direction[3], const float max_distance, vector<RayHit>& hits_store, const Shape* ignored) const {
+  float direction_inverse[3];
+  RayHit candidate;
+
+  __direction_inverse_store(direction, direction_inverse);
+
+  hits_store.clear();
+
+  for (size_t i = 0; i < m_oversized.size(); i++) {
+    if (m_shapes[m_oversized[i]] != ignored
+      && ray_cast_shape(m_oversized[i], origin, direction, direction_inverse, 0.0f, max_distance, candidate)
+      )
+    {
+      hits_store.push_back(candidate);
+    }
+  }
+
+  // a shape binned in several cells is reported only from the cell holding its entry point
+  auto visitor = [&](const vector<int>& cell, const float distance_enter, const float distance_exit) -> bool {
+    for (size_t i = 0; i < cell.size(); i++) {
+      if (m_shapes[cell[i]] != ignored
+        && ray_cast_shape(cell[i], origin, direction, direction_inverse, distance_enter, max_distance, candidate)
+        && candidate.distance >= distance_enter
+        && (candidate.distance < distance_exit || distance_exit >= max_distance)
+        )
+      {
+        hits_store.push_back(candidate);
+      }
+    }
+    return false;
+  };
+
+  traverse(origin, direction, max_distance, visitor);
+
+  sort(hits_store.begin(), hits_store.end(), [](const RayHit& hit0, const RayHit& hit1) {
+    return hit0.distance < hit1.distance;
+  });
+
+  for (size_t i = 0; i < hits_store.size(); i++) {
+    __vector_element_op_and_scalar_opV3(origin, +, direction, *, hits_store[i].distance, hits_store[i].point);
+  }
+
+  return (int)hits_store.size();
+}
+
+bool SpatialIndex::segment_cast_first(const float start[3], const float end[3], RayHit& hit, const Shape* ignored) const {
+  float direction[3];
+  float length;
+
+  __vector_element_opV3(end, -, start, direction);
+  length = __magnitudeV3(direction);
+
+  if (length == 0.0f) {
+    return false;
+  }
+
+  __vector_scalar_opV3(direction, /, length, direction);
+  return ray_cast_first(start, direction, length, hit, ignored);
+}
+
+bool SpatialIndex::segment_cast_any(const float start[3], const float end[3], const Shape* ignored) const {
+  float direction[3];
+  float length;
+
+  __vector_element_opV3(end, -, start, direction);
+  length = __magnitudeV3(direction);
+
+  if (length == 0.0f) {
+    return false;
+  }
+
+  __vector_scalar_opV3(direction, /, length, direction);
+  return ray_cast_any(start, direction, length, ignored);
+}
+
+void SpatialIndex::label_points(const float* points, const int point_count, int* labels_store) const {
+  vector<int> cell_starts(m_cells.size() + 1, 0);
+  vector<int> point_cells(point_count);
+  vector<int> cell_order(point_count);
+  vector<float> cell_points;
+  vector<unsigned char> inside(point_count);
+
+  int shape_index;
+  int cell;
+  int begin;
+  int count;
+
+  if (point_count <= 0) {
+    return;
+  }
+
+  for (int i = 0; i < point_count; i++) {
+    labels_store[i] = NULL_SHAPE_INDEX;
+  }
+
+  // oversized shapes can contain any point, so classify the whole batch against them
+  for (size_t i = 0; i < m_oversized.size(); i++) {
+    shape_index = m_oversized[i];
+    m_shapes[shape_index]->classify_points(points, point_count, &inside[0]);
+
+    for (int j = 0; j < point_count; j++) {
+      if (inside[j] && (labels_store[j] == NULL_SHAPE_INDEX || shape_index < labels_store[j])) {
+        labels_store[j] = shape_index;
+      }
+    }
+  }
+
+  if (m_cells.empty()) {
+    return;
+  }
+
+  // sort the points by cell with a counting sort
+  for (int i = 0; i < point_count; i++) {
+    cell = cell_coordinate_z(points[i*3 + 2])*m_cells_x + cell_coordinate_x(points[i*3]);
+    point_cells[i] = cell;
+    cell_starts[cell + 1]++;
+  }
+
+  for (size_t i = 1; i < cell_starts.size(); i++) {
+    cell_starts[i] += cell_starts[i - 1];
+  }
+
+  {
+    vector<int> cell_fill(cell_starts.begin(), cell_starts.end() - 1);
+    for (int i = 0; i < point_count; i++) {
+      cell_order[cell_fill[point_cells[i]]++] = i;
+    }
+  }
+
+  // classify the points of each cell against the shapes binned in it
+  for (size_t c = 0; c < m_cells.size(); c++) {
+    begin = cell_starts[c];
+    count = cell_starts[c + 1] - begin;
+
+    if (count == 0 || m_cells[c].empty()) {
+      continue;
+    }
+
+    cell_points.resize(count*3);
+    for (int i = 0; i < count; i++) {
+      __vector_element_assign_opV3((&cell_points[i*3]), =, (points + cell_order[begin + i]*3));
+    }
+
+    for (size_t s = 0; s < m_cells[c].size(); s++) {
+      shape_index = m_cells[c][s];
+      m_shapes[shape_index]->classify_points(&cell_points[0], count, &inside[0]);
+
+      for (int i = 0; i < count; i++) {
+        int* label = &labels_store[cell_order[begin + i]];
+        if (inside[i] && (*label == NULL_SHAPE_INDEX || shape_index < *label)) {
+          *label = shape_index;
+        }
+      }
+    }
+  }
+}
+
+int SpatialIndex::ray_cast_batch(const float* origins, const float* directions, const int ray_count, const float max_distance, RayHit* hits_store, WorkerPool& pool, const Shape* ignored) const {
+  atomic<int> hit_count(0);
+
+  // every query only reads the index, so the rays can be cast from any thread
+  pool.parallel_for(ray_count, RAYS_PER_TASK, [&](const int begin, const int end) {
+    int chunk_hit_count = 0;
+
+    for (int i = begin; i < end; i++) {
+      if (ray_cast_first(origins + i*3, directions + i*3, max_distance, hits_store[i], ignored)) {
+        chunk_hit_count++;
+      }
+    }
+
+    hit_count += chunk_hit_count;
+  });
+
+  return hit_count;
+}
+
+void SpatialIndex::insert_shape(const int shape_index) {
+  float* bounds = &m_bounds[shape_index*6];
+  int* range = &m_cell_ranges[shape_index*4];
+
+  m_shapes[shape_index]->aabb_store(bounds, bounds + 3);
+
+  range[0] = (int)floorf((bounds[0] - BOUNDS_EPSILON - m_grid_min_x)*m_cell_size_inverse);
+  range[1] = (int)floorf((bounds[2] - BOUNDS_EPSILON - m_grid_min_z)*m_cell_size_inverse);
+  range[2] = (int)floorf((bounds[3] + BOUNDS_EPSILON - m_grid_min_x)*m_cell_size_inverse);
+  range[3] = (int)floorf((bounds[5] + BOUNDS_EPSILON - m_grid_min_z)*m_cell_size_inverse);
+
+  // shapes that are very large or that left the grid are kept out of the cells
+  if (range[0] < 0 || range[1] < 0 || range[2] >= m_cells_x || range[3] >= m_cells_z
+    || range[2] - range[0] >= OVERSIZED_CELL_SPAN
+    || range[3] - range[1] >= OVERSIZED_CELL_SPAN
+    )
+  {
+    range[0] = range[1] = range[2] = range[3] = -1;
+    m_oversized.push_back(shape_index);
+    return;
+  }
+
+  for (int z = range[1]; z <= range[3]; z++) {
+    for (int x = range[0]; x <= range[2]; x++) {
+      m_cells[z*m_cells_x + x].push_back(shape_index);
+    }
+  }
+}
+
+void SpatialIndex::remove_shape(const int shape_index) {
+  int* range = &m_cell_ranges[shape_index*4];
+
+  if (range[0] < 0) {
+    m_oversized.erase(remove(m_oversized.begin(), m_oversized.end(), shape_index), m_oversized.end());
+    return;
+  }
+
+  for (int z = range[1]; z <= range[3]; z++) {
+    for (int x = range[0]; x <= range[2]; x++) {
+      vector<int>& cell = m_cells[z*m_cells_x + x];
+      cell.erase(remove(cell.begin(), cell.end(), shape_index), cell.end());
+    }
+  }
+}
+
+int SpatialIndex::cell_coordinate_x(const float x) const {
+  int cell = (int)floorf((x - m_grid_min_x)*m_cell_size_inverse);
+  return cell < 0 ? 0 : (cell >= m_cells_x ? m_cells_x - 1 : cell);
+}
+
+int SpatialIndex::cell_coordinate_z(const float z) const {
+  int cell = (int)floorf((z - m_grid_min_z)*m_cell_size_inverse);
+  return cell < 0 ? 0 : (cell >= m_cells_z ? m_cells_z - 1 : cell);
+}
+
+bool SpatialIndex::ray_cast_shape(const int shape_index, const float origin[3], const float direction[3], const float direction_inverse[3], const float min_distance, const float max_distance, RayHit& hit) const {
+  const float* bounds = &m_bounds[shape_index*6];
+
+  float distance_near = min_distance;
+  float distance_far = max_distance;
+  float distance_0;
+  float distance_1;
+
+  // reject against the cached bounds before touching the shape itself
+  for (int i = 0; i < 3; i++) {
+    distance_0 = (bounds[i] - origin[i])*direction_inverse[i];
+    distance_1 = (bounds[i + 3] - origin[i])*direction_inverse[i];
+
+    distance_near = fmaxf(distance_near, fminf(distance_0, distance_1));
+    distance_far = fminf(distance_far, fmaxf(distance_0, distance_1));
+  }
+
+  if (distance_near > distance_far) {
+    return false;
+  }
+
+  if (!m_shapes[shape_index]->ray_cast(origin, direction, max_distance, hit.distance, hit.normal)) {
+    return false;
+  }
+
+  hit.shape = m_shapes[shape_index];
+  return true;
+}
+
+template<typename Visitor>
+void SpatialIndex::traverse(const float origin[3], const float direction[3], const float max_distance, Visitor& visitor) const {
+  const float grid_max_x = m_grid_min_x + m_cells_x*m_cell_size;
+  const float grid_max_z = m_grid_min_z + m_cells_z*m_cell_size;
+
+  float distance_enter = 0.0f;
+  float distance_end = max_distance;
+  float distance_0;
+  float distance_1;
+
+  if (m_cells.empty()) {
+    return;
+  }
+
+  // clip the ray to the XZ extent of the grid
+  if (direction[DIM_X] == 0.0f) {
+    if (origin[DIM_X] < m_grid_min_x || origin[DIM_X] > grid_max_x) {
+      return;
+    }
+  }
+  else {
+    distance_0 = (m_grid_min_x - origin[DIM_X]) / direction[DIM_X];
+    distance_1 = (grid_max_x - origin[DIM_X]) / direction[DIM_X];
+    distance_enter = fmaxf(distance_enter, fminf(distance_0, distance_1));
+    distance_end = fminf(distance_end, fmaxf(distance_0, distance_1));
+  }
+
+  if (direction[DIM_Z] == 0.0f) {
+    if (origin[DIM_Z] < m_grid_min_z || origin[DIM_Z] > grid_max_z) {
+      return;
+    }
+  }
+  else {
+    distance_0 = (m_grid_min_z - origin[DIM_Z]) / direction[DIM_Z];
+    distance_1 = (grid_max_z - origin[DIM_Z]) / direction[DIM_Z];
+    distance_enter = fmaxf(distance_enter, fminf(distance_0, distance_1));
+    distance_end = fminf(distance_end, fmaxf(distance_0, distance_1));
+  }
+
+  if (distance_enter > distance_end) {
+    return;
+  }
+
+  // find the first cell and set up the stepping along each axis
+  int cell_x = cell_coordinate_x(origin[DIM_X] + direction[DIM_X]*distance_enter);
+  int cell_z = cell_coordinate_z(origin[DIM_Z] + direction[DIM_Z]*distance_enter);
+
+  int step_x = direction[DIM_X] > 0.0f ? 1 : -1;
+  int step_z = direction[DIM_Z] > 0.0f ? 1 : -1;
+
+  float distance_delta_x = direction[DIM_X] == 0.0f ? DISTANCE_INFINITE : fabsf(m_cell_size / direction[DIM_X]);
+  float distance_delta_z = direction[DIM_Z] == 0.0f ? DISTANCE_INFINITE : fabsf(m_cell_size / direction[DIM_Z]);
+
+  float distance_next_x = direction[DIM_X] == 0.0f ? DISTANCE_INFINITE
+    : (m_grid_min_x + (cell_x + (step_x > 0 ? 1 : 0))*m_cell_size - origin[DIM_X]) / direction[DIM_X];
+  float distance_next_z = direction[DIM_Z] == 0.0f ? DISTANCE_INFINITE
+    : (m_grid_min_z + (cell_z + (step_z > 0 ? 1 : 0))*m_cell_size - origin[DIM_Z]) / direction[DIM_Z];
+
+  float distance_exit;
+
+  // the first cell also owns anything in front of the grid
+  distance_enter = 0.0f;
+
+  while (true) {
+    distance_exit = fminf(fminf(distance_next_x, distance_next_z), distance_end);
+    if (distance_exit >= distance_end) {
+      distance_exit = max_distance;
+    }
+
+    if (visitor(m_cells[cell_z*m_cells_x + cell_x], distance_enter, distance_exit)) {
+      return;
+    }
+
+    if (distance_exit >= max_distance) {
+      return;
+    }
+
+    distance_enter = distance_exit;
+
+    if (distance_next_x < distance_next_z) {
+      cell_x += step_x;
+      distance_next_x += distance_delta_x;
+    }
+    else {
+      cell_z += step_z;
+      distance_next_z += distance_delta_z;
+    }
+
+    if (cell_x < 0 || cell_x >= m_cells_x || cell_z < 0 || cell_z >= m_cells_z) {
+      return;
+    }
+  }
+}
+
+template<typename BoundsTest>
+void SpatialIndex::query(const float min[3], const float max[3], BoundsTest& is_accepted, vector<const Shape*>& shapes_store) const {
+  const float* bounds;
+  const int* range;
+
+  shapes_store.clear();
+
+  for (size_t i = 0; i < m_oversized.size(); i++) {
+    bounds = &m_bounds[m_oversized[i]*6];
+    if (is_accepted(bounds)) {
+      shapes_store.push_back(m_shapes[m_oversized[i]]);
+    }
+  }
+
+  int cell_min_x = cell_coordinate_x(min[DIM_X]);
+  int cell_min_z = cell_coordinate_z(min[DIM_Z]);
+  int cell_max_x = cell_coordinate_x(max[DIM_X]);
+  int cell_max_z = cell_coordinate_z(max[DIM_Z]);
+
+  for (int z = cell_min_z; z <= cell_max_z; z++) {
+    for (int x = cell_min_x; x <= cell_max_x; x++) {
+      const vector<int>& cell = m_cells[z*m_cells_x + x];
+
+      for (size_t i = 0; i < cell.size(); i++) {
+        range = &m_cell_ranges[cell[i]*4];
+
+        // report each shape only from the first cell it shares with the query
+        if (x != (range[0] > cell_min_x ? range[0] : cell_min_x)
+          || z != (range[1] > cell_min_z ? range[1] : cell_min_z)
+          )
+        {
+          continue;
+        }
+
+        bounds = &m_bounds[cell[i]*6];
+        if (is_accepted(bounds)) {
+          shapes_store.push_back(m_shapes[cell[i]]);
+        }
+      }
+    }
+  }
+}
\ No newline at end of file
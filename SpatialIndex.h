@@ -0,0 +1,109 @@
+#ifndef SPATIAL_INDEX_H
+#define SPATIAL_INDEX_H
+
+#include <vector>
+#include <unordered_map>
+
+#include "Shape.h"
+#include "WorkerPool.h"
+
+#define DEFAULT_CELL_SIZE 10.0f
+#define DEFAULT_INDEX_PADDING 50.0f
+
+// shapes spanning more cells than this along an axis are tested by every query instead of being binned
+#define OVERSIZED_CELL_SPAN 8
+
+// number of rays handed to a worker at a time by ray_cast_batch
+#define RAYS_PER_TASK 256
+
+#define NULL_SHAPE_INDEX (-1)
+
+class Frustum;
+
+struct RayHit {
+  const Shape* shape;
+  float distance;
+  float point[3];
+  float normal[3];
+};
+
+// uniform grid over the XZ-plane that bins shapes by their world-space bounds
+class SpatialIndex {
+public:
+  SpatialIndex(const float cell_size = DEFAULT_CELL_SIZE);
+
+  const int& c_shape_count = m_shape_count;
+  const std::vector<const Shape*>& c_shapes = m_shapes;
+  const float& c_cell_size = m_cell_size;
+
+  void build(const std::vector<Shape*>& shapes, const float padding = DEFAULT_INDEX_PADDING);
+  void update_shape(const Shape* shape);
+
+  // yields the index of shape in c_shapes, or NULL_SHAPE_INDEX when it is not indexed
+  int shape_index(const Shape* shape) const;
+
+  void query_aabb(const float min[3], const float max[3], std::vector<const Shape*>& shapes_store) const;
+
+  // stores the shapes whose bounds may be inside frustum, along with the number of shapes left out
+  int query_frustum(const Frustum& frustum, std::vector<const Shape*>& shapes_store) const;
+
+  bool ray_cast_first(const float origin[3], const float direction[3], const float max_distance, RayHit& hit, const Shape* ignored = NULL_SHAPE_PTR) const;
+  bool ray_cast_any(const float origin[3], const float direction[3], const float max_distance, const Shape* ignored = NULL_SHAPE_PTR) const;
+  int ray_cast_all(const float origin[3], const float direction[3], const float max_distance, std::vector<RayHit>& hits_store, const Shape* ignored = NULL_SHAPE_PTR) const;
+
+  bool segment_cast_first(const float start[3], const float end[3], RayHit& hit, const Shape* ignored = NULL_SHAPE_PTR) const;
+  bool segment_cast_any(const float start[3], const float end[3], const Shape* ignored = NULL_SHAPE_PTR) const;
+
+  // stores in labels_store the index in c_shapes of the first shape containing each point, or NULL_SHAPE_INDEX
+  void label_points(const float* points, const int point_count, int* labels_store) const;
+
+  // casts ray_count rays, stored as consecutive x, y, z elements, for their first hits, splitting them over the workers
+  // of pool; misses are stored as a null shape at max_distance, and the number of hits is returned
+  int ray_cast_batch(const float* origins, const float* directions, const int ray_count, const float max_distance, RayHit* hits_store, WorkerPool& pool, const Shape* ignored = NULL_SHAPE_PTR) const;
+
+private:
+  float m_cell_size;
+  float m_cell_size_inverse;
+
+  // minimum corner of the grid and its size in cells
+  float m_grid_min_x;
+  float m_grid_min_z;
+  int m_cells_x;
+  int m_cells_z;
+
+  int m_shape_count;
+
+  std::vector<const Shape*> m_shapes;
+  std::unordered_map<const Shape*, int> m_shape_indices;
+
+  // world-space bounds of each shape, stored as min x, y, z then max x, y, z
+  std::vector<float> m_bounds;
+
+  // cell range of each shape, stored as min x, z then max x, z (all -1 when oversized)
+  std::vector<int> m_cell_ranges;
+
+  std::vector<std::vector<int>> m_cells;
+  std::vector<int> m_oversized;
+
+  void insert_shape(const int shape_index);
+  void remove_shape(const int shape_index);
+
+  int cell_coordinate_x(const float x) const;
+  int cell_coordinate_z(const float z) const;
+
+  // rejects shape_index unless its cached bounds meet the ray between min_distance and max_distance, then casts against
+  // the shape itself up to max_distance
+  bool ray_cast_shape(const int shape_index, const float origin[3], const float direction[3], const float direction_inverse[3], const float min_distance, const float max_distance, RayHit& hit) const;
+
+  // replaces shapes_store with the shapes binned in the cells under min and max, oversized ones included, whose cached
+  // bounds pass is_accepted(bounds), each reported once
+  template<typename BoundsTest>
+  void query(const float min[3], const float max[3], BoundsTest& is_accepted, std::vector<const Shape*>& shapes_store) const;
+
+  // walks the grid cells pierced by the ray in order, calling visitor(cell_shapes, distance_enter, distance_exit)
+  // for each one until it returns true
+  template<typename Visitor>
+  void traverse(const float origin[3], const float direction[3], const float max_distance, Visitor& visitor) const;
+};
+
+#endif
\ No newline at end of file
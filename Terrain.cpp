@@ -0,0 +1,405 @@
+#include "Terrain.h"
+
+#include <gl/glut.h>
+#include <gl/gl.h>
+
+#include <cmath>
+#include <cstdio>
+using namespace std;
+
+#include "Object.h"
+#include "vector3.h"
+#include "colors.h"
+
+#define DISTANCE_INFINITE 1e30f
+
+// below this the quadratic term of a cell intersection is ignored
+#define QUADRATIC_EPSILON 1e-8f
+
+Terrain::Terrain() {
+  __vector_element_assign_opV3(m_origin, =, ZERO_VECTOR);
+
+  for (int i = 0; i < 4; i++) {
+    m_color[i] = COLOR_GRASS_GREEN[i];
+  }
+
+  m_is_chunk_list_dirty = true;
+
+  set_size(DEFAULT_TERRAIN_SAMPLES, DEFAULT_TERRAIN_SAMPLES, DEFAULT_TERRAIN_SPACING);
+}
+
+void Terrain::set_size(const int samples_x, const int samples_z, const float spacing) {
+  m_samples_x = samples_x > 2 ? samples_x : 2;
+  m_samples_z = samples_z > 2 ? samples_z : 2;
+  m_spacing = spacing;
+  m_spacing_inverse = 1.0f / spacing;
+
+  m_heights.assign(m_samples_x*m_samples_z, 0.0f);
+  m_is_chunk_list_dirty = true;
+}
+
+void Terrain::set_spacing(const float spacing) {
+  m_spacing = spacing;
+  m_spacing_inverse = 1.0f / spacing;
+  m_is_chunk_list_dirty = true;
+}
+
+void Terrain::set_origin(const float origin_x, const float origin_y, const float origin_z) {
+  m_origin[DIM_X] = origin_x;
+  m_origin[DIM_Y] = origin_y;
+  m_origin[DIM_Z] = origin_z;
+  m_is_chunk_list_dirty = true;
+}
+
+void Terrain::set_color(const float color[4]) {
+  for (int i = 0; i < 4; i++) {
+    m_color[i] = color[i];
+  }
+}
+
+void Terrain::set_height(const int sample_x, const int sample_z, const float height) {
+  m_heights[sample_z*m_samples_x + sample_x] = height;
+  m_is_chunk_list_dirty = true;
+}
+
+float Terrain::get_height(const int sample_x, const int sample_z) const {
+  return m_heights[sample_z*m_samples_x + sample_x];
+}
+
+bool Terrain::load_raw(const char* path, const float height_scale, const int samples_x, const int samples_z) {
+  FILE* file = fopen(path, "rb");
+  long length;
+  int size_x = samples_x;
+  int size_z = samples_z;
+  vector<unsigned char> data;
+
+  if (file == NULL) {
+    return false;
+  }
+
+  fseek(file, 0, SEEK_END);
+  length = ftell(file);
+  fseek(file, 0, SEEK_SET);
+
+  // infer a square grid from the number of samples
+  if (size_x <= 0 || size_z <= 0) {
+    size_x = (int)(sqrtf((float)(length / 2)) + 0.5f);
+    size_z = size_x;
+  }
+
+  if (size_x < 2 || size_z < 2 || length < (long)size_x*size_z*2) {
+    fclose(file);
+    return false;
+  }
+
+  data.resize(size_x*size_z*2);
+  if (fread(&data[0], 1, data.size(), file) != data.size()) {
+    fclose(file);
+    return false;
+  }
+  fclose(file);
+
+  set_size(size_x, size_z, m_spacing);
+
+  for (int i = 0; i < size_x*size_z; i++) {
+    m_heights[i] = (data[i*2] | (data[i*2 + 1] << 8)) / 65535.0f*height_scale;
+  }
+
+  return true;
+}
+
+bool Terrain::is_above(const float x, const float z) const {
+  return x >= m_origin[DIM_X] && x <= m_origin[DIM_X] + (m_samples_x - 1)*m_spacing
+    && z >= m_origin[DIM_Z] && z <= m_origin[DIM_Z] + (m_samples_z - 1)*m_spacing;
+}
+
+float Terrain::height_at(const float x, const float z) const {
+  int cell_x;
+  int cell_z;
+  float fraction_x;
+  float fraction_z;
+
+  cell_store(x, z, cell_x, cell_z, fraction_x, fraction_z);
+
+  const float* row_0 = &m_heights[cell_z*m_samples_x + cell_x];
+  const float* row_1 = row_0 + m_samples_x;
+
+  return m_origin[DIM_Y]
+    + (row_0[0]*(1.0f - fraction_x) + row_0[1]*fraction_x)*(1.0f - fraction_z)
+    + (row_1[0]*(1.0f - fraction_x) + row_1[1]*fraction_x)*fraction_z;
+}
+
+void Terrain::normal_at(const float x, const float z, float normal[3]) const {
+  int cell_x;
+  int cell_z;
+  float fraction_x;
+  float fraction_z;
+
+  cell_store(x, z, cell_x, cell_z, fraction_x, fraction_z);
+
+  const float* row_0 = &m_heights[cell_z*m_samples_x + cell_x];
+  const float* row_1 = row_0 + m_samples_x;
+
+  // gradient of the bilinear surface
+  float slope_x = ((row_0[1] - row_0[0])*(1.0f - fraction_z) + (row_1[1] - row_1[0])*fraction_z)*m_spacing_inverse;
+  float slope_z = ((row_1[0] - row_0[0])*(1.0f - fraction_x) + (row_1[1] - row_0[1])*fraction_x)*m_spacing_inverse;
+
+  normal[DIM_X] = -slope_x;
+  normal[DIM_Y] = 1.0f;
+  normal[DIM_Z] = -slope_z;
+  normalizeV3(normal);
+}
+
+bool Terrain::ray_cast(const float origin[3], const float direction[3], const float max_distance, float& distance, float normal[3]) const {
+  const float max_x = m_origin[DIM_X] + (m_samples_x - 1)*m_spacing;
+  const float max_z = m_origin[DIM_Z] + (m_samples_z - 1)*m_spacing;
+
+  float distance_enter = 0.0f;
+  float distance_end = max_distance;
+  float distance_0;
+  float distance_1;
+  float point[3];
+
+  // clip the ray to the XZ extent of the grid
+  if (direction[DIM_X] == 0.0f) {
+    if (origin[DIM_X] < m_origin[DIM_X] || origin[DIM_X] > max_x) {
+      return false;
+    }
+  }
+  else {
+    distance_0 = (m_origin[DIM_X] - origin[DIM_X]) / direction[DIM_X];
+    distance_1 = (max_x - origin[DIM_X]) / direction[DIM_X];
+    distance_enter = fmaxf(distance_enter, fminf(distance_0, distance_1));
+    distance_end = fminf(distance_end, fmaxf(distance_0, distance_1));
+  }
+
+  if (direction[DIM_Z] == 0.0f) {
+    if (origin[DIM_Z] < m_origin[DIM_Z] || origin[DIM_Z] > max_z) {
+      return false;
+    }
+  }
+  else {
+    distance_0 = (m_origin[DIM_Z] - origin[DIM_Z]) / direction[DIM_Z];
+    distance_1 = (max_z - origin[DIM_Z]) / direction[DIM_Z];
+    distance_enter = fmaxf(distance_enter, fminf(distance_0, distance_1));
+    distance_end = fminf(distance_end, fmaxf(distance_0, distance_1));
+  }
+
+  if (distance_enter > distance_end) {
+    return false;
+  }
+
+  // walk the cells under the ray
+  int cell_x;
+  int cell_z;
+  float fraction_x;
+  float fraction_z;
+
+  __vector_element_op_and_scalar_opV3(origin, +, direction, *, distance_enter, point);
+  cell_store(point[DIM_X], point[DIM_Z], cell_x, cell_z, fraction_x, fraction_z);
+
+  // a ray that starts or enters the grid under the surface hits immediately
+  if (point[DIM_Y] <= height_at(point[DIM_X], point[DIM_Z])) {
+    distance = distance_enter;
+    normal_at(point[DIM_X], point[DIM_Z], normal);
+    return true;
+  }
+
+  int step_x = direction[DIM_X] > 0.0f ? 1 : -1;
+  int step_z = direction[DIM_Z] > 0.0f ? 1 : -1;
+
+  float distance_delta_x = direction[DIM_X] == 0.0f ? DISTANCE_INFINITE : fabsf(m_spacing / direction[DIM_X]);
+  float distance_delta_z = direction[DIM_Z] == 0.0f ? DISTANCE_INFINITE : fabsf(m_spacing / direction[DIM_Z]);
+
+  float distance_next_x = direction[DIM_X] == 0.0f ? DISTANCE_INFINITE
+    : (m_origin[DIM_X] + (cell_x + (step_x > 0 ? 1 : 0))*m_spacing - origin[DIM_X]) / direction[DIM_X];
+  float distance_next_z = direction[DIM_Z] == 0.0f ? DISTANCE_INFINITE
+    : (m_origin[DIM_Z] + (cell_z + (step_z > 0 ? 1 : 0))*m_spacing - origin[DIM_Z]) / direction[DIM_Z];
+
+  float distance_exit;
+
+  while (true) {
+    distance_exit = fminf(fminf(distance_next_x, distance_next_z), distance_end);
+
+    if (ray_cast_cell(cell_x, cell_z, origin, direction, distance_enter, distance_exit, distance)) {
+      __vector_element_op_and_scalar_opV3(origin, +, direction, *, distance, point);
+      normal_at(point[DIM_X], point[DIM_Z], normal);
+      return true;
+    }
+
+    if (distance_exit >= distance_end) {
+      return false;
+    }
+
+    distance_enter = distance_exit;
+
+    if (distance_next_x < distance_next_z) {
+      cell_x += step_x;
+      distance_next_x += distance_delta_x;
+    }
+    else {
+      cell_z += step_z;
+      distance_next_z += distance_delta_z;
+    }
+
+    if (cell_x < 0 || cell_x >= m_samples_x - 1 || cell_z < 0 || cell_z >= m_samples_z - 1) {
+      return false;
+    }
+  }
+}
+
+void Terrain::draw_GLUT() const {
+  if (m_is_chunk_list_dirty) {
+    build_chunk_lists();
+  }
+
+  glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE, m_color);
+  glMaterialfv(GL_FRONT_AND_BACK, GL_SPECULAR, COLOR_BLACK);
+
+  for (size_t i = 0; i < m_chunk_lists.size(); i++) {
+    glCallList(m_chunk_lists[i]);
+  }
+}
+
+void Terrain::cell_store(const float x, const float z, int& cell_x, int& cell_z, float& fraction_x, float& fraction_z) const {
+  float grid_x = (x - m_origin[DIM_X])*m_spacing_inverse;
+  float grid_z = (z - m_origin[DIM_Z])*m_spacing_inverse;
+
+  // clamp to the grid so that the last row and column use the last cell
+  grid_x = fminf(fmaxf(grid_x, 0.0f), (float)(m_samples_x - 1));
+  grid_z = fminf(fmaxf(grid_z, 0.0f), (float)(m_samples_z - 1));
+
+  cell_x = (int)grid_x;
+  cell_z = (int)grid_z;
+
+  if (cell_x > m_samples_x - 2) {
+    cell_x = m_samples_x - 2;
+  }
+  if (cell_z > m_samples_z - 2) {
+    cell_z = m_samples_z - 2;
+  }
+
+  fraction_x = grid_x - cell_x;
+  fraction_z = grid_z - cell_z;
+}
+
+bool Terrain::ray_cast_cell(const int cell_x, const int cell_z, const float origin[3], const float direction[3], const float distance_enter, const float distance_exit, float& distance) const {
+  const float* row_0 = &m_heights[cell_z*m_samples_x + cell_x];
+  const float* row_1 = row_0 + m_samples_x;
+
+  // reject cells whose height range the ray does not cross
+  float height_max = fmaxf(fmaxf(row_0[0], row_0[1]), fmaxf(row_1[0], row_1[1])) + m_origin[DIM_Y];
+  float y_enter = origin[DIM_Y] + direction[DIM_Y]*distance_enter;
+  float y_exit = origin[DIM_Y] + direction[DIM_Y]*distance_exit;
+
+  if (fminf(y_enter, y_exit) > height_max) {
+    return false;
+  }
+
+  // height over the cell is h(u, v) = a + b*u + c*v + d*u*v with u and v the fractions across the cell
+  float a = row_0[0];
+  float b = row_0[1] - row_0[0];
+  float c = row_1[0] - row_0[0];
+  float d = row_0[0] - row_0[1] - row_1[0] + row_1[1];
+
+  // u and v along the ray are p + q*t
+  float p_u = (origin[DIM_X] - m_origin[DIM_X])*m_spacing_inverse - cell_x;
+  float q_u = direction[DIM_X]*m_spacing_inverse;
+  float p_v = (origin[DIM_Z] - m_origin[DIM_Z])*m_spacing_inverse - cell_z;
+  float q_v = direction[DIM_Z]*m_spacing_inverse;
+
+  // ray height minus surface height is quadratic in t
+  float coefficient_2 = -d*q_u*q_v;
+  float coefficient_1 = direction[DIM_Y] - b*q_u - c*q_v - d*(p_u*q_v + q_u*p_v);
+  float coefficient_0 = origin[DIM_Y] - m_origin[DIM_Y] - a - b*p_u - c*p_v - d*p_u*p_v;
+
+  float root_0;
+  float root_1;
+
+  if (fabsf(coefficient_2) < QUADRATIC_EPSILON) {
+    if (coefficient_1 == 0.0f) {
+      return false;
+    }
+    root_0 = -coefficient_0 / coefficient_1;
+    root_1 = root_0;
+  }
+  else {
+    float discriminant = coefficient_1*coefficient_1 - 4.0f*coefficient_2*coefficient_0;
+    if (discriminant < 0.0f) {
+      return false;
+    }
+
+    // avoid cancellation when the quadratic term is small
+    float half_sum = -0.5f*(coefficient_1 + (coefficient_1 < 0.0f ? -sqrtf(discriminant) : sqrtf(discriminant)));
+    root_0 = half_sum / coefficient_2;
+    root_1 = half_sum != 0.0f ? coefficient_0 / half_sum : root_0;
+
+    if (root_0 > root_1) {
+      float temp = root_0;
+      root_0 = root_1;
+      root_1 = temp;
+    }
+  }
+
+  if (root_0 >= distance_enter && root_0 <= distance_exit) {
+    distance = root_0;
+    return true;
+  }
+  if (root_1 >= distance_enter && root_1 <= distance_exit) {
+    distance = root_1;
+    return true;
+  }
+
+  return false;
+}
+
+void Terrain::build_chunk_lists() const {
+  const int cells_x = m_samples_x - 1;
+  const int cells_z = m_samples_z - 1;
+
+  float normal[3];
+  float x;
+  float z;
+
+  release_chunk_lists();
+
+  for (int chunk_z = 0; chunk_z < cells_z; chunk_z += TERRAIN_CHUNK_CELLS) {
+    for (int chunk_x = 0; chunk_x < cells_x; chunk_x += TERRAIN_CHUNK_CELLS) {
+      const int end_x = chunk_x + TERRAIN_CHUNK_CELLS < cells_x ? chunk_x + TERRAIN_CHUNK_CELLS : cells_x;
+      const int end_z = chunk_z + TERRAIN_CHUNK_CELLS < cells_z ? chunk_z + TERRAIN_CHUNK_CELLS : cells_z;
+
+      unsigned int list = glGenLists(1);
+      glNewList(list, GL_COMPILE);
+
+      // one triangle strip per row of cells
+      for (int sample_z = chunk_z; sample_z < end_z; sample_z++) {
+        glBegin(GL_TRIANGLE_STRIP);
+
+        for (int sample_x = chunk_x; sample_x <= end_x; sample_x++) {
+          for (int row = 1; row >= 0; row--) {
+            x = m_origin[DIM_X] + sample_x*m_spacing;
+            z = m_origin[DIM_Z] + (sample_z + row)*m_spacing;
+
+            normal_at(x, z, normal);
+            glNormal3fv(normal);
+            glVertex3f(x, m_origin[DIM_Y] + get_height(sample_x, sample_z + row), z);
+          }
+        }
+
+        glEnd();
+      }
+
+      glEndList();
+      m_chunk_lists.push_back(list);
+    }
+  }
+
+  m_is_chunk_list_dirty = false;
+}
+
+void Terrain::release_chunk_lists() const {
+  for (size_t i = 0; i < m_chunk_lists.size(); i++) {
+    glDeleteLists(m_chunk_lists[i], 1);
+  }
+  m_chunk_lists.clear();
+}
\ No newline at end of file
@@ -0,0 +1,71 @@
+#ifndef TERRAIN_H
+#define TERRAIN_H
+
+#include <vector>
+
+#define DEFAULT_TERRAIN_SAMPLES 2
+#define DEFAULT_TERRAIN_SPACING 1.0f
+
+// cells per side of each separately drawn piece of the terrain
+#define TERRAIN_CHUNK_CELLS 32
+
+// a regular grid of heights over the XZ-plane
+class Terrain {
+public:
+  Terrain();
+
+  const int& c_samples_x = m_samples_x;
+  const int& c_samples_z = m_samples_z;
+  const float& c_spacing = m_spacing;
+
+  // position of the sample at grid coordinates (0, 0) at zero height
+  const float* c_origin = m_origin;
+
+  const float* c_color = m_color;
+
+  void set_size(const int samples_x, const int samples_z, const float spacing);
+  void set_spacing(const float spacing);
+  void set_origin(const float origin_x, const float origin_y, const float origin_z);
+  void set_color(const float color[4]);
+
+  void set_height(const int sample_x, const int sample_z, const float height);
+  float get_height(const int sample_x, const int sample_z) const;
+
+  // loads unsigned 16-bit little-endian samples, scaling the full range to height_scale,
+  // inferring a square size from the file length when samples_x and samples_z are zero
+  bool load_raw(const char* path, const float height_scale, const int samples_x = 0, const int samples_z = 0);
+
+  bool is_above(const float x, const float z) const;
+
+  // bilinear samples of the surface, clamped to the edges of the grid
+  float height_at(const float x, const float z) const;
+  void normal_at(const float x, const float z, float normal[3]) const;
+
+  bool ray_cast(const float origin[3], const float direction[3], const float max_distance, float& distance, float normal[3]) const;
+
+  void draw_GLUT() const;
+
+private:
+  int m_samples_x;
+  int m_samples_z;
+  float m_spacing;
+  float m_spacing_inverse;
+
+  float m_origin[3];
+
+  float m_color[4];
+
+  std::vector<float> m_heights;
+
+  // display lists of the chunks, rebuilt on the next draw after the heights change
+  mutable std::vector<unsigned int> m_chunk_lists;
+  mutable bool m_is_chunk_list_dirty;
+
+  void cell_store(const float x, const float z, int& cell_x, int& cell_z, float& fraction_x, float& fraction_z) const;
+  bool ray_cast_cell(const int cell_x, const int cell_z, const float origin[3], const float direction[3], const float distance_enter, const float distance_exit, float& distance) const;
+
+  void build_chunk_lists() const;
+  void release_chunk_lists() const;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,529 @@
+#include "TriangleMesh.h"
+
+#include <gl/glut.h>
+#include <gl/gl.h>
+
+#include <cmath>
+#include <algorithm>
+using namespace std;
+
+#include "vector3.h"
+
+#define DISTANCE_INFINITE 1e30f
+
+// determinants below this are treated as rays parallel to the triangle
+#define RAY_TRIANGLE_EPSILON 1e-9f
+
+// relative cost of visiting a node compared to testing a triangle
+#define BVH_TRAVERSAL_COST 1.0f
+
+// leaves are always split above this many triangles even when the SAH prefers a leaf
+#define BVH_MAX_LEAF_TRIANGLES 16
+
+// yields half the surface area of the box from min to max
+#define __half_areaV3(min, max) \
+  ((max[0] - min[0])*(max[1] - min[1]) + (max[1] - min[1])*(max[2] - min[2]) + (max[2] - min[2])*(max[0] - min[0]))
+
+TriangleMesh::TriangleMesh() {
+  m_triangle_count = 0;
+  m_node_count = 0;
+}
+
+bool TriangleMesh::set_geometry(const float* vertices, const int vertex_count, const int* indices, const int triangle_count) {
+  for (int i = 0; i < triangle_count*3; i++) {
+    if (indices[i] < 0 || indices[i] >= vertex_count) {
+      return false;
+    }
+  }
+
+  vector<int> triangle_order(triangle_count);
+  vector<float> centroids(triangle_count*3);
+  vector<float> bounds(triangle_count*6);
+  vector<float> source_vertices(triangle_count*9);
+
+  m_triangle_count = triangle_count;
+  m_nodes.clear();
+  m_triangle_vertices.clear();
+
+  // gather the corners of each triangle along with its bounds and centroid
+  for (int i = 0; i < triangle_count; i++) {
+    float* corners = &source_vertices[i*9];
+    float* min = &bounds[i*6];
+    float* max = min + 3;
+
+    for (int j = 0; j < 3; j++) {
+      const float* vertex = vertices + indices[i*3 + j]*3;
+      __vector_element_assign_opV3((corners + j*3), =, vertex);
+    }
+
+    for (int k = 0; k < 3; k++) {
+      min[k] = fminf(fminf(corners[k], corners[3 + k]), corners[6 + k]);
+      max[k] = fmaxf(fmaxf(corners[k], corners[3 + k]), corners[6 + k]);
+      centroids[i*3 + k] = (corners[k] + corners[3 + k] + corners[6 + k]) / 3.0f;
+    }
+
+    triangle_order[i] = i;
+  }
+
+  if (triangle_count > 0) {
+    m_nodes.reserve(triangle_count*2);
+    build_node(triangle_order, centroids, bounds, 0, triangle_count, 0);
+  }
+  m_node_count = (int)m_nodes.size();
+
+  // store the triangles in leaf order so that each leaf reads one contiguous block
+  m_triangle_vertices.resize(triangle_count*9);
+  for (int i = 0; i < triangle_count; i++) {
+    for (int j = 0; j < 9; j++) {
+      m_triangle_vertices[i*9 + j] = source_vertices[triangle_order[i]*9 + j];
+    }
+  }
+
+  return true;
+}
+
+void TriangleMesh::aabb_store(float min[3], float max[3]) const {
+  if (m_nodes.empty()) {
+    __vector_element_assign_opV3(min, =, ZERO_VECTOR);
+    __vector_element_assign_opV3(max, =, ZERO_VECTOR);
+    return;
+  }
+
+  __vector_element_assign_opV3(min, =, m_nodes[0].m_min);
+  __vector_element_assign_opV3(max, =, m_nodes[0].m_max);
+}
+
+bool TriangleMesh::ray_cast(const float origin[3], const float direction[3], const float max_distance, float& distance, float normal[3]) const {
+  int stack[BVH_STACK_SIZE];
+  int stack_size = 0;
+
+  float direction_inverse[3];
+  float best_distance = max_distance;
+  int best_triangle = -1;
+
+  float edge_0[3];
+  float edge_1[3];
+  float p[3];
+  float q[3];
+  float t[3];
+  float determinant;
+  float u;
+  float v;
+  float hit_distance;
+
+  if (m_nodes.empty()) {
+    return false;
+  }
+
+  for (int i = 0; i < 3; i++) {
+    direction_inverse[i] = direction[i] == 0.0f ? DISTANCE_INFINITE : 1.0f / direction[i];
+  }
+
+  // yields the entry distance of the ray into a node, or DISTANCE_INFINITE when it misses
+  auto node_entry = [&](const Node& node) -> float {
+    float distance_near = 0.0f;
+    float distance_far = best_distance;
+
+    for (int i = 0; i < 3; i++) {
+      float distance_0 = (node.m_min[i] - origin[i])*direction_inverse[i];
+      float distance_1 = (node.m_max[i] - origin[i])*direction_inverse[i];
+      distance_near = fmaxf(distance_near, fminf(distance_0, distance_1));
+      distance_far = fminf(distance_far, fmaxf(distance_0, distance_1));
+    }
+
+    return distance_near <= distance_far ? distance_near : DISTANCE_INFINITE;
+  };
+
+  if (node_entry(m_nodes[0]) == DISTANCE_INFINITE) {
+    return false;
+  }
+
+  stack[stack_size++] = 0;
+
+  while (stack_size > 0) {
+    const Node& node = m_nodes[stack[--stack_size]];
+
+    if (node.m_count > 0) {
+      // Moller-Trumbore intersection against each triangle of the leaf
+      for (int i = node.m_offset; i < node.m_offset + node.m_count; i++) {
+        const float* corners = &m_triangle_vertices[i*9];
+
+        __vector_element_opV3((corners + 3), -, corners, edge_0);
+        __vector_element_opV3((corners + 6), -, corners, edge_1);
+        __cross_productV3(direction, edge_1, p);
+
+        determinant = __dot_productV3(edge_0, p);
+        if (fabsf(determinant) < RAY_TRIANGLE_EPSILON) {
+          continue;
+        }
+        determinant = 1.0f / determinant;
+
+        __vector_element_opV3(origin, -, corners, t);
+        u = __dot_productV3(t, p)*determinant;
+        if (u < 0.0f || u > 1.0f) {
+          continue;
+        }
+
+        __cross_productV3(t, edge_0, q);
+        v = __dot_productV3(direction, q)*determinant;
+        if (v < 0.0f || u + v > 1.0f) {
+          continue;
+        }
+
+        hit_distance = __dot_productV3(edge_1, q)*determinant;
+        if (hit_distance >= 0.0f && hit_distance < best_distance) {
+          best_distance = hit_distance;
+          best_triangle = i;
+        }
+      }
+      continue;
+    }
+
+    // visit the nearer child first
+    const int child_0 = (int)(&node - &m_nodes[0]) + 1;
+    const int child_1 = node.m_offset;
+    const float entry_0 = node_entry(m_nodes[child_0]);
+    const float entry_1 = node_entry(m_nodes[child_1]);
+
+    if (entry_0 <= entry_1) {
+      if (entry_1 != DISTANCE_INFINITE) {
+        stack[stack_size++] = child_1;
+      }
+      if (entry_0 != DISTANCE_INFINITE) {
+        stack[stack_size++] = child_0;
+      }
+    }
+    else {
+      if (entry_0 != DISTANCE_INFINITE) {
+        stack[stack_size++] = child_0;
+      }
+      stack[stack_size++] = child_1;
+    }
+  }
+
+  if (best_triangle < 0) {
+    return false;
+  }
+
+  // report the face normal on the side the ray came from
+  const float* corners = &m_triangle_vertices[best_triangle*9];
+  __vector_element_opV3((corners + 3), -, corners, edge_0);
+  __vector_element_opV3((corners + 6), -, corners, edge_1);
+  __cross_productV3(edge_0, edge_1, normal);
+  normalizeV3(normal);
+
+  if (__dot_productV3(normal, direction) > 0.0f) {
+    __negativeV3(normal, normal);
+  }
+
+  distance = best_distance;
+  return true;
+}
+
+template<typename Visitor>
+bool TriangleMesh::walk(const float min[3], const float max[3], Visitor& visitor) const {
+  int stack[BVH_STACK_SIZE];
+  int stack_size = 0;
+
+  if (m_nodes.empty()) {
+    return false;
+  }
+
+  stack[stack_size++] = 0;
+
+  while (stack_size > 0) {
+    const int node_index = stack[--stack_size];
+    const Node& node = m_nodes[node_index];
+
+    if (node.m_min[0] > max[0] || node.m_max[0] < min[0]
+      || node.m_min[1] > max[1] || node.m_max[1] < min[1]
+      || node.m_min[2] > max[2] || node.m_max[2] < min[2]
+      )
+    {
+      continue;
+    }
+
+    if (node.m_count > 0) {
+      for (int i = node.m_offset; i < node.m_offset + node.m_count; i++) {
+        if (visitor(i)) {
+          return true;
+        }
+      }
+      continue;
+    }
+
+    stack[stack_size++] = node.m_offset;
+    stack[stack_size++] = node_index + 1;
+  }
+
+  return false;
+}
+
+bool TriangleMesh::is_box_overlapping(const float center[3], const float axes[3][3], const float half_extent[3]) const {
+  float box_min[3];
+  float box_max[3];
+  float reach;
+
+  // bound the box with an axis-aligned box in the mesh frame for the node tests
+  for (int i = 0; i < 3; i++) {
+    reach = fabsf(axes[0][i])*half_extent[0] + fabsf(axes[1][i])*half_extent[1] + fabsf(axes[2][i])*half_extent[2];
+    box_min[i] = center[i] - reach;
+    box_max[i] = center[i] + reach;
+  }
+
+  auto visitor = [&](const int triangle_index) {
+    return is_triangle_box_overlapping(triangle_index, center, axes, half_extent);
+  };
+
+  return walk(box_min, box_max, visitor);
+}
+
+void TriangleMesh::triangles_store(const float min[3], const float max[3], vector<int>& triangle_indices) const {
+  auto visitor = [&](const int triangle_index) {
+    triangle_indices.push_back(triangle_index);
+    return false;
+  };
+
+  triangle_indices.clear();
+  walk(min, max, visitor);
+}
+
+void TriangleMesh::draw_GLUT() const {
+  float edge_0[3];
+  float edge_1[3];
+  float normal[3];
+
+  glBegin(GL_TRIANGLES);
+
+  for (int i = 0; i < m_triangle_count; i++) {
+    const float* corners = &m_triangle_vertices[i*9];
+
+    __vector_element_opV3((corners + 3), -, corners, edge_0);
+    __vector_element_opV3((corners + 6), -, corners, edge_1);
+    __cross_productV3(edge_0, edge_1, normal);
+    normalizeV3(normal);
+
+    glNormal3fv(normal);
+    glVertex3fv(corners);
+    glVertex3fv(corners + 3);
+    glVertex3fv(corners + 6);
+  }
+
+  glEnd();
+}
+
+int TriangleMesh::build_node(vector<int>& triangle_order, vector<float>& centroids, vector<float>& bounds, const int begin, const int end, const int depth) {
+  const int node_index = (int)m_nodes.size();
+  const int count = end - begin;
+
+  float centroid_min[3];
+  float centroid_max[3];
+
+  Node node;
+
+  // find the bounds of the triangles and of their centroids
+  for (int k = 0; k < 3; k++) {
+    node.m_min[k] = DISTANCE_INFINITE;
+    node.m_max[k] = -DISTANCE_INFINITE;
+    centroid_min[k] = DISTANCE_INFINITE;
+    centroid_max[k] = -DISTANCE_INFINITE;
+  }
+
+  for (int i = begin; i < end; i++) {
+    const int triangle = triangle_order[i];
+    for (int k = 0; k < 3; k++) {
+      node.m_min[k] = fminf(node.m_min[k], bounds[triangle*6 + k]);
+      node.m_max[k] = fmaxf(node.m_max[k], bounds[triangle*6 + 3 + k]);
+      centroid_min[k] = fminf(centroid_min[k], centroids[triangle*3 + k]);
+      centroid_max[k] = fmaxf(centroid_max[k], centroids[triangle*3 + k]);
+    }
+  }
+
+  node.m_offset = begin;
+  node.m_count = count;
+  m_nodes.push_back(node);
+
+  // the traversal stacks hold at most one entry per level
+  if (count <= BVH_LEAF_TRIANGLES || depth >= BVH_STACK_SIZE - 1) {
+    return node_index;
+  }
+
+  // evaluate the surface area heuristic over centroid bins on every axis
+  float best_cost = DISTANCE_INFINITE;
+  int best_axis = -1;
+  int best_split = 0;
+
+  for (int axis = 0; axis < 3; axis++) {
+    const float extent = centroid_max[axis] - centroid_min[axis];
+    if (extent <= 0.0f) {
+      continue;
+    }
+
+    int bin_counts[BVH_SAH_BINS] = { 0 };
+    float bin_min[BVH_SAH_BINS][3];
+    float bin_max[BVH_SAH_BINS][3];
+
+    for (int b = 0; b < BVH_SAH_BINS; b++) {
+      for (int k = 0; k < 3; k++) {
+        bin_min[b][k] = DISTANCE_INFINITE;
+        bin_max[b][k] = -DISTANCE_INFINITE;
+      }
+    }
+
+    for (int i = begin; i < end; i++) {
+      const int triangle = triangle_order[i];
+      int b = (int)((centroids[triangle*3 + axis] - centroid_min[axis]) / extent*BVH_SAH_BINS);
+      b = b < BVH_SAH_BINS ? b : BVH_SAH_BINS - 1;
+
+      bin_counts[b]++;
+      for (int k = 0; k < 3; k++) {
+        bin_min[b][k] = fminf(bin_min[b][k], bounds[triangle*6 + k]);
+        bin_max[b][k] = fmaxf(bin_max[b][k], bounds[triangle*6 + 3 + k]);
+      }
+    }
+
+    // sweep from the right to get the area and count of every right side
+    float right_areas[BVH_SAH_BINS];
+    int right_counts[BVH_SAH_BINS];
+    float sweep_min[3] = { DISTANCE_INFINITE, DISTANCE_INFINITE, DISTANCE_INFINITE };
+    float sweep_max[3] = { -DISTANCE_INFINITE, -DISTANCE_INFINITE, -DISTANCE_INFINITE };
+    int sweep_count = 0;
+
+    for (int b = BVH_SAH_BINS - 1; b > 0; b--) {
+      sweep_count += bin_counts[b];
+      for (int k = 0; k < 3; k++) {
+        sweep_min[k] = fminf(sweep_min[k], bin_min[b][k]);
+        sweep_max[k] = fmaxf(sweep_max[k], bin_max[b][k]);
+      }
+      right_counts[b] = sweep_count;
+      right_areas[b] = sweep_count > 0 ? __half_areaV3(sweep_min, sweep_max) : 0.0f;
+    }
+
+    // sweep from the left and cost each split between bins
+    for (int k = 0; k < 3; k++) {
+      sweep_min[k] = DISTANCE_INFINITE;
+      sweep_max[k] = -DISTANCE_INFINITE;
+    }
+    sweep_count = 0;
+
+    for (int b = 0; b < BVH_SAH_BINS - 1; b++) {
+      sweep_count += bin_counts[b];
+      for (int k = 0; k < 3; k++) {
+        sweep_min[k] = fminf(sweep_min[k], bin_min[b][k]);
+        sweep_max[k] = fmaxf(sweep_max[k], bin_max[b][k]);
+      }
+
+      if (sweep_count == 0 || right_counts[b + 1] == 0) {
+        continue;
+      }
+
+      const float cost = __half_areaV3(sweep_min, sweep_max)*sweep_count + right_areas[b + 1]*right_counts[b + 1];
+      if (cost < best_cost) {
+        best_cost = cost;
+        best_axis = axis;
+        best_split = b + 1;
+      }
+    }
+  }
+
+  const float leaf_cost = (float)count;
+  const float parent_area = __half_areaV3(node.m_min, node.m_max);
+  int middle;
+
+  if (best_axis >= 0 && parent_area > 0.0f) {
+    best_cost = BVH_TRAVERSAL_COST + best_cost / parent_area;
+  }
+
+  // keep small nodes as leaves when every centroid coincides or splitting does not pay off
+  if ((best_axis < 0 || best_cost >= leaf_cost) && count <= BVH_MAX_LEAF_TRIANGLES) {
+    return node_index;
+  }
+
+  if (best_axis >= 0) {
+    const float extent = centroid_max[best_axis] - centroid_min[best_axis];
+    int* split = partition(&triangle_order[begin], &triangle_order[end], [&](const int triangle) {
+      int b = (int)((centroids[triangle*3 + best_axis] - centroid_min[best_axis]) / extent*BVH_SAH_BINS);
+      return (b < BVH_SAH_BINS ? b : BVH_SAH_BINS - 1) < best_split;
+    });
+    middle = (int)(split - &triangle_order[0]);
+  }
+  else {
+    middle = begin;
+  }
+
+  // fall back to splitting the triangles in half
+  if (middle == begin || middle == end) {
+    middle = begin + count / 2;
+  }
+
+  build_node(triangle_order, centroids, bounds, begin, middle, depth + 1);
+  const int second_child = build_node(triangle_order, centroids, bounds, middle, end, depth + 1);
+
+  m_nodes[node_index].m_offset = second_child;
+  m_nodes[node_index].m_count = 0;
+
+  return node_index;
+}
+
+bool TriangleMesh::is_triangle_box_overlapping(const int triangle_index, const float center[3], const float axes[3][3], const float half_extent[3]) const {
+  const float* corners = &m_triangle_vertices[triangle_index*9];
+
+  float vertex[3][3];
+  float edge[3][3];
+  float relative[3];
+  float normal[3];
+  float axis[3];
+
+  float projection_0;
+  float projection_1;
+  float projection_2;
+  float radius;
+
+  // express the triangle in the frame of the box
+  for (int i = 0; i < 3; i++) {
+    __vector_element_opV3((corners + i*3), -, center, relative);
+    vertex[i][0] = __dot_productV3(relative, axes[0]);
+    vertex[i][1] = __dot_productV3(relative, axes[1]);
+    vertex[i][2] = __dot_productV3(relative, axes[2]);
+  }
+
+  __vector_element_opV3(vertex[1], -, vertex[0], edge[0]);
+  __vector_element_opV3(vertex[2], -, vertex[1], edge[1]);
+  __vector_element_opV3(vertex[0], -, vertex[2], edge[2]);
+
+  // the nine cross products of the box axes and the triangle edges
+  for (int i = 0; i < 3; i++) {
+    for (int j = 0; j < 3; j++) {
+      const float box_axis[3] = { i == 0 ? 1.0f : 0.0f, i == 1 ? 1.0f : 0.0f, i == 2 ? 1.0f : 0.0f };
+      __cross_productV3(box_axis, edge[j], axis);
+
+      projection_0 = __dot_productV3(vertex[0], axis);
+      projection_1 = __dot_productV3(vertex[1], axis);
+      projection_2 = __dot_productV3(vertex[2], axis);
+      radius = half_extent[0]*fabsf(axis[0]) + half_extent[1]*fabsf(axis[1]) + half_extent[2]*fabsf(axis[2]);
+
+      if (fminf(fminf(projection_0, projection_1), projection_2) > radius
+        || fmaxf(fmaxf(projection_0, projection_1), projection_2) < -radius
+        )
+      {
+        return false;
+      }
+    }
+  }
+
+  // the three box axes
+  for (int i = 0; i < 3; i++) {
+    if (fminf(fminf(vertex[0][i], vertex[1][i]), vertex[2][i]) > half_extent[i]
+      || fmaxf(fmaxf(vertex[0][i], vertex[1][i]), vertex[2][i]) < -half_extent[i]
+      )
+    {
+      return false;
+    }
+  }
+
+  // the plane of the triangle
+  __cross_productV3(edge[0], edge[1], normal);
+  radius = half_extent[0]*fabsf(normal[0]) + half_extent[1]*fabsf(normal[1]) + half_extent[2]*fabsf(normal[2]);
+
+  return fabsf(__dot_productV3(normal, vertex[0])) <= radius;
+}
\ No newline at end of file
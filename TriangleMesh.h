@@ -0,0 +1,66 @@
+#ifndef TRIANGLE_MESH_H
+#define TRIANGLE_MESH_H
+
+#include <vector>
+
+// number of centroid bins evaluated per axis when choosing a split
+#define BVH_SAH_BINS 12
+
+// leaves are not split below this many triangles
+#define BVH_LEAF_TRIANGLES 4
+
+#define BVH_STACK_SIZE 64
+
+// static triangle geometry in a local frame with a bounding volume hierarchy for queries
+class TriangleMesh {
+public:
+  TriangleMesh();
+
+  const int& c_triangle_count = m_triangle_count;
+  const int& c_node_count = m_node_count;
+
+  // corner positions of each triangle in BVH leaf order, nine elements per triangle
+  const std::vector<float>& c_triangle_vertices = m_triangle_vertices;
+
+  // copies the triangles described by indices into vertices and builds the hierarchy, returning false and keeping the
+  // previous geometry when an index is outside of the vertex_count vertices
+  bool set_geometry(const float* vertices, const int vertex_count, const int* indices, const int triangle_count);
+
+  void aabb_store(float min[3], float max[3]) const;
+
+  bool ray_cast(const float origin[3], const float direction[3], const float max_distance, float& distance, float normal[3]) const;
+
+  // tests against the oriented box with the given center, unit axes and half dimensions, all in the mesh frame
+  bool is_box_overlapping(const float center[3], const float axes[3][3], const float half_extent[3]) const;
+
+  // replaces triangle_indices with the triangles whose leaves overlap the axis-aligned box in the mesh frame
+  void triangles_store(const float min[3], const float max[3], std::vector<int>& triangle_indices) const;
+
+  void draw_GLUT() const;
+
+private:
+  // a 32 byte node; interior nodes keep their first child right after them and their second child at m_offset,
+  // leaves keep m_count triangles starting at m_offset
+  struct Node {
+    float m_min[3];
+    float m_max[3];
+    int m_offset;
+    int m_count;
+  };
+
+  int m_triangle_count;
+  int m_node_count;
+
+  std::vector<float> m_triangle_vertices;
+  std::vector<Node> m_nodes;
+
+  // calls visitor with the index of each triangle in the leaves overlapping the box until it returns true
+  template<typename Visitor>
+  bool walk(const float min[3], const float max[3], Visitor& visitor) const;
+
+  int build_node(std::vector<int>& triangle_order, std::vector<float>& centroids, std::vector<float>& bounds, const int begin, const int end, const int depth);
+
+  bool is_triangle_box_overlapping(const int triangle_index, const float center[3], const float axes[3][3], const float half_extent[3]) const;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,52 @@
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include <atomic>
+
+// set on the index of the middle slot while it holds a value the reader has not taken yet
+#define TRIPLE_BUFFER_FRESH 4
+
+// hands values from one writer thread to one reader thread without locks; the writer fills its own slot and swaps it
+// with the middle one, and the reader swaps the middle slot with its own when it is fresh, so neither ever waits on the
+// other and the reader always sees the latest value published whole
+template <typename T>
+class TripleBuffer {
+public:
+  // the slots start value-initialized
+  TripleBuffer() : m_slots(), m_write_index(0), m_middle(1), m_read_index(2) {}
+
+  // the slot the writer fills, which keeps whatever it held three publishes ago
+  T& write_slot() {
+    return m_slots[m_write_index];
+  }
+
+  // hands the write slot to the reader
+  void publish() {
+    m_write_index = m_middle.exchange(m_write_index | TRIPLE_BUFFER_FRESH, std::memory_order_acq_rel) & ~TRIPLE_BUFFER_FRESH;
+  }
+
+  // takes the last value published, returning false when there is none newer than the read slot
+  bool read_update() {
+    if ((m_middle.load(std::memory_order_relaxed) & TRIPLE_BUFFER_FRESH) == 0) {
+      return false;
+    }
+
+    m_read_index = m_middle.exchange(m_read_index, std::memory_order_acq_rel) & ~TRIPLE_BUFFER_FRESH;
+    return true;
+  }
+
+  // the slot the reader holds, which stays the same until the next read_update
+  const T& read_slot() const {
+    return m_slots[m_read_index];
+  }
+
+private:
+  T m_slots[3];
+
+  // only touched by the writer and the reader respectively
+  int m_write_index;
+  std::atomic<int> m_middle;
+  int m_read_index;
+};
+
+#endif
\ No newline at end of file
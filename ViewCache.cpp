@@ -0,0 +1,99 @@
+#include "ViewCache.h"
+
+#include <gl/glut.h>
+#include <gl/gl.h>
+
+#include <algorithm>
+using namespace std;
+
+#include "matrix4.h"
+
+// the smallest power of two not below value
+static int power_of_two_ceiling(const int value) {
+  int power = 1;
+  while (power < value) {
+    power <<= 1;
+  }
+  return power;
+}
+
+ViewCache::ViewCache() {
+  m_texture = 0;
+  m_texture_width = 0;
+  m_texture_height = 0;
+
+  fill(m_viewport, m_viewport + 4, 0);
+  m_step = 0;
+  m_is_valid = false;
+}
+
+bool ViewCache::is_current(const int viewport[4], const unsigned int step) const {
+  return m_is_valid && m_step == step && equal(viewport, viewport + 4, m_viewport);
+}
+
+void ViewCache::capture(const int viewport[4], const unsigned int step) {
+  const int width = power_of_two_ceiling(viewport[2]);
+  const int height = power_of_two_ceiling(viewport[3]);
+
+  if (m_texture == 0) {
+    glGenTextures(1, &m_texture);
+  }
+  glBindTexture(GL_TEXTURE_2D, m_texture);
+
+  // the texture is only reallocated when the viewport outgrows it
+  if (width > m_texture_width || height > m_texture_height) {
+    m_texture_width = max(width, m_texture_width);
+    m_texture_height = max(height, m_texture_height);
+
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, m_texture_width, m_texture_height, 0, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  }
+
+  glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, viewport[0], viewport[1], viewport[2], viewport[3]);
+  glBindTexture(GL_TEXTURE_2D, 0);
+
+  copy(viewport, viewport + 4, m_viewport);
+  m_step = step;
+  m_is_valid = true;
+}
+
+void ViewCache::draw(GLState& gl_state) const {
+  float identity[16];
+
+  if (!m_is_valid) {
+    return;
+  }
+
+  // the viewport is covered exactly by the unit square
+  identityM4(identity);
+  gl_state.set_projection(identity);
+  gl_state.set_modelview(identity);
+
+  const float s = (float)m_viewport[2] / (float)m_texture_width;
+  const float t = (float)m_viewport[3] / (float)m_texture_height;
+
+  glPushAttrib(GL_ENABLE_BIT | GL_TEXTURE_BIT);
+  glDisable(GL_LIGHTING);
+  glDisable(GL_DEPTH_TEST);
+  glEnable(GL_TEXTURE_2D);
+  glBindTexture(GL_TEXTURE_2D, m_texture);
+  glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_REPLACE);
+
+  glBegin(GL_QUADS);
+  glTexCoord2f(0.0f, 0.0f);
+  glVertex2f(-1.0f, -1.0f);
+  glTexCoord2f(s, 0.0f);
+  glVertex2f(1.0f, -1.0f);
+  glTexCoord2f(s, t);
+  glVertex2f(1.0f, 1.0f);
+  glTexCoord2f(0.0f, t);
+  glVertex2f(-1.0f, 1.0f);
+  glEnd();
+
+  glPopAttrib();
+}
+
+void ViewCache::invalidate() {
+  m_is_valid = false;
+}
\ No newline at end of file
@@ -0,0 +1,36 @@
+#ifndef VIEW_CACHE_H
+#define VIEW_CACHE_H
+
+#include "GLState.h"
+
+// a copy of a viewport as drawn for one simulation step, so that a view updated less often than the frame rate can be
+// shown again without drawing its shapes
+class ViewCache {
+public:
+  ViewCache();
+
+  const unsigned int& c_step = m_step;
+
+  // whether the copy holds step at the size and place of viewport
+  bool is_current(const int viewport[4], const unsigned int step) const;
+
+  // copies viewport of the back buffer, which must just have been drawn for step
+  void capture(const int viewport[4], const unsigned int step);
+
+  // draws the copy over the current viewport, leaving the projection and modelview of gl_state as identities
+  void draw(GLState& gl_state) const;
+
+  void invalidate();
+
+private:
+  // created on the first capture, with power-of-two sides at least as large as the viewport
+  unsigned int m_texture;
+  int m_texture_width;
+  int m_texture_height;
+
+  int m_viewport[4];
+  unsigned int m_step;
+  bool m_is_valid;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,140 @@
+#include "WorkerPool.h"
+
+#include <string>
+using namespace std;
+using namespace std::chrono;
+
+#include "Profiler.h"
+
+WorkerPool::WorkerPool(const int worker_count) {
+  m_worker_count = worker_count;
+  if (m_worker_count <= 0) {
+    m_worker_count = (int)thread::hardware_concurrency() - 1;
+  }
+  if (m_worker_count < 0) {
+    m_worker_count = 0;
+  }
+
+  m_task = nullptr;
+  m_item_count = 0;
+  m_chunk_size = 1;
+  m_job_generation = 0;
+  m_busy_workers = 0;
+  m_is_stopping = false;
+  m_next_item = 0;
+  m_profiler = nullptr;
+
+  for (int i = 0; i < m_worker_count; i++) {
+    m_workers.push_back(thread(&WorkerPool::worker_loop, this, i));
+  }
+}
+
+WorkerPool::~WorkerPool() {
+  {
+    lock_guard<mutex> lock(m_mutex);
+    m_is_stopping = true;
+  }
+  m_job_started.notify_all();
+
+  for (size_t i = 0; i < m_workers.size(); i++) {
+    m_workers[i].join();
+  }
+}
+
+void WorkerPool::set_profiler(Profiler* profiler) {
+  lock_guard<mutex> lock(m_mutex);
+  m_profiler = profiler;
+}
+
+void WorkerPool::parallel_for(const int item_count, const int chunk_size, const function<void(const int, const int)>& task) {
+  if (item_count <= 0) {
+    return;
+  }
+
+  // run small jobs and pools without workers directly on the calling thread
+  if (m_worker_count == 0 || item_count <= chunk_size) {
+    task(0, item_count);
+    return;
+  }
+
+  lock_guard<mutex> job_lock(m_job_mutex);
+  Profiler* profiler;
+
+  {
+    lock_guard<mutex> lock(m_mutex);
+    profiler = m_profiler;
+    m_task = &task;
+    m_item_count = item_count;
+    m_chunk_size = chunk_size > 0 ? chunk_size : 1;
+    m_next_item = 0;
+    m_busy_workers = m_worker_count;
+    m_job_generation++;
+  }
+  m_job_started.notify_all();
+
+  run_chunks(profiler);
+
+  // wait for the workers to finish their last chunks
+  unique_lock<mutex> lock(m_mutex);
+  m_job_finished.wait(lock, [this] { return m_busy_workers == 0; });
+  m_task = nullptr;
+}
+
+void WorkerPool::worker_loop(const int worker) {
+  unsigned int generation_seen = 0;
+  Profiler* profiler = nullptr;
+  Profiler* named_profiler = nullptr;
+
+  while (true) {
+    {
+      unique_lock<mutex> lock(m_mutex);
+      m_job_started.wait(lock, [&] { return m_is_stopping || m_job_generation != generation_seen; });
+
+      if (m_is_stopping) {
+        return;
+      }
+      generation_seen = m_job_generation;
+      profiler = m_profiler;
+    }
+
+    if (profiler != nullptr && profiler != named_profiler) {
+      profiler->set_thread_name("worker " + to_string(worker));
+      named_profiler = profiler;
+    }
+
+    run_chunks(profiler);
+
+    {
+      lock_guard<mutex> lock(m_mutex);
+      m_busy_workers--;
+    }
+    m_job_finished.notify_one();
+  }
+}
+
+void WorkerPool::run_chunks(Profiler* profiler) {
+  const steady_clock::time_point start = steady_clock::now();
+  bool is_any_run = false;
+  int begin;
+  int end;
+
+  while (true) {
+    begin = m_next_item.fetch_add(m_chunk_size);
+    if (begin >= m_item_count) {
+      break;
+    }
+    is_any_run = true;
+
+    end = begin + m_chunk_size;
+    if (end > m_item_count) {
+      end = m_item_count;
+    }
+
+    (*m_task)(begin, end);
+  }
+
+  // threads that found every chunk taken leave nothing in the trace
+  if (profiler != nullptr && is_any_run) {
+    profiler->record(PROFILE_STAGE_TASK, start, duration<float>(steady_clock::now() - start).count());
+  }
+}
\ No newline at end of file
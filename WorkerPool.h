@@ -0,0 +1,57 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+
+class Profiler;
+
+// a worker count of zero uses one worker less than the number of hardware threads
+#define DEFAULT_WORKER_COUNT 0
+
+// a fixed set of threads that split loops over item ranges with the calling thread
+class WorkerPool {
+public:
+  WorkerPool(const int worker_count = DEFAULT_WORKER_COUNT);
+  ~WorkerPool();
+
+  const int& c_worker_count = m_worker_count;
+
+  // times the chunks each thread runs of a parallel_for as a PROFILE_STAGE_TASK, and names the workers
+  void set_profiler(Profiler* profiler);
+
+  // runs task(begin, end) over [0, item_count) in chunks of chunk_size and returns once every chunk is done
+  void parallel_for(const int item_count, const int chunk_size, const std::function<void(const int, const int)>& task);
+
+private:
+  int m_worker_count;
+  std::vector<std::thread> m_workers;
+
+  // serializes parallel_for calls from different threads
+  std::mutex m_job_mutex;
+
+  std::mutex m_mutex;
+  std::condition_variable m_job_started;
+  std::condition_variable m_job_finished;
+
+  // the current job, replaced each time m_job_generation is incremented
+  const std::function<void(const int, const int)>* m_task;
+  int m_item_count;
+  int m_chunk_size;
+  unsigned int m_job_generation;
+  int m_busy_workers;
+  bool m_is_stopping;
+
+  std::atomic<int> m_next_item;
+
+  Profiler* m_profiler;
+
+  void worker_loop(const int worker);
+  void run_chunks(Profiler* profiler);
+};
+
+#endif
\ No newline at end of file
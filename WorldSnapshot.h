@@ -0,0 +1,56 @@
+#ifndef WORLD_SNAPSHOT_H
+#define WORLD_SNAPSHOT_H
+
+#include <vector>
+
+#include "Shape.h"
+
+#define SNAPSHOT_VIEW_COUNT_MAX 2
+
+// what the render thread needs of one shape, copied so that the simulation can move the shape meanwhile
+struct ShapeSnapshot {
+  // the shape or the stand-in for its level of detail; only the type, scale and mesh are read through this, which do
+  // not change once the world is built
+  const Shape* shape;
+
+  float model[16];
+
+  float color[4];
+  float reflectance[4];
+  float shininess;
+};
+
+// one camera drawn into part of the window
+struct ViewSnapshot {
+  // the step in which the view was last culled, which is older than the snapshot for views updated less often
+  unsigned int step;
+
+  float camera_position[3];
+  float camera_target[3];
+  float camera_vector_up[3];
+
+  // indices into the shapes of the snapshot inside the view, and the number left out
+  std::vector<int> shape_indices;
+  int culled_shape_count;
+
+  // triangles the levels of detail chosen for the view leave to draw, and those they save
+  int triangle_count;
+  int saved_triangle_count;
+};
+
+// the visible world as of one simulation step
+struct WorldSnapshot {
+  // numbered from 1, so that 0 means nothing was published yet
+  unsigned int step;
+
+  // how views share the window, and how many of views are used
+  int view_layout;
+  int view_count;
+
+  // every shape inside any of the views, each copied once however many views see it at the same level of detail
+  std::vector<ShapeSnapshot> shapes;
+
+  ViewSnapshot views[SNAPSHOT_VIEW_COUNT_MAX];
+};
+
+#endif
\ No newline at end of file
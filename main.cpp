@@ -1,9 +1,13 @@
-#include <gl/glut.h>
+#include <gl/freeglut.h>
 #include <gl/gl.h>
 
 #include <iostream>
 #include <vector>
 #include <chrono>
+#include <algorithm>
+#include <cmath>
+#include <thread>
+#include <atomic>
 
 using namespace std;
 using namespace std::chrono;
@@ -11,9 +15,28 @@ using namespace std::chrono;
 #include "Camera.h"
 #include "Shape.h"
 #include "Acceleration.h"
+#include "SpatialIndex.h"
+#include "WorkerPool.h"
+#include "Lidar.h"
+#include "SoftwareRenderer.h"
+#include "Terrain.h"
+#include "Gjk.h"
+#include "Contact.h"
+#include "Island.h"
+#include "Frustum.h"
+#include "RenderQueue.h"
+#include "GLState.h"
+#include "FramePacer.h"
+#include "TripleBuffer.h"
+#include "WorldSnapshot.h"
+#include "ViewCache.h"
+#include "FrameCapture.h"
+#include "LevelOfDetail.h"
+#include "Profiler.h"
 
 #include "macro_constants.h"
 #include "vector3.h"
+#include "matrix4.h"
 #include "colors.h"
 
 #define ESC_KEY 27
@@ -25,6 +48,11 @@ using namespace std::chrono;
 
 #define CAMERA_Y_MIN 0.1f
 
+#define CAMERA_FOLLOW_DISTANCE 15.0f
+#define CAMERA_FOLLOW_ANGLE_DOWN (PI/32.0f)
+#define CAMERA_FOLLOW_HEIGHT 2.0f
+#define CAMERA_FOLLOW_SMOOTH_TIME 0.1f
+
 #define GROUND_THICKNESS 5.0f
 
 #define BOUNDARY_SIZE 200.0f
@@ -33,20 +61,54 @@ using namespace std::chrono;
 
 #define WALL_HEIGHT 0.4f
 
-#define __update_fullscreen_dimensions() \
-  glGetIntegerv(GL_VIEWPORT, fullscreen_viewport); \
-  fullscreen_width = fullscreen_viewport[2] - fullscreen_viewport[0]; \
-  fullscreen_height = fullscreen_viewport[3] - fullscreen_viewport[1]; \
-  fullscreen_ratio_wh = (float)fullscreen_width / (float)fullscreen_height;
+#define TERRAIN_HEIGHT_SCALE 10.0f
+
+#define LIDAR_MOUNT_HEIGHT 0.5f
+
+// views closer than this are taken to be the same when deciding whether to draw
+#define VIEW_CHANGE_EPSILON 1e-5f
+
+// the simulation steps at this rate however fast frames are drawn
+#define SIMULATION_STEP_SECONDS (1.0f / 120.0f)
+
+// main_camera fills the window alone, with the other camera in a corner, or side by side with it
+#define VIEW_LAYOUT_SINGLE 0
+#define VIEW_LAYOUT_MINIMAP 1
+#define VIEW_LAYOUT_SPLIT 2
+#define VIEW_LAYOUT_COUNT 3
+
+// side of the minimap as a fraction of the window height, and its distance from the corner in pixels
+#define MINIMAP_SIZE 0.3f
+#define MINIMAP_MARGIN 10
+
+// views after the first are culled and drawn once every this many steps, and shown from a copy in between
+#define SECONDARY_VIEW_STEP_INTERVAL 4
+
+#define FIELD_OF_VIEW_Y 30.0f
+#define NEAR_DISTANCE 0.1f
+#define FAR_DISTANCE (BOUNDARY_SIZE*2.0f)
+
+#define SCREENSHOT_PATH "screenshot.ppm"
+
+// where T writes the trace of the last frames, unless --trace gives another path
+#define DEFAULT_TRACE_PATH "trace.json"
+#define DEFAULT_TRACE_FRAME_COUNT 120
+
+// --check-instancing passes when no more than this fraction of the pixels differ, which allows for the edges the two
+// paths rasterize differently
+#define INSTANCING_CHECK_DIFFERENCE_MAX 0.01f
 
 const static float LIGHT_INTENSITY[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
 const static float LIGHT_POSITION[4] = { 2.0f, 6.0f, 3.0f, 0.0f };
+const static float CLEAR_COLOR[4] = { 0.40f, 0.55f, 0.9f, 1.0f };
 
 const static steady_clock frame_clock;
 static steady_clock::time_point start_of_last_frame;
 static duration<float> time_since_last_frame;
 static float average_frame_rate = 0.0f;
-static float seconds_since_last_frame;
+
+// time covered by the current simulation step
+static float seconds_since_last_step;
 
 static bool is_shift_pressed = false;
 static bool is_ctrl_pressed = false;
@@ -54,10 +116,14 @@ static bool is_alt_pressed = false;
 
 static bool is_exit_pressed = false;
 
-static bool is_go_forward_pressed = false;
-static bool is_go_backward_pressed = false;
-static bool is_turn_right_pressed = false;
-static bool is_turn_left_pressed = false;
+// set by the input callbacks and read by the simulation thread
+static atomic<bool> is_screenshot_pressed(false);
+static atomic<bool> is_camera_switch_pressed(false);
+
+static atomic<bool> is_go_forward_pressed(false);
+static atomic<bool> is_go_backward_pressed(false);
+static atomic<bool> is_turn_right_pressed(false);
+static atomic<bool> is_turn_left_pressed(false);
 
 // unused key presses
 //--------------------------------------------------------------
@@ -85,10 +151,40 @@ static bool is_turn_down_pressed = false;
 
 static unsigned int keyStatus;
 
-static int fullscreen_viewport[4] = { 0, 0, INITIAL_WINDOW_WIDTH, INITIAL_WINDOW_HEIGHT };
-static int fullscreen_width = fullscreen_viewport[2] - fullscreen_viewport[0];
-static int fullscreen_height = fullscreen_viewport[3] - fullscreen_viewport[1];
-static float fullscreen_ratio_wh = (float)fullscreen_width / (float)fullscreen_height;
+// kept up to date by reshape, and read by the simulation thread for culling and screenshots
+static atomic<int> fullscreen_width(INITIAL_WINDOW_WIDTH);
+static atomic<int> fullscreen_height(INITIAL_WINDOW_HEIGHT);
+static atomic<float> fullscreen_ratio_wh((float)INITIAL_WINDOW_WIDTH / (float)INITIAL_WINDOW_HEIGHT);
+
+// set with M and read by the simulation thread, which passes it on in the snapshots
+static atomic<int> view_layout(VIEW_LAYOUT_SINGLE);
+
+// OpenGL state as last set, so that unchanged state is not set again
+static GLState gl_state;
+
+// caps the frame rate, and with is_event_driven skips frames in which nothing can have changed
+static FramePacer frame_pacer;
+static bool is_event_driven = true;
+
+// the view moved since the last snapshot, so the camera may still be settling
+static bool is_view_changing = true;
+
+// input, physics and cameras run on simulation_thread, which publishes what is drawn to world_snapshots once a step;
+// the GLUT thread only draws the latest snapshot, so neither waits on the other
+static thread simulation_thread;
+static atomic<bool> is_simulation_stopping(false);
+static TripleBuffer<WorldSnapshot> world_snapshots;
+static unsigned int published_step_count = 0;
+
+// the views as last culled, with the camera, ratio and layout each was culled for; their shape indices are unused
+static ViewSnapshot published_views[SNAPSHOT_VIEW_COUNT_MAX];
+static const Camera* published_cameras[SNAPSHOT_VIEW_COUNT_MAX];
+static float published_ratios_wh[SNAPSHOT_VIEW_COUNT_MAX];
+static int published_view_layout = -1;
+
+// index in the snapshot being built of each shape already copied into it, or NULL_SHAPE_INDEX, by level of detail and
+// then by the index of the shape in world_index; cards face the camera of their view, so they are never shared
+static vector<int> snapshot_shape_indices[LOD_IMPOSTOR];
 
 static int main_window;
 
@@ -99,6 +195,48 @@ static Camera overhead_camera;
 static vector<Shape*> rendered_shapes;
 static vector<Shape*> collideable_shapes;
 
+// the last GJK simplex of each pair of colliding shapes, which warm starts the check on the next frame
+static GjkCacheTable collision_caches;
+
+// puts shapes that stop moving to sleep until something moving touches them
+static IslandManager islands;
+
+// shapes touched by the last collision resolution
+static vector<const Shape*> touched_shapes;
+
+// spatial index over rendered_shapes used for ray and segment casts
+static SpatialIndex world_index;
+
+// view volume of the camera of each view, and the shapes of rendered_shapes found inside it when it was last culled
+static Frustum view_frustums[SNAPSHOT_VIEW_COUNT_MAX];
+static vector<const Shape*> view_visible_shapes[SNAPSHOT_VIEW_COUNT_MAX];
+
+// the level of detail of each of view_visible_shapes, chosen when the view was last culled
+static LevelOfDetail view_lods[SNAPSHOT_VIEW_COUNT_MAX];
+static vector<int> view_shape_levels[SNAPSHOT_VIEW_COUNT_MAX];
+
+// draws the shapes of each view sorted by material
+static RenderQueue render_queue;
+
+// the views after the first as last drawn
+static ViewCache view_caches[SNAPSHOT_VIEW_COUNT_MAX];
+
+// shapes drawn and shapes culled in the last frame, over all views
+static int drawn_shape_count = 0;
+static int culled_shape_count = 0;
+
+// triangles drawn in the last frame, and those the levels of detail saved
+static int drawn_triangle_count = 0;
+static int saved_triangle_count = 0;
+
+// times the stages of each step and frame, printed with F and on exit
+static Profiler profiler;
+
+// the last frames written as a trace with T, and on exit when is_trace_on_exit
+static string trace_path = DEFAULT_TRACE_PATH;
+static int trace_frame_count = DEFAULT_TRACE_FRAME_COUNT;
+static bool is_trace_on_exit = false;
+
 static Shape* main_shape;
 static Shape shape_user;
 
@@ -108,26 +246,95 @@ static Shape shape_boundary_x_negative;
 static Shape shape_boundary_z_positive;
 static Shape shape_boundary_z_negative;
 
+// threads shared by the sensors
+static WorkerPool worker_pool;
+
+// writes the frames drawn by OpenGL, or those of capture_renderer when is_capture_software, given --capture
+static FrameCapture frame_capture;
+static bool is_capture_software = false;
+
+static Lidar lidar_user;
+
+// renders screenshots without going through OpenGL
+static SoftwareRenderer software_renderer(INITIAL_WINDOW_WIDTH, INITIAL_WINDOW_HEIGHT);
+
+// renders the first view of each displayed snapshot on the CPU for --capture-software, apart from the screenshots
+// taken on the simulation thread; it has threads of its own, since parallel_for serializes its callers and the
+// simulation thread would otherwise wait for whole frames before sensing or culling
+static SoftwareRenderer capture_renderer(INITIAL_WINDOW_WIDTH, INITIAL_WINDOW_HEIGHT);
+static WorkerPool capture_worker_pool;
+
+// replaces shape_ground when a heightmap is given on the command line
+static Terrain terrain;
+static bool is_terrain_loaded = false;
+
 static Acceleration* main_acceleration;
 static Acceleration acceleration_shape_user;
 
 static float move_distance;
 
+// how far the last collision pushed the moving shape
+static float collision_push[3];
+
 void display();
+void idle();
+
+// draws the shapes of view from snapshot into viewport
+void view_draw(const WorldSnapshot& snapshot, const ViewSnapshot& view, const int viewport[4]);
+void reshape(const int width, const int height);
 void myMouse(const int button, const int state, const int x, const int y);
 void myKeyboard(unsigned char key, const int x, const int y);
 void myKeyboardUp(unsigned char key, const int x, const int y);
 void mySpecial(const int key, const int x, const int y);
 void mySpecialUp(const int key, const int x, const int y);
 
+// runs the simulation thread until simulation_stop, stepping it every SIMULATION_STEP_SECONDS
+void simulate();
+void simulation_step();
+void simulation_stop();
+
+// copies the camera and the visible shapes into the write slot of world_snapshots and publishes it, returning false
+// when nothing changed since the last one, so that nothing was published
+bool snapshot_publish();
+
+int layout_view_count(const int layout);
+
+// stores the window area of view in layout as x, y, width and height
+void layout_viewport_store(const int layout, const int view, const int width, const int height, int viewport[4]);
+
 void handle_input();
 void handle_movement();
 
-Shape* get_colliding_shape(const Shape& colliding_shape, const vector<Shape*> collideable_shapes);
+// prints the frame rate, the counts of the last frame and the time spent in each stage
+void statistics_print();
+
+// writes the stages timed over the last trace_frame_count frames on every thread to trace_path
+void trace_write();
+
+// whether the next frame can differ from the last one
+bool is_scene_changing();
+
+// draws rendered_shapes from user_camera offscreen with and without instancing and compares the pixels, returning
+// whether they match
+bool instancing_check();
+
+// submits interleaved materials and meshes to a record-only RenderQueue, without a window, and compares the state changes
+// and draws it records with the sorted order, returning whether they match
+bool render_queue_check();
+
+// pushes shape out of collideable_shapes, which must be grouped by shape type, returning whether it touched any
+bool resolve_collisions(Shape& shape, float push_store[3]);
 
 int main(int argc, char** argv) {
   string dummy;
 
+  // the render queue check needs no window, so it runs before GLUT looks for a display
+  for (int i = 1; i < argc; i++) {
+    if (string(argv[i]) == "--check-render-queue") {
+      return render_queue_check() ? 0 : 1;
+    }
+  }
+
   glutInit(&argc, argv);
 
   cout << "Welcome to Driving Simulator by Matthew Moore." << endl;
@@ -140,22 +347,91 @@ int main(int argc, char** argv) {
   cout << "Hold A or the LEFT arrow to turn left." << endl;
   cout << endl;
   cout << "Press TAB to switch between camera views." << endl;
+  cout << "Press M to cycle between one view, a minimap and a split screen." << endl;
+  cout << "Press P to save a screenshot." << endl;
+  cout << "Press F to print frame statistics." << endl;
+  cout << "Press T to save a trace of the last frames." << endl;
+  cout << endl;
+  cout << "Run with --terrain <file> to drive on a square 16-bit raw heightmap." << endl;
+  cout << "Run with --fps <rate> to cap the frame rate, or 0 for no cap." << endl;
+  cout << "Run with --continuous to draw every frame even when nothing moves." << endl;
+  cout << "Run with --capture <path> to record every frame to path.y4m, or to path_000000.png onwards." << endl;
+  cout << "Run with --capture-software to record frames rendered on the CPU instead." << endl;
+  cout << "Run with --trace <path> to save the trace to path, also on exit." << endl;
+  cout << "Run with --trace-frames <count> to set how many frames a trace covers." << endl;
+  cout << "Run with --check-instancing to compare instanced drawing with drawing one shape at a time, then exit." << endl;
+  cout << "Run with --check-render-queue to check the order the render queue draws in, then exit." << endl;
+
+  string capture_path;
+  bool is_instancing_check = false;
+
+  for (int i = 1; i < argc; i++) {
+    if (string(argv[i]) == "--fps" && i + 1 < argc) {
+      frame_pacer.set_frame_rate_max((float)atof(argv[i + 1]));
+    }
+    else if (string(argv[i]) == "--continuous") {
+      is_event_driven = false;
+    }
+    else if (string(argv[i]) == "--capture" && i + 1 < argc) {
+      capture_path = argv[i + 1];
+    }
+    else if (string(argv[i]) == "--capture-software") {
+      is_capture_software = true;
+    }
+    else if (string(argv[i]) == "--trace" && i + 1 < argc) {
+      trace_path = argv[i + 1];
+      is_trace_on_exit = true;
+    }
+    else if (string(argv[i]) == "--trace-frames" && i + 1 < argc) {
+      trace_frame_count = atoi(argv[i + 1]);
+    }
+    else if (string(argv[i]) == "--check-instancing") {
+      is_instancing_check = true;
+    }
+    // load the terrain before the world is built around it
+    else if (string(argv[i]) == "--terrain" && i + 1 < argc) {
+      is_terrain_loaded = terrain.load_raw(argv[i + 1], TERRAIN_HEIGHT_SCALE);
+
+      if (is_terrain_loaded) {
+        terrain.set_spacing(BOUNDARY_SIZE / (terrain.c_samples_x - 1));
+        terrain.set_origin(-BOUNDARY_SIZE*0.5f, 0.0f, -BOUNDARY_SIZE*0.5f);
+      }
+      else {
+        cout << "Could not load terrain from " << argv[i + 1] << endl;
+      }
+    }
+  }
+
+  // a recording keeps time, so every frame is drawn and every step published
+  if (!capture_path.empty()) {
+    if (frame_capture.open(capture_path.c_str(), (int)(frame_pacer.c_frame_rate_max + 0.5f))) {
+      is_event_driven = false;
+    }
+    else {
+      cout << "Could not capture to " << capture_path << endl;
+    }
+  }
 
   Sleep(2500);
 
   start_of_last_frame = frame_clock.now();
 
   // set up window
-  glutInitDisplayMode(GLUT_SINGLE | GLUT_RGB | GLUT_DEPTH);
+  glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB | GLUT_DEPTH);
   glutInitWindowSize(INITIAL_WINDOW_WIDTH, INITIAL_WINDOW_HEIGHT);
   glutInitWindowPosition(100, 100);
   main_window = glutCreateWindow("Driving Simulator");
 
+  // closing the window returns from glutMainLoop like ESC does, so that the simulation thread is joined either way
+  glutSetOption(GLUT_ACTION_ON_WINDOW_CLOSE, GLUT_ACTION_GLUTMAINLOOP_RETURNS);
+
   // set to fullcreen mode
   glutFullScreen();
 
   // set display and input functions
   glutDisplayFunc(display);
+  glutIdleFunc(idle);
+  glutReshapeFunc(reshape);
   glutMouseFunc(myMouse);
   glutKeyboardFunc(myKeyboard);
   glutKeyboardUpFunc(myKeyboardUp);
@@ -170,8 +446,20 @@ int main(int argc, char** argv) {
   glEnable(GL_DEPTH_TEST);
   glEnable(GL_NORMALIZE);
 
+  // draw cuboids with one call where the context allows it
+  if (!render_queue.instancing_init()) {
+    cout << "OpenGL 3.3 is unavailable, so shapes are drawn one at a time." << endl;
+    cout << endl;
+  }
+
+  // read captured frames back without waiting for them to be drawn where the context allows it
+  if (frame_capture.c_is_open && !is_capture_software && !frame_capture.readback_init()) {
+    cout << "Pixel buffer objects are unavailable, so captured frames are read back synchronously." << endl;
+    cout << endl;
+  }
+
   // set up rendering viewport
-  glViewport(0, 0, INITIAL_WINDOW_WIDTH, INITIAL_WINDOW_HEIGHT);
+  gl_state.set_viewport(0, 0, INITIAL_WINDOW_WIDTH, INITIAL_WINDOW_HEIGHT);
 
   // initialize the main camera
   main_camera = &user_camera;
@@ -196,12 +484,15 @@ int main(int argc, char** argv) {
   shape_user.set_scale(1.75f, 0.75f, 3.0f);
   rendered_shapes.push_back(&shape_user);
   collideable_shapes.push_back(&shape_user);
+  islands.add_body(&shape_user, &acceleration_shape_user);
 
   // initialize shape_ground
   shape_ground.set_color(COLOR_GRASS_GREEN);
   shape_ground.translate(0.0f, -GROUND_THICKNESS*0.5f, 0.0f);
   shape_ground.set_scale(BOUNDARY_SIZE, GROUND_THICKNESS, BOUNDARY_SIZE);
-  rendered_shapes.push_back(&shape_ground);
+  if (!is_terrain_loaded) {
+    rendered_shapes.push_back(&shape_ground);
+  }
 
   // initialize shape_boundary_x_positive
   shape_boundary_x_positive.set_color(COLOR_WALL_GREY);
@@ -231,72 +522,471 @@ int main(int argc, char** argv) {
   rendered_shapes.push_back(&shape_boundary_z_negative);
   collideable_shapes.push_back(&shape_boundary_z_negative);
 
-  // start rendering loop
+  // group collideable_shapes by type so that each collision check picks a kernel once per group
+  stable_sort(collideable_shapes.begin(), collideable_shapes.end(), [](const Shape* shape_a, const Shape* shape_b) {
+    return shape_a->c_shape_type < shape_b->c_shape_type;
+  });
+
+  // index every shape in the world
+  world_index.build(rendered_shapes);
+
+  // the snapshot indices are kept by the index of each shape in world_index, so they never grow
+  for (int level = 0; level < LOD_IMPOSTOR; level++) {
+    snapshot_shape_indices[level].assign(world_index.c_shape_count, NULL_SHAPE_INDEX);
+  }
+
+  // mount lidar_user on the roof of shape_user
+  lidar_user.attach(&shape_user);
+  lidar_user.set_offset(0.0f, LIDAR_MOUNT_HEIGHT, 0.0f);
+  if (is_terrain_loaded) {
+    lidar_user.set_terrain(&terrain);
+  }
+
+  // match the software renderer to the OpenGL view
+  software_renderer.set_perspective(FIELD_OF_VIEW_Y, NEAR_DISTANCE, FAR_DISTANCE);
+  software_renderer.set_clear_color(CLEAR_COLOR);
+  software_renderer.set_light(LIGHT_POSITION, LIGHT_INTENSITY);
+
+  capture_renderer.set_perspective(FIELD_OF_VIEW_Y, NEAR_DISTANCE, FAR_DISTANCE);
+  capture_renderer.set_clear_color(CLEAR_COLOR);
+  capture_renderer.set_light(LIGHT_POSITION, LIGHT_INTENSITY);
+
+  // the check draws the world as it was built, so it needs neither thread
+  if (is_instancing_check) {
+    return instancing_check() ? 0 : 1;
+  }
+
+  // start the simulation, then the rendering loop
+  profiler.set_thread_name("render");
+  worker_pool.set_profiler(&profiler);
+
+  simulation_thread = thread(simulate);
   glutMainLoop();
 
+  simulation_stop();
+  statistics_print();
+
+  if (is_trace_on_exit) {
+    trace_write();
+  }
+
+  if (frame_capture.c_is_open) {
+    frame_capture.close();
+    cout << "Captured " << frame_capture.c_frame_count << " frames, waiting for the encoder " << frame_capture.c_stall_count
+      << " times and dropping " << frame_capture.c_drop_count << " frames" << endl;
+  }
+
   return 0;
 }
 
 void display() {
-  if (is_exit_pressed) {
-    exit(NOERROR);
-  }
+  ProfileTimer frame_timer(profiler, PROFILE_STAGE_FRAME);
 
   // update frame rate statistics
   time_since_last_frame = frame_clock.now() - start_of_last_frame;
-  seconds_since_last_frame = time_since_last_frame.count();
   average_frame_rate = average_frame_rate*0.7f + (1.0f / time_since_last_frame.count())*0.3f;
   start_of_last_frame = frame_clock.now();
 
-  handle_input();
-  handle_movement();
+  // the snapshot stays the same until idle takes a newer one
+  const WorldSnapshot& snapshot = world_snapshots.read_slot();
+
+  const int width = fullscreen_width;
+  const int height = fullscreen_height;
+  int viewport[4];
+
+  drawn_shape_count = 0;
+  culled_shape_count = 0;
+  drawn_triangle_count = 0;
+  saved_triangle_count = 0;
 
-  // set user_camera
-  user_camera.set_target(main_shape->c_position);
-  user_camera.set_distance(15.0f);
-  user_camera.revolve_horizontal_from_vector(0.0f, main_shape->c_vector_forward);
-  user_camera.revolve_vertical_from_vector(-PI/32.0f, main_shape->c_vector_forward);
-  user_camera.translate(0.0f, 2.0f, 0.0f);
+  gl_state.set_clear_color(CLEAR_COLOR);
 
-  // set overhead_camera
-  overhead_camera.translate_to(shape_user.c_position_x, overhead_camera.c_position_y, shape_user.c_position_z);
-  overhead_camera.set_angle_horizontal(shape_user.c_angle_horizontal);
+  // nothing to draw before the first step
+  if (snapshot.step == 0) {
+    gl_state.set_viewport(0, 0, width, height);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+  }
 
-  __update_fullscreen_dimensions();
+  // views can overlap, so each only clears its own part of the window
+  {
+    ProfileTimer render_timer(profiler, PROFILE_STAGE_RENDER);
 
-  glLightfv(GL_LIGHT0, GL_POSITION, LIGHT_POSITION);
-  glLightfv(GL_LIGHT0, GL_DIFFUSE, LIGHT_INTENSITY);
+    glEnable(GL_SCISSOR_TEST);
+    for (int v = 0; v < snapshot.view_count; v++) {
+      const ViewSnapshot& view = snapshot.views[v];
 
-  glMatrixMode(GL_PROJECTION);
-  glLoadIdentity();
+      layout_viewport_store(snapshot.view_layout, v, width, height, viewport);
+      gl_state.set_viewport(viewport[0], viewport[1], viewport[2], viewport[3]);
 
-  gluPerspective(30.0, fullscreen_ratio_wh, 0.1, (double)BOUNDARY_SIZE*2.0);
+      // views after the first are shown from their copy until they are culled again
+      if (v > 0 && view_caches[v].is_current(viewport, view.step)) {
+        view_caches[v].draw(gl_state);
+        continue;
+      }
 
-  glMatrixMode(GL_MODELVIEW);
-  glLoadIdentity();
+      glScissor(viewport[0], viewport[1], viewport[2], viewport[3]);
+      glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-  glClearColor(0.40f, 0.55f, 0.9f, 1.0f);
-  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+      view_draw(snapshot, view, viewport);
 
-  // set the camera
-  gluLookAt(
-    main_camera->c_position_x, main_camera->c_position_y, main_camera->c_position_z
-    , main_camera->c_target_x, main_camera->c_target_y, main_camera->c_target_z
-    , main_camera->c_vector_up_roll_x, main_camera->c_vector_up_roll_y, main_camera->c_vector_up_roll_z
-    );
+      if (v > 0) {
+        view_caches[v].capture(viewport, view.step);
+      }
+    }
+    glDisable(GL_SCISSOR_TEST);
+  }
 
-  for (size_t i = 0; i < rendered_shapes.size(); i++) {
-    rendered_shapes[i]->draw_GLUT();
+  if (frame_capture.c_is_open && !is_capture_software) {
+    frame_capture.read_framebuffer(width, height);
+  }
+
+  // render the snapshot on the CPU as well when recording it, dropping the frame rather than waiting for the encoder
+  if (frame_capture.c_is_open && is_capture_software && snapshot.step != 0 && snapshot.view_count > 0) {
+    if (capture_renderer.c_width != width || capture_renderer.c_height != height) {
+      capture_renderer.resize(width, height);
+    }
+
+    capture_renderer.render(snapshot, snapshot.views[0], capture_worker_pool);
+    frame_capture.try_submit(capture_renderer.c_color_buffer.data(), capture_renderer.c_width, capture_renderer.c_height);
   }
 
   // finish drawing and swap buffers for efficient display
   //   (implicit glFlush())
+  const steady_clock::time_point start_of_swap = frame_clock.now();
   glutSwapBuffers();
 
+  const float swap_seconds = duration<float>(frame_clock.now() - start_of_swap).count();
+  frame_pacer.swap_record(swap_seconds);
+  profiler.record(PROFILE_STAGE_SWAP, start_of_swap, swap_seconds);
+}
+
+void view_draw(const WorldSnapshot& snapshot, const ViewSnapshot& view, const int viewport[4]) {
+  float projection[16];
+  float view_matrix[16];
+
+  perspectiveM4(FIELD_OF_VIEW_Y, (float)viewport[2] / (float)viewport[3], NEAR_DISTANCE, FAR_DISTANCE, projection);
+  gl_state.set_projection(projection);
+
+  // set the camera
+  look_atM4(view.camera_position, view.camera_target, view.camera_vector_up, view_matrix);
+  gl_state.set_modelview(view_matrix);
+
+  // the light is fixed in the world, so it follows the view
+  gl_state.set_light(0, LIGHT_POSITION, LIGHT_INTENSITY);
+
+  // the snapshot only holds the shapes that some camera can see
+  render_queue.clear();
+  for (size_t i = 0; i < view.shape_indices.size(); i++) {
+    const ShapeSnapshot& shape = snapshot.shapes[view.shape_indices[i]];
+
+    render_queue.add(*shape.shape, shape.model, shape.color, shape.reflectance, shape.shininess);
+  }
+  render_queue.submit(gl_state);
+
+  if (is_terrain_loaded) {
+    terrain.draw_GLUT();
+    gl_state.invalidate_material();
+  }
+
+  drawn_shape_count += (int)view.shape_indices.size();
+  culled_shape_count += view.culled_shape_count;
+  drawn_triangle_count += view.triangle_count;
+  saved_triangle_count += view.saved_triangle_count;
+}
+
+void idle() {
+  // main stops the simulation and saves what it must once glutMainLoop returns
+  if (is_exit_pressed) {
+    glutLeaveMainLoop();
+    return;
+  }
+
+  frame_pacer.wait();
+
+  // the simulation only publishes when something changed, unless is_event_driven is off
+  if (!world_snapshots.read_update() && is_event_driven) {
+    return;
+  }
+
   // continue drawing
   glutPostRedisplay();
 }
 
+void simulate() {
+  const steady_clock::duration step_duration = duration_cast<steady_clock::duration>(duration<float>(SIMULATION_STEP_SECONDS));
+
+  profiler.set_thread_name("simulation");
+
+  steady_clock::time_point start_of_last_step = frame_clock.now();
+  steady_clock::time_point next_step = start_of_last_step;
+
+  while (!is_simulation_stopping) {
+    next_step += step_duration;
+
+    // skip the steps already missed rather than running them back to back
+    const steady_clock::time_point now = frame_clock.now();
+    if (next_step < now) {
+      next_step = now;
+    }
+    this_thread::sleep_until(next_step);
+
+    const steady_clock::time_point start_of_step = frame_clock.now();
+    seconds_since_last_step = duration<float>(start_of_step - start_of_last_step).count();
+    start_of_last_step = start_of_step;
+
+    simulation_step();
+  }
+}
+
+void simulation_step() {
+  ProfileTimer step_timer(profiler, PROFILE_STAGE_STEP);
+
+  if (is_camera_switch_pressed.exchange(false)) {
+    if (main_camera == &user_camera) {
+      main_camera = &overhead_camera;
+    }
+    else {
+      main_camera = &user_camera;
+    }
+  }
+
+  handle_input();
+  handle_movement();
+
+  islands.update();
+  if (!islands.is_sleeping(&shape_user)) {
+    world_index.update_shape(&shape_user);
+  }
+
+  lidar_user.update(seconds_since_last_step, world_index, worker_pool);
+
+  {
+    ProfileTimer camera_timer(profiler, PROFILE_STAGE_CAMERA);
+
+    // set user_camera
+    user_camera.follow(*main_shape, CAMERA_FOLLOW_DISTANCE, CAMERA_FOLLOW_ANGLE_DOWN, CAMERA_FOLLOW_HEIGHT, seconds_since_last_step, CAMERA_FOLLOW_SMOOTH_TIME);
+
+    // set overhead_camera
+    overhead_camera.translate_to(shape_user.c_position_x, overhead_camera.c_position_y, shape_user.c_position_z);
+    overhead_camera.set_angle_horizontal(shape_user.c_angle_horizontal);
+  }
+
+  // render the same view on the CPU and save it
+  if (is_screenshot_pressed.exchange(false)) {
+    software_renderer.resize(fullscreen_width, fullscreen_height);
+    software_renderer.render(rendered_shapes, *main_camera, worker_pool);
+
+    if (software_renderer.write_ppm(SCREENSHOT_PATH)) {
+      cout << "Saved " << SCREENSHOT_PATH << endl;
+    }
+  }
+
+  snapshot_publish();
+}
+
+void simulation_stop() {
+  is_simulation_stopping = true;
+  if (simulation_thread.joinable()) {
+    simulation_thread.join();
+  }
+}
+
+bool snapshot_publish() {
+  const int layout = view_layout;
+  const int view_count = layout_view_count(layout);
+  const int width = fullscreen_width;
+  const int height = fullscreen_height;
+  const unsigned int step = published_step_count + 1;
+
+  // the first view is always main_camera, and the second the other camera
+  const Camera* view_cameras[SNAPSHOT_VIEW_COUNT_MAX] = { main_camera, main_camera == &user_camera ? &overhead_camera : &user_camera };
+
+  float view_ratios_wh[SNAPSHOT_VIEW_COUNT_MAX];
+  int view_heights[SNAPSHOT_VIEW_COUNT_MAX];
+  int due_views[SNAPSHOT_VIEW_COUNT_MAX];
+  int due_view_count = 0;
+  int viewport[4];
+
+  is_view_changing = false;
+
+  for (int v = 0; v < view_count; v++) {
+    const Camera& camera = *view_cameras[v];
+    const ViewSnapshot& view = published_views[v];
+
+    layout_viewport_store(layout, v, width, height, viewport);
+    view_ratios_wh[v] = (float)viewport[2] / (float)viewport[3];
+    view_heights[v] = viewport[3];
+
+    const bool is_rearranged = layout != published_view_layout
+      || view_cameras[v] != published_cameras[v]
+      || view_ratios_wh[v] != published_ratios_wh[v];
+
+    if (v > 0 && !is_rearranged && step - view.step < SECONDARY_VIEW_STEP_INTERVAL) {
+      continue;
+    }
+    due_views[due_view_count++] = v;
+
+    // the view changed when it was rearranged or its camera moved
+    if (is_rearranged
+      || __distanceV3(camera.c_position, view.camera_position) > VIEW_CHANGE_EPSILON
+      || __distanceV3(camera.c_target, view.camera_target) > VIEW_CHANGE_EPSILON
+      || __distanceV3(camera.c_vector_up_roll, view.camera_vector_up) > VIEW_CHANGE_EPSILON
+      )
+    {
+      is_view_changing = true;
+    }
+  }
+
+  if (is_event_driven && !is_scene_changing()) {
+    return false;
+  }
+
+  for (int i = 0; i < due_view_count; i++) {
+    const int v = due_views[i];
+    const Camera& camera = *view_cameras[v];
+    ViewSnapshot& view = published_views[v];
+
+    view.step = step;
+    __vector_element_assign_opV3(view.camera_position, =, camera.c_position);
+    __vector_element_assign_opV3(view.camera_target, =, camera.c_target);
+    __vector_element_assign_opV3(view.camera_vector_up, =, camera.c_vector_up_roll);
+
+    published_cameras[v] = view_cameras[v];
+    published_ratios_wh[v] = view_ratios_wh[v];
+
+    view_frustums[v].set(camera, FIELD_OF_VIEW_Y, view_ratios_wh[v], NEAR_DISTANCE, FAR_DISTANCE);
+  }
+  published_view_layout = layout;
+
+  {
+    ProfileTimer culling_timer(profiler, PROFILE_STAGE_CULLING);
+
+    // each view only reads the index, so they are culled in parallel
+    worker_pool.parallel_for(due_view_count, 1, [&](const int begin, const int end) {
+      for (int i = begin; i < end; i++) {
+        const int v = due_views[i];
+
+        published_views[v].culled_shape_count = world_index.query_frustum(view_frustums[v], view_visible_shapes[v]);
+      }
+    });
+
+    // the bounds of shapes are cached on first use, so the levels are chosen one view after another
+    for (int i = 0; i < due_view_count; i++) {
+      const int v = due_views[i];
+      ViewSnapshot& view = published_views[v];
+
+      view_lods[v].select(view.camera_position, FIELD_OF_VIEW_Y, view_heights[v], view_visible_shapes[v], view_shape_levels[v]);
+      view.triangle_count = view_lods[v].c_triangle_count;
+      view.saved_triangle_count = view_lods[v].c_saved_triangle_count;
+    }
+  }
+
+  WorldSnapshot& snapshot = world_snapshots.write_slot();
+
+  snapshot.view_layout = layout;
+  snapshot.view_count = view_count;
+
+  // the slot keeps its vectors from three publishes ago, so this only allocates while the counts grow
+  snapshot.shapes.clear();
+  for (int level = 0; level < LOD_IMPOSTOR; level++) {
+    fill(snapshot_shape_indices[level].begin(), snapshot_shape_indices[level].end(), NULL_SHAPE_INDEX);
+  }
+
+  for (int v = 0; v < view_count; v++) {
+    const ViewSnapshot& published = published_views[v];
+    const vector<const Shape*>& visible_shapes = view_visible_shapes[v];
+    ViewSnapshot& view = snapshot.views[v];
+
+    view.step = published.step;
+    __vector_element_assign_opV3(view.camera_position, =, published.camera_position);
+    __vector_element_assign_opV3(view.camera_target, =, published.camera_target);
+    __vector_element_assign_opV3(view.camera_vector_up, =, published.camera_vector_up);
+    view.culled_shape_count = published.culled_shape_count;
+    view.triangle_count = published.triangle_count;
+    view.saved_triangle_count = published.saved_triangle_count;
+
+    // shapes seen by more than one view at the same level are copied once and shared by index
+    view.shape_indices.clear();
+    for (size_t i = 0; i < visible_shapes.size(); i++) {
+      const Shape& shape = *visible_shapes[i];
+      const int level = view_shape_levels[v][i];
+
+      if (level == LOD_SKIP) {
+        continue;
+      }
+
+      if (level < LOD_IMPOSTOR) {
+        int& snapshot_index = snapshot_shape_indices[level][world_index.shape_index(&shape)];
+
+        if (snapshot_index != NULL_SHAPE_INDEX) {
+          view.shape_indices.push_back(snapshot_index);
+          continue;
+        }
+        snapshot_index = (int)snapshot.shapes.size();
+      }
+
+      ShapeSnapshot shape_snapshot;
+
+      shape_snapshot.shape = view_lods[v].proxy_store(shape, level, published.camera_position, shape_snapshot.model);
+      copy(shape.c_color, shape.c_color + 4, shape_snapshot.color);
+      copy(shape.c_reflectance, shape.c_reflectance + 4, shape_snapshot.reflectance);
+      shape_snapshot.shininess = shape.c_shininess;
+
+      view.shape_indices.push_back((int)snapshot.shapes.size());
+      snapshot.shapes.push_back(shape_snapshot);
+    }
+  }
+
+  snapshot.step = ++published_step_count;
+  world_snapshots.publish();
+  return true;
+}
+
+int layout_view_count(const int layout) {
+  return layout == VIEW_LAYOUT_SINGLE ? 1 : 2;
+}
+
+void layout_viewport_store(const int layout, const int view, const int width, const int height, int viewport[4]) {
+  int size;
+
+  viewport[0] = 0;
+  viewport[1] = 0;
+  viewport[2] = width;
+  viewport[3] = height;
+
+  if (view == 0 && layout != VIEW_LAYOUT_SPLIT) {
+    return;
+  }
+
+  switch (layout) {
+  case VIEW_LAYOUT_MINIMAP:
+    // a square in the top right corner
+    size = max((int)(height*MINIMAP_SIZE), 1);
+    viewport[0] = max(width - size - MINIMAP_MARGIN, 0);
+    viewport[1] = max(height - size - MINIMAP_MARGIN, 0);
+    viewport[2] = size;
+    viewport[3] = size;
+    break;
+  case VIEW_LAYOUT_SPLIT:
+    viewport[2] = max(width / 2, 1);
+    if (view == 1) {
+      viewport[0] = viewport[2];
+      viewport[2] = max(width - viewport[2], 1);
+    }
+    break;
+  default:
+    break;
+  }
+}
+
+void reshape(const int width, const int height) {
+  fullscreen_width = width;
+  fullscreen_height = height > 0 ? height : 1;
+  fullscreen_ratio_wh = (float)fullscreen_width / (float)fullscreen_height;
+
+  gl_state.set_viewport(0, 0, fullscreen_width, fullscreen_height);
+}
+
 void myMouse(const int button, const int state, const int x, const int y) {
   switch (button) {
   default:
@@ -331,13 +1021,24 @@ void myKeyboard(unsigned char key, const int x, const int y) {
   case 'S':
     is_go_backward_pressed = true;
     break;
+  case 'p':
+  case 'P':
+    is_screenshot_pressed = true;
+    break;
   case '\t':
-    if (main_camera == &user_camera) {
-      main_camera = &overhead_camera;
-    }
-    else {
-      main_camera = &user_camera;
-    }
+    is_camera_switch_pressed = true;
+    break;
+  case 'm':
+  case 'M':
+    view_layout = (view_layout + 1) % VIEW_LAYOUT_COUNT;
+    break;
+  case 'f':
+  case 'F':
+    statistics_print();
+    break;
+  case 't':
+  case 'T':
+    trace_write();
     break;
   default:
     break;
@@ -423,19 +1124,21 @@ void mySpecialUp(const int key, const int x, const int y) {
   }
 }
 
-Shape* get_colliding_shape(const Shape& colliding_shape, const vector<Shape*> collideable_shapes) {
-  for (size_t i = 0; i < collideable_shapes.size(); i++) {
-    if (&colliding_shape != collideable_shapes[i]) {
-      if (colliding_shape.is_shape_inside(*collideable_shapes[i])) {
-        return collideable_shapes[i];
-      }
-    }
+bool resolve_collisions(Shape& shape, float push_store[3]) {
+  touched_shapes.clear();
+  if (resolve_contacts(shape, collideable_shapes, push_store, &collision_caches, &touched_shapes) == 0) {
+    return false;
   }
 
-  return NULL_SHAPE_PTR;
+  for (size_t i = 0; i < touched_shapes.size(); i++) {
+    islands.touch(&shape, touched_shapes[i]);
+  }
+  return true;
 }
 
 void handle_input() {
+  ProfileTimer input_timer(profiler, PROFILE_STAGE_INPUT);
+
   // is_camera_move_right_pressed
   // is_camera_move_left_pressed
   // is_camera_move_up_pressed
@@ -465,22 +1168,22 @@ void handle_input() {
   if (is_camera_move_right_pressed == is_camera_move_left_pressed) {
   }
   else if (is_camera_move_right_pressed) {
-    main_camera->move(-10.0f*seconds_since_last_frame, 0.0f, 0.0f);
+    main_camera->move(-10.0f*seconds_since_last_step, 0.0f, 0.0f);
   }
   else {
-    main_camera->move(10.0f*seconds_since_last_frame, 0.0f, 0.0f);
+    main_camera->move(10.0f*seconds_since_last_step, 0.0f, 0.0f);
   }
 
   // vertical camera movement
   if (is_camera_move_up_pressed == is_camera_move_down_pressed) {
   }
   else if (is_camera_move_up_pressed) {
-    main_camera->move(0.0f, 10.0f*seconds_since_last_frame, 0.0f);
+    main_camera->move(0.0f, 10.0f*seconds_since_last_step, 0.0f);
   }
   else {
-    main_camera->move(0.0f, -10.0f*seconds_since_last_frame, 0.0f);
+    main_camera->move(0.0f, -10.0f*seconds_since_last_step, 0.0f);
     if (main_camera->c_position_y < CAMERA_Y_MIN) {
-      main_camera->move(0.0f, 10.0f*seconds_since_last_frame, 0.0f);
+      main_camera->move(0.0f, 10.0f*seconds_since_last_step, 0.0f);
     }
   }
 
@@ -488,35 +1191,35 @@ void handle_input() {
   if (is_camera_revolve_right_pressed == is_camera_revolve_left_pressed) {
   }
   else if (is_camera_revolve_right_pressed) {
-    main_camera->revolve_horizontal(-2.0f*seconds_since_last_frame);
+    main_camera->revolve_horizontal(-2.0f*seconds_since_last_step);
   }
   else {
-    main_camera->revolve_horizontal(2.0f*seconds_since_last_frame);
+    main_camera->revolve_horizontal(2.0f*seconds_since_last_step);
   }
 
   // vertical camera revolution
   if (is_camera_revolve_up_pressed == is_camera_revolve_down_pressed) {
   }
   else if (is_camera_revolve_up_pressed) {
-    main_camera->revolve_vertical(2.0f*seconds_since_last_frame);
+    main_camera->revolve_vertical(2.0f*seconds_since_last_step);
     if (main_camera->c_position_y < CAMERA_Y_MIN) {
-      main_camera->revolve_vertical(-2.0f*seconds_since_last_frame);
+      main_camera->revolve_vertical(-2.0f*seconds_since_last_step);
     }
   }
   else {
-    main_camera->revolve_vertical(-2.0f*seconds_since_last_frame);
+    main_camera->revolve_vertical(-2.0f*seconds_since_last_step);
   }
 
   // camera zoom
   if (is_camera_zoom_in_pressed == is_camera_zoom_out_pressed) {
   }
   else if (is_camera_zoom_in_pressed) {
-    main_camera->zoom_distance(55.0f*seconds_since_last_frame);
+    main_camera->zoom_distance(55.0f*seconds_since_last_step);
   }
   else {
-    main_camera->zoom_distance(-55.0f*seconds_since_last_frame);
+    main_camera->zoom_distance(-55.0f*seconds_since_last_step);
     if (main_camera->c_position_y < CAMERA_Y_MIN) {
-      main_camera->zoom_distance(55.0f*seconds_since_last_frame);
+      main_camera->zoom_distance(55.0f*seconds_since_last_step);
     }
   }
 
@@ -524,30 +1227,30 @@ void handle_input() {
   if (is_translate_x_positive_pressed == is_translate_x_negative_pressed) {
   }
   else if (is_translate_x_positive_pressed) {
-    main_shape->translate(5.0f*seconds_since_last_frame, 0.0f, 0.0f);
+    main_shape->translate(5.0f*seconds_since_last_step, 0.0f, 0.0f);
   }
   else {
-    main_shape->translate(-5.0f*seconds_since_last_frame, 0.0f, 0.0f);
+    main_shape->translate(-5.0f*seconds_since_last_step, 0.0f, 0.0f);
   }
 
   // translate y
   if (is_translate_y_positive_pressed == is_translate_y_negative_pressed) {
   }
   else if (is_translate_y_positive_pressed) {
-    main_shape->translate(0.0f, 5.0f*seconds_since_last_frame, 0.0f);
+    main_shape->translate(0.0f, 5.0f*seconds_since_last_step, 0.0f);
   }
   else {
-    main_shape->translate(0.0f, -5.0f*seconds_since_last_frame, 0.0f);
+    main_shape->translate(0.0f, -5.0f*seconds_since_last_step, 0.0f);
   }
 
   // translate z
   if (is_translate_z_positive_pressed == is_translate_z_negative_pressed) {
   }
   else if (is_translate_z_positive_pressed) {
-    main_shape->translate(0.0f, 0.0f, 5.0f*seconds_since_last_frame);
+    main_shape->translate(0.0f, 0.0f, 5.0f*seconds_since_last_step);
   }
   else {
-    main_shape->translate(0.0f, 0.0f, -5.0f*seconds_since_last_frame);
+    main_shape->translate(0.0f, 0.0f, -5.0f*seconds_since_last_step);
   }
 
   // movement
@@ -566,16 +1269,12 @@ void handle_input() {
     if (is_turn_right_pressed == is_turn_left_pressed) {
     }
     else if (is_turn_right_pressed) {
-      main_shape->rotate_horizontal(1.0f*seconds_since_last_frame);
-      if (get_colliding_shape(*main_shape, collideable_shapes) != NULL_SHAPE_PTR) {
-        main_shape->rotate_horizontal(-1.0f*seconds_since_last_frame);
-      }
+      main_shape->rotate_horizontal(1.0f*seconds_since_last_step);
+      resolve_collisions(*main_shape, collision_push);
     }
     else {
-      main_shape->rotate_horizontal(-1.0f*seconds_since_last_frame);
-      if (get_colliding_shape(*main_shape, collideable_shapes) != NULL_SHAPE_PTR) {
-        main_shape->rotate_horizontal(1.0f*seconds_since_last_frame);
-      }
+      main_shape->rotate_horizontal(-1.0f*seconds_since_last_step);
+      resolve_collisions(*main_shape, collision_push);
     }
   }
 
@@ -583,18 +1282,166 @@ void handle_input() {
   if (is_turn_up_pressed == is_turn_down_pressed) {
   }
   else if (is_turn_up_pressed) {
-    main_shape->rotate_vertical(-2.0f*seconds_since_last_frame);
+    main_shape->rotate_vertical(-2.0f*seconds_since_last_step);
+  }
+  else {
+    main_shape->rotate_vertical(2.0f*seconds_since_last_step);
+  }
+}
+
+bool is_scene_changing() {
+  return is_go_forward_pressed || is_go_backward_pressed || is_turn_right_pressed || is_turn_left_pressed
+    || !islands.is_sleeping(&shape_user)
+    || is_view_changing;
+}
+
+bool instancing_check() {
+  float projection[16];
+  float view_matrix[16];
+
+  perspectiveM4(FIELD_OF_VIEW_Y, (float)INITIAL_WINDOW_WIDTH / (float)INITIAL_WINDOW_HEIGHT, NEAR_DISTANCE, FAR_DISTANCE, projection);
+  gl_state.set_projection(projection);
+
+  look_atM4(user_camera.c_position, user_camera.c_target, user_camera.c_vector_up_roll, view_matrix);
+  gl_state.set_modelview(view_matrix);
+
+  gl_state.set_light(0, LIGHT_POSITION, LIGHT_INTENSITY);
+  gl_state.set_clear_color(CLEAR_COLOR);
+
+  render_queue.clear();
+  for (size_t i = 0; i < rendered_shapes.size(); i++) {
+    render_queue.add(*rendered_shapes[i]);
+  }
+
+  const int difference = render_queue.instancing_difference(gl_state, INITIAL_WINDOW_WIDTH, INITIAL_WINDOW_HEIGHT);
+  const int pixel_count = INITIAL_WINDOW_WIDTH*INITIAL_WINDOW_HEIGHT;
+
+  if (difference < 0) {
+    cout << "Could not check instancing, since OpenGL 3.3 is unavailable" << endl;
+    return false;
+  }
+
+  cout << "Instanced drawing differs from drawing one shape at a time in " << difference << " of " << pixel_count << " pixels" << endl;
+  return difference <= pixel_count*INSTANCING_CHECK_DIFFERENCE_MAX;
+}
+
+bool render_queue_check() {
+  const float color_red[4] = { 1.0f, 0.0f, 0.0f, 1.0f };
+  const float color_blue[4] = { 0.0f, 0.0f, 1.0f, 1.0f };
+
+  // materials and meshes alternate, so that only the sort brings each pair together
+  Shape shapes[5] = { Shape(SHAPE_TYPE_SPHERE), Shape(SHAPE_TYPE_CUBOID), Shape(SHAPE_TYPE_SPHERE), Shape(SHAPE_TYPE_CUBOID),
+    Shape(SHAPE_TYPE_SPHERE) };
+  const float* colors[5] = { color_red, color_blue, color_blue, color_red, color_red };
+
+  // red is material 0 and blue 1, spheres are mesh 0 and cuboids 1, each as first added
+  const int material_keys[5] = { 0, 1, 1, 0, 0 };
+  const int mesh_keys[5] = { 0, 1, 0, 1, 0 };
+
+  // one shape at a time, sorted by material and then mesh with ties in the order added
+  const vector<RenderRecord> records_immediate = {
+    { RENDER_RECORD_MATERIAL, 0 }, { RENDER_RECORD_MESH, 0 }, { RENDER_RECORD_DRAW, 0 }, { RENDER_RECORD_DRAW, 4 },
+    { RENDER_RECORD_MESH, 1 }, { RENDER_RECORD_DRAW, 3 },
+    { RENDER_RECORD_MATERIAL, 1 }, { RENDER_RECORD_MESH, 0 }, { RENDER_RECORD_DRAW, 2 },
+    { RENDER_RECORD_MESH, 1 }, { RENDER_RECORD_DRAW, 1 }
+  };
+
+  // instanced, the cuboids leave the sequence for one draw at the end, so the second sphere needs no mesh change
+  const vector<RenderRecord> records_instanced = {
+    { RENDER_RECORD_MATERIAL, 0 }, { RENDER_RECORD_MESH, 0 }, { RENDER_RECORD_DRAW, 0 }, { RENDER_RECORD_DRAW, 4 },
+    { RENDER_RECORD_MATERIAL, 1 }, { RENDER_RECORD_DRAW, 2 },
+    { RENDER_RECORD_INSTANCES, 2 }
+  };
+
+  RenderQueue queue(true);
+  GLState state;
+  bool is_matching = true;
+
+  for (int i = 0; i < 5; i++) {
+    shapes[i].set_color(colors[i]);
+    queue.add(shapes[i]);
+
+    if (queue.material_key(i) != material_keys[i] || queue.mesh_key(i) != mesh_keys[i]) {
+      cout << "Render queue gave shape " << i << " material " << queue.material_key(i) << " and mesh " << queue.mesh_key(i)
+        << " instead of " << material_keys[i] << " and " << mesh_keys[i] << endl;
+      is_matching = false;
+    }
+  }
+
+  if (queue.c_material_count != 2 || queue.c_mesh_count != 2) {
+    cout << "Render queue found " << queue.c_material_count << " materials and " << queue.c_mesh_count << " meshes instead of 2 of each" << endl;
+    is_matching = false;
+  }
+
+  for (int pass = 0; pass < 2; pass++) {
+    const vector<RenderRecord>& records = pass == 0 ? records_immediate : records_instanced;
+    const char* pass_name = pass == 0 ? "one shape at a time" : "instanced";
+
+    // in record-only mode this needs no context
+    if (pass == 1) {
+      queue.instancing_init();
+    }
+
+    queue.submit(state);
+
+    bool is_pass_matching = queue.c_records.size() == records.size();
+    for (size_t i = 0; is_pass_matching && i < records.size(); i++) {
+      is_pass_matching = queue.c_records[i].type == records[i].type && queue.c_records[i].key == records[i].key;
+    }
+
+    cout << "Render queue " << (is_pass_matching ? "drew" : "did not draw") << " in the expected order " << pass_name << endl;
+    is_matching = is_matching && is_pass_matching;
+  }
+
+  return is_matching;
+}
+
+void statistics_print() {
+  cout << "Frame rate " << average_frame_rate << ", drew " << drawn_shape_count << " shapes and culled " << culled_shape_count
+    << ", drew " << drawn_triangle_count << " triangles and saved " << saved_triangle_count << endl;
+  profiler.report(cout);
+}
+
+void trace_write() {
+  if (profiler.write_trace(trace_path.c_str(), trace_frame_count)) {
+    cout << "Saved " << trace_path << endl;
   }
   else {
-    main_shape->rotate_vertical(2.0f*seconds_since_last_frame);
+    cout << "Could not write " << trace_path << endl;
   }
 }
 
 void handle_movement() {
-  move_distance = acceleration_shape_user.accelerate(seconds_since_last_frame)*seconds_since_last_frame;
+  ProfileTimer movement_timer(profiler, PROFILE_STAGE_MOVEMENT);
+
+  // pressing a pedal wakes shape_user, which otherwise stays where it parked
+  if (acceleration_shape_user.c_acceleration_current != 0.0f) {
+    islands.wake(&shape_user);
+  }
+  if (islands.is_sleeping(&shape_user)) {
+    return;
+  }
+
+  move_distance = acceleration_shape_user.accelerate(seconds_since_last_step)*seconds_since_last_step;
   shape_user.move(0.0f, 0.0f, move_distance);
-  if (get_colliding_shape(shape_user, collideable_shapes) != NULL_SHAPE_PTR) {
-    shape_user.move(0.0f, 0.0f, -move_distance);
-    acceleration_shape_user.set_velocity(0.0f);
+
+  // rest shape_user on the terrain
+  if (is_terrain_loaded && terrain.is_above(shape_user.c_position_x, shape_user.c_position_z)) {
+    shape_user.translate_to(
+      shape_user.c_position_x
+      , terrain.height_at(shape_user.c_position_x, shape_user.c_position_z) + shape_user.c_scale_y*0.5f
+      , shape_user.c_position_z
+      );
+  }
+
+  // slide along whatever was hit, keeping only the part of the velocity along it
+  if (resolve_collisions(shape_user, collision_push)) {
+    collision_push[DIM_Y] = 0.0f;
+    if (__dot_productV3(collision_push, collision_push) > 0.0f) {
+      normalizeV3(collision_push);
+      acceleration_shape_user.set_velocity(
+        acceleration_shape_user.c_velocity*(1.0f - fabsf(__dot_productV3(collision_push, shape_user.c_vector_forward)))
+        );
+    }
   }
 }
@@ -0,0 +1,75 @@
+#include "matrix4.h"
+
+#include <cmath>
+using namespace std;
+
+#include "vector3.h"
+#include "macro_constants.h"
+
+void identityM4(float matrix[16]) {
+  for (int i = 0; i < 16; i++) {
+    matrix[i] = (i % 5 == 0) ? 1.0f : 0.0f;
+  }
+}
+
+void multiplyM4(const float matrix0[16], const float matrix1[16], float mat_store[16]) {
+  for (int column = 0; column < 4; column++) {
+    for (int row = 0; row < 4; row++) {
+      mat_store[column*4 + row] =
+        matrix0[row]*matrix1[column*4]
+        + matrix0[4 + row]*matrix1[column*4 + 1]
+        + matrix0[8 + row]*matrix1[column*4 + 2]
+        + matrix0[12 + row]*matrix1[column*4 + 3];
+    }
+  }
+}
+
+void perspectiveM4(const float field_of_view_y, const float aspect_ratio, const float near_distance, const float far_distance, float mat_store[16]) {
+  float focal_length = 1.0f / tanf(field_of_view_y / RAD_TO_DEG*0.5f);
+
+  for (int i = 0; i < 16; i++) {
+    mat_store[i] = 0.0f;
+  }
+
+  mat_store[0] = focal_length / aspect_ratio;
+  mat_store[5] = focal_length;
+  mat_store[10] = (far_distance + near_distance) / (near_distance - far_distance);
+  mat_store[11] = -1.0f;
+  mat_store[14] = 2.0f*far_distance*near_distance / (near_distance - far_distance);
+}
+
+void look_atM4(const float eye[3], const float center[3], const float up[3], float mat_store[16]) {
+  float forward[3];
+  float side[3];
+  float up_corrected[3];
+
+  __vector_element_opV3(center, -, eye, forward);
+  normalizeV3(forward);
+
+  __cross_productV3(forward, up, side);
+  normalizeV3(side);
+
+  __cross_productV3(side, forward, up_corrected);
+
+  // rows are the side, up and negated forward vectors
+  mat_store[0] = side[0];
+  mat_store[4] = side[1];
+  mat_store[8] = side[2];
+
+  mat_store[1] = up_corrected[0];
+  mat_store[5] = up_corrected[1];
+  mat_store[9] = up_corrected[2];
+
+  mat_store[2] = -forward[0];
+  mat_store[6] = -forward[1];
+  mat_store[10] = -forward[2];
+
+  mat_store[3] = 0.0f;
+  mat_store[7] = 0.0f;
+  mat_store[11] = 0.0f;
+
+  mat_store[12] = -__dot_productV3(side, eye);
+  mat_store[13] = -__dot_productV3(up_corrected, eye);
+  mat_store[14] = __dot_productV3(forward, eye);
+  mat_store[15] = 1.0f;
+}
\ No newline at end of file
@@ -0,0 +1,30 @@
+#ifndef MATRIX4_H
+#define MATRIX4_H
+
+// all 4x4 matrices are stored column-major, as OpenGL expects them
+
+void identityM4(float matrix[16]);
+
+// stores matrix0*matrix1 as mat_store (mat_store should be different from the other parameters)
+void multiplyM4(const float matrix0[16], const float matrix1[16], float mat_store[16]);
+
+// equivalent to gluPerspective
+void perspectiveM4(const float field_of_view_y, const float aspect_ratio, const float near_distance, const float far_distance, float mat_store[16]);
+
+// equivalent to gluLookAt
+void look_atM4(const float eye[3], const float center[3], const float up[3], float mat_store[16]);
+
+// stores matrix*[point, 1] as the homogeneous vec_store (vec_store should be different from point)
+#define __transform_pointM4(matrix, point, vec_store) \
+  vec_store[0] = matrix[0]*point[0] + matrix[4]*point[1] + matrix[8]*point[2] + matrix[12]; \
+  vec_store[1] = matrix[1]*point[0] + matrix[5]*point[1] + matrix[9]*point[2] + matrix[13]; \
+  vec_store[2] = matrix[2]*point[0] + matrix[6]*point[1] + matrix[10]*point[2] + matrix[14]; \
+  vec_store[3] = matrix[3]*point[0] + matrix[7]*point[1] + matrix[11]*point[2] + matrix[15];
+
+// stores the upper 3x3 of matrix times vector as vec_store (vec_store should be different from vector)
+#define __transform_vectorM4(matrix, vector, vec_store) \
+  vec_store[0] = matrix[0]*vector[0] + matrix[4]*vector[1] + matrix[8]*vector[2]; \
+  vec_store[1] = matrix[1]*vector[0] + matrix[5]*vector[1] + matrix[9]*vector[2]; \
+  vec_store[2] = matrix[2]*vector[0] + matrix[6]*vector[1] + matrix[10]*vector[2];
+
+#endif
\ No newline at end of file